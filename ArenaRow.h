@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "FlatRow.h"
+
+namespace slave
+{
+
+// Value of ArenaRow: the same types as std::variant FieldValue (see types.h) in any FieldValue mode,
+// strings are allocated from the memory resource of the row
+using ArenaValue = std::variant<std::nullptr_t
+                              , char                // MY_TINYINT
+                              , uint16_t            // MY_SMALLINT
+                              , int32_t             // MY_TIME, MY_ENUM
+                              , uint32_t            // MY_INT, MY_MEDIUMINT, MY_DATE, MY_TIMESTAMP
+                              , unsigned long long  // MY_BIGINT, MY_DATETIME, MY_SET
+                              , BitAlternative      // MY_BIT
+                              , float
+                              , double
+                              , std::pmr::string
+                              , decimal::Decimal
+                              >;
+
+// Row of RowType::Arena: as FlatRow, but values and their strings are allocated from
+// the memory resource of the transaction, see Transaction::arena, which is released at once
+// when the transaction is over instead of freeing every row. Without transaction callback
+// the default memory resource is used. Copies use the default memory resource too.
+class ArenaRow
+{
+public:
+    ArenaRow() = default;
+    explicit ArenaRow(std::pmr::memory_resource* resource) : m_values(resource), m_present(resource) {}
+
+    const PtrRowSchema& schema() const { return m_schema; }
+    std::pmr::memory_resource* resource() const { return m_values.get_allocator().resource(); }
+
+    size_t size() const { return m_values.size(); }
+    const std::string& name(size_t i) const { return m_schema->name(i); }
+    const std::string& type(size_t i) const { return m_schema->type(i); }
+
+    // Column is present in the row image, its value may be NULL
+    bool has(size_t i) const { return m_present[i]; }
+    // Empty value if the column is absent
+    const ArenaValue& operator[](size_t i) const
+    {
+        static const ArenaValue empty;
+        return m_present[i] ? m_values[i] : empty;
+    }
+
+    // nullptr if there is no such column or it is absent
+    const ArenaValue* find(std::string_view name) const
+    {
+        const size_t i = m_schema ? m_schema->index(name) : RowSchema::npos;
+        return i != RowSchema::npos && m_present[i] ? &m_values[i] : nullptr;
+    }
+
+    // Throws std::out_of_range if there is no such column or it is absent
+    const ArenaValue& at(std::string_view name) const
+    {
+        const ArenaValue* value = find(name);
+        if (!value)
+            throw std::out_of_range("ArenaRow::at(): no column " + std::string(name));
+        return *value;
+    }
+
+    // Copies the decoded row into the memory of 'resource'.
+    // Storage of the previous row is reused if it is of the same schema and resource.
+    void assign(const FlatRow& row, std::pmr::memory_resource* resource)
+    {
+        if (this->resource() != resource) {
+            // Assignment of pmr containers keeps their memory resource
+            this->~ArenaRow();
+            ::new (this) ArenaRow(resource);
+        }
+        if (m_schema != row.schema()) {
+            m_schema = row.schema();
+            m_values.assign(row.size(), ArenaValue());
+        }
+        m_present.assign(row.size(), false);
+
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (row.has(i)) {
+                m_present[i] = true;
+                slave::visit(Assign{m_values[i], resource}, row[i]);
+            }
+        }
+    }
+
+private:
+    struct Assign
+    {
+        ArenaValue& value;
+        std::pmr::memory_resource* resource;
+
+        void operator()(const std::string& x) const
+        {
+            if (std::pmr::string* p = std::get_if<std::pmr::string>(&value))
+                p->assign(x.data(), x.size());
+            else
+                value.emplace<std::pmr::string>(x.data(), x.size(), resource);
+        }
+        template <typename T>
+        void operator()(const T& x) const { value.emplace<T>(x); }
+    };
+
+    PtrRowSchema m_schema;
+    std::pmr::vector<ArenaValue> m_values;
+    std::pmr::vector<bool> m_present;
+};
+
+}// slave
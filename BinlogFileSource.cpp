@@ -0,0 +1,235 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mysql/my_global.h>
+#undef min
+#undef max
+#undef test
+
+#include "BinlogFileSource.h"
+#include "slave_log_event.h"
+#include "Logging.h"
+
+namespace
+{
+const char binlog_magic[] = { '\xfe', 'b', 'i', 'n' };
+const size_t binlog_magic_len = sizeof(binlog_magic);
+
+std::string base_name(const std::string& path)
+{
+    const auto slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string dir_name(const std::string& path)
+{
+    const auto slash = path.rfind('/');
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+int parse_server_version(const char* s, size_t max_len)
+{
+    const std::string version(s, ::strnlen(s, max_len));
+    int major, minor, patch;
+    if (3 == sscanf(version.c_str(), "%d.%d.%d", &major, &minor, &patch))
+        return major * 10000 + minor * 100 + patch;
+    return 0;
+}
+}// anonymous-namespace
+
+using namespace slave;
+
+BinlogFileSource::BinlogFileSource(const std::string& index_file)
+{
+    std::ifstream f(index_file.c_str());
+    if (!f)
+    {
+        LOG_ERROR(log, "Can't open binlog index file '" << index_file << "'");
+        throw std::runtime_error("BinlogFileSource::BinlogFileSource(): can't open index file '" + index_file + "'");
+    }
+
+    const std::string dir = dir_name(index_file);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        if (line[0] == '/')
+            m_files.push_back(line);
+        else if (line.compare(0, 2, "./") == 0)
+            m_files.push_back(dir + line.substr(1));
+        else
+            m_files.push_back(dir + "/" + line);
+    }
+}
+
+BinlogFileSource::BinlogFileSource(const std::vector<std::string>& files)
+    : m_files(files)
+{}
+
+BinlogFileSource::~BinlogFileSource()
+{
+    close();
+}
+
+void BinlogFileSource::seek(const std::string& log_name, unsigned long log_pos)
+{
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        if (base_name(m_files[i]) == log_name)
+        {
+            close();
+            m_current = i;
+            m_start_pos = log_pos;
+            return;
+        }
+    }
+
+    LOG_ERROR(log, "Binlog '" << log_name << "' is not found in the list of binlog files");
+    throw std::runtime_error("BinlogFileSource::seek(): unknown binlog '" + log_name + "'");
+}
+
+std::string_view BinlogFileSource::logName() const
+{
+    if (m_current >= m_files.size())
+        return std::string_view();
+
+    const std::string_view file = m_files[m_current];
+    const auto slash = file.rfind('/');
+    return slash == std::string_view::npos ? file : file.substr(slash + 1);
+}
+
+void BinlogFileSource::open(size_t index)
+{
+    const std::string& file = m_files[index];
+
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        const int err = errno;
+        LOG_ERROR(log, "Can't open binlog '" << file << "': " << ::strerror(err));
+        throw std::runtime_error("BinlogFileSource::open(): can't open binlog '" + file + "'");
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        const int err = errno;
+        ::close(fd);
+        LOG_ERROR(log, "Can't stat binlog '" << file << "': " << ::strerror(err));
+        throw std::runtime_error("BinlogFileSource::open(): can't stat binlog '" + file + "'");
+    }
+
+    if (static_cast<size_t>(st.st_size) < binlog_magic_len)
+    {
+        ::close(fd);
+        LOG_ERROR(log, "Binlog '" << file << "' is too short: " << st.st_size << " bytes");
+        throw std::runtime_error("BinlogFileSource::open(): binlog '" + file + "' is too short");
+    }
+
+    void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR(log, "Can't mmap binlog '" << file << "': " << ::strerror(errno));
+        throw std::runtime_error("BinlogFileSource::open(): can't mmap binlog '" + file + "'");
+    }
+    ::madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(data);
+    m_size = st.st_size;
+    m_pos = binlog_magic_len;
+
+    if (::memcmp(m_data, binlog_magic, binlog_magic_len) != 0)
+    {
+        close();
+        LOG_ERROR(log, "File '" << file << "' is not a binlog: wrong magic number");
+        throw std::runtime_error("BinlogFileSource::open(): file '" + file + "' is not a binlog");
+    }
+
+    // Binlog starts with format description event, its server version defines the format of other events
+    if (m_size >= m_pos + LOG_EVENT_HEADER_LEN + ST_COMMON_HEADER_LEN_OFFSET
+        && m_data[m_pos + EVENT_TYPE_OFFSET] == FORMAT_DESCRIPTION_EVENT)
+    {
+        m_server_version = parse_server_version(m_data + m_pos + LOG_EVENT_HEADER_LEN + ST_SERVER_VER_OFFSET,
+                                                ST_SERVER_VER_LEN);
+    }
+
+    LOG_INFO(log, "Reading binlog '" << file << "', " << m_size << " bytes, server version " << m_server_version);
+}
+
+void BinlogFileSource::close()
+{
+    if (m_data)
+    {
+        ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+        m_pos = 0;
+    }
+}
+
+bool BinlogFileSource::next(const char*& buf, unsigned int& event_len)
+{
+    while (m_current < m_files.size())
+    {
+        if (!m_data)
+            open(m_current);
+
+        if (m_pos + LOG_EVENT_HEADER_LEN <= m_size)
+        {
+            const unsigned int len = uint4korr(m_data + m_pos + EVENT_LEN_OFFSET);
+            if (len < LOG_EVENT_HEADER_LEN)
+            {
+                LOG_ERROR(log, "Invalid event length " << len << " at position " << m_pos << " of binlog '" << m_files[m_current] << "'");
+                throw std::runtime_error("BinlogFileSource::next(): invalid event length in binlog '" + m_files[m_current] + "'");
+            }
+
+            if (m_pos + len <= m_size)
+            {
+                const bool first_event = m_pos == binlog_magic_len;
+
+                buf = m_data + m_pos;
+                event_len = len;
+                m_pos += len;
+
+                if (first_event && m_start_pos > m_pos)
+                {
+                    if (m_start_pos > m_size)
+                    {
+                        LOG_ERROR(log, "Position " << m_start_pos << " is beyond the end of binlog '" << m_files[m_current] << "'");
+                        throw std::runtime_error("BinlogFileSource::next(): position is beyond the end of binlog '" + m_files[m_current] + "'");
+                    }
+                    m_pos = m_start_pos;
+                }
+                return true;
+            }
+        }
+
+        // Binlog being written by server may end with incomplete event
+        if (m_pos != m_size)
+            LOG_WARNING(log, "Binlog '" << m_files[m_current] << "' ends with incomplete event at position " << m_pos);
+
+        // The last binlog stays opened, so logName() keeps returning its name
+        if (m_current + 1 >= m_files.size())
+            break;
+
+        // Move to the next binlog, it is read from the beginning
+        close();
+        m_start_pos = 0;
+        ++m_current;
+    }
+
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace slave
+{
+
+// Source of binlog events read from local binlog files (e.g. archived binlogs of a master)
+// instead of a live master connection. Files are memory-mapped and events are handed out
+// as pointers into the mapping, so they can be passed to read_log_event() without copying.
+// Event pointer stays valid until the next call of next().
+// Use it with Slave::get_local_binlog().
+class BinlogFileSource
+{
+public:
+    // Takes binlog names from the index file (like mysql-bin.index). Relative names are
+    // resolved against the directory of the index file.
+    explicit BinlogFileSource(const std::string& index_file);
+    // Takes binlog files in the order of reading.
+    explicit BinlogFileSource(const std::vector<std::string>& files);
+    ~BinlogFileSource();
+
+    BinlogFileSource(const BinlogFileSource&) = delete;
+    BinlogFileSource& operator=(const BinlogFileSource&) = delete;
+
+    // Starts reading from position 'log_pos' of binlog 'log_name' (name without directory,
+    // as in Position::log_name). Format description event of this binlog is returned first anyway,
+    // because it is needed to parse the rest of events.
+    void seek(const std::string& log_name, unsigned long log_pos);
+
+    // Gets the next event. Moves to the next binlog of the list when the current one is over.
+    // Returns false when there are no more events.
+    bool next(const char*& buf, unsigned int& event_len);
+
+    // Name (without directory) of the binlog which the last event was read from.
+    // Points into the list of files, so it is not copied for each event.
+    std::string_view logName() const;
+
+    // Version of the server which has written the current binlog, in the same form
+    // as Slave::masterVersion(). It is 0 until the first event is read.
+    int serverVersion() const { return m_server_version; }
+
+    const std::vector<std::string>& files() const { return m_files; }
+
+private:
+    void open(size_t index);
+    void close();
+
+    std::vector<std::string> m_files;
+    size_t m_current = 0;
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+
+    // Where to jump after the format description event of the current file
+    size_t m_start_pos = 0;
+    int m_server_version = 0;
+};
+
+}// slave
@@ -0,0 +1,317 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <endian.h>
+
+#include "ColumnarBatch.h"
+#include "slave_log_event.h"
+#include "table.h"
+
+#include "Logging.h"
+
+using namespace slave;
+
+namespace
+{
+
+void reset_columns(const Table& table, std::vector<Column>& columns)
+{
+    const size_t count = table.column_filter.empty() ? table.fields.size() : table.column_filter_count;
+    columns.resize(count);
+
+    for (size_t i = 0; i < table.fields.size(); ++i)
+    {
+        if (!table.column_filter.empty() && !(table.column_filter[i / 8] & (1 << (i & 7))))
+            continue;
+
+        Column& column = columns[table.column_filter.empty() ? i : table.column_filter_fields[i]];
+        column.clear();
+        column.type = table.fields[i]->column_type();
+        column.name = table.fields[i]->field_name;
+        if (column.type == ColumnType::String)
+            column.offsets.push_back(0);
+    }
+}
+
+uint32_t load32(const unsigned char* from)
+{
+    uint32_t value;
+    ::memcpy(&value, from, sizeof(value));
+    return value;
+}
+
+uint64_t load64(const unsigned char* from)
+{
+    uint64_t value;
+    ::memcpy(&value, from, sizeof(value));
+    return value;
+}
+
+// Value i is decoded from from + i * stride. Loads below are of fixed size and without branches,
+// so each column is a tight loop without dispatch by field. Compilers vectorize only the loop
+// of TINYINT, the others are bound by strided loads and stay scalar.
+template <typename T, typename Load>
+void gather(T* out, const unsigned char* from, size_t stride, size_t count, Load load)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = load(from + i * stride);
+}
+
+// Values of the column for 'count' rows with the field at 'from', same as Field::unpack_int() and others give
+void gather_column(Column& column, const DecodeStep& step, const unsigned char* from, size_t stride, size_t count)
+{
+    switch (column.type)
+    {
+    case ColumnType::Integer:
+    {
+        column.ints.resize(count);
+        int64_t* const out = column.ints.data();
+        switch (step.op)
+        {
+        case DecodeOp::Tiny:
+            gather(out, from, stride, count, [](const unsigned char* p) { return int64_t(char(*p)); });
+            return;
+        case DecodeOp::Short:
+            gather(out, from, stride, count, [](const unsigned char* p) { return int64_t(p[0] | p[1] << 8); });
+            return;
+        case DecodeOp::Medium:
+        case DecodeOp::Date:
+            gather(out, from, stride, count, [](const unsigned char* p) { return int64_t(p[0] | p[1] << 8 | p[2] << 16); });
+            return;
+        case DecodeOp::Long:
+        case DecodeOp::Timestamp:
+            gather(out, from, stride, count, [](const unsigned char* p) { return int64_t(le32toh(load32(p))); });
+            return;
+        case DecodeOp::LongLong:
+        case DecodeOp::Datetime:
+            gather(out, from, stride, count, [](const unsigned char* p) { return int64_t(le64toh(load64(p))); });
+            return;
+        case DecodeOp::Timestamp2:
+            // Fractional part is ignored
+            gather(out, from, stride, count, [](const unsigned char* p) { return int64_t(be32toh(load32(p))); });
+            return;
+        case DecodeOp::Datetime2:
+            gather(out, from, stride, count, [](const unsigned char* p)
+            {
+                return int64_t(Field_datetime::datetime2(uint64_t(be32toh(load32(p))) << 8 | p[4]));
+            });
+            return;
+        default:
+            for (size_t i = 0; i < count; ++i)
+                step.field->unpack_int((const char*)from + i * stride, out[i]);
+            return;
+        }
+    }
+    case ColumnType::Real:
+    {
+        column.reals.resize(count);
+        double* const out = column.reals.data();
+        if (step.op == DecodeOp::Float) {
+            gather(out, from, stride, count, [](const unsigned char* p)
+            {
+                float value;
+                ::memcpy(&value, p, sizeof(value));
+                return double(value);
+            });
+        } else {
+            gather(out, from, stride, count, [](const unsigned char* p)
+            {
+                double value;
+                ::memcpy(&value, p, sizeof(value));
+                return value;
+            });
+        }
+        return;
+    }
+    case ColumnType::Decimal:
+        column.decimals.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            step.field->unpack_decimal((const char*)from + i * stride, column.decimals[i]);
+        return;
+    case ColumnType::String:
+        break;
+    }
+    throw std::runtime_error("ColumnarBatch::append_fixed(): string column '" + std::string(column.name) + "' is not of fixed size");
+}
+
+void set_valid(Column& column, size_t count)
+{
+    column.validity.assign((count + 63) / 64, ~uint64_t(0));
+    if (count % 64)
+        column.validity.back() = (uint64_t(1) << (count % 64)) - 1;
+}
+
+}// anonymous-namespace
+
+void Column::clear()
+{
+    ints.clear();
+    reals.clear();
+    decimals.clear();
+    offsets.clear();
+    pool.clear();
+    validity.clear();
+}
+
+const char* Column::append(const Field& field, const char* from, size_t row)
+{
+    if (row % 64 == 0)
+        validity.push_back(0);
+    validity.back() |= uint64_t(1) << (row % 64);
+
+    switch (type)
+    {
+    case ColumnType::Integer:
+        ints.emplace_back();
+        return field.unpack_int(from, ints.back());
+    case ColumnType::Real:
+        reals.emplace_back();
+        return field.unpack_real(from, reals.back());
+    case ColumnType::Decimal:
+        decimals.emplace_back();
+        return field.unpack_decimal(from, decimals.back());
+    case ColumnType::String:
+    {
+        std::string_view value;
+        field.view(from, value);
+        pool.append(value.data(), value.size());
+        offsets.push_back(pool.size());
+        return value.data() + value.size();
+    }
+    }
+    return from;
+}
+
+void Column::appendNull(size_t row)
+{
+    if (row % 64 == 0)
+        validity.push_back(0);
+
+    switch (type)
+    {
+    case ColumnType::Integer:
+        ints.emplace_back();
+        break;
+    case ColumnType::Real:
+        reals.emplace_back();
+        break;
+    case ColumnType::Decimal:
+        decimals.emplace_back();
+        break;
+    case ColumnType::String:
+        offsets.push_back(pool.size());
+        break;
+    }
+}
+
+void ColumnarBatch::reset(const Table& table, RecordSet::TypeEvent type)
+{
+    rows = 0;
+    tbl_name = table.table_name;
+    db_name = table.database_name;
+    type_event = type;
+
+    reset_columns(table, columns);
+    if (type == RecordSet::Update) {
+        if (old_columns.empty())
+            old_columns.swap(m_old_storage);
+        reset_columns(table, old_columns);
+    } else if (!old_columns.empty()) {
+        old_columns.swap(m_old_storage);
+    }
+}
+
+const unsigned char* ColumnarBatch::append(const Table& table, std::vector<Column>& image, const unsigned char* row,
+                                           unsigned int colcnt, const std::vector<unsigned char>& cols)
+{
+    if (colcnt != table.fields.size()) {
+        LOG_ERROR(log, "Field count mismatch in unpacking row for "
+                  << table.full_name << ": " << colcnt << " != " << table.fields.size());
+        throw std::runtime_error("ColumnarBatch::append failed");
+    }
+
+    // Null bitmap has bits only for present columns
+    const unsigned char* null_ptr = row;
+    const char* ptr = (const char*)row + (n_set_bits(cols, colcnt) + 7) / 8;
+    unsigned int null_mask = 1U;
+    unsigned char null_bits = *null_ptr++;
+
+    for (unsigned int i = 0; i < colcnt; ++i)
+    {
+        const Field& field = *table.fields[i];
+        const bool filtered = !table.column_filter.empty() && !(table.column_filter[i / 8] & (1 << (i & 7)));
+        Column* const column = filtered ? nullptr : &image[table.column_filter.empty() ? i : table.column_filter_fields[i]];
+
+        if (!cols.empty() && !(cols[i / 8] & (1 << (i & 7)))) {
+            if (column)
+                column->appendNull(rows);
+            continue;
+        }
+
+        if ((null_mask & 0xFF) == 0) {
+            null_mask = 1U;
+            null_bits = *null_ptr++;
+        }
+
+        if (null_bits & null_mask) {
+            if (column)
+                column->appendNull(rows);
+        } else if (column) {
+            ptr = column->append(field, ptr, rows);
+        } else {
+            ptr = field.skip(ptr);
+        }
+
+        null_mask <<= 1;
+    }
+
+    return (const unsigned char*)ptr;
+}
+
+bool ColumnarBatch::append_fixed(const Table& table, const Row_event_info& roi)
+{
+    const DecodePlan& plan = table.plan;
+    const size_t width = plan.fixed_width();
+    const bool update = type_event == RecordSet::Update;
+    if (!width || rows || plan.size() != roi.m_width || plan.size() != table.fields.size()
+        || !all_bits_set(roi.m_cols, roi.m_width) || (update && !all_bits_set(roi.m_cols_ai, roi.m_width)))
+        return false;
+
+    const size_t null_bytes = (roi.m_width + 7) / 8;
+    const size_t image = null_bytes + width;
+    const size_t stride = update ? 2 * image : image;
+    const size_t size = roi.m_rows_end - roi.m_rows_buf;
+    if (!size || size % stride)
+        return false;
+
+    // Each image has the size without NULLs only if its null bitmap is empty,
+    // so positions of all images are checked one by one
+    const size_t count = size / stride;
+    for (const unsigned char* image_start = roi.m_rows_buf; image_start != roi.m_rows_end; image_start += image)
+        for (size_t i = 0; i < null_bytes; ++i)
+            if (image_start[i])
+                return false;
+
+    size_t offset = null_bytes;
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        const DecodeStep& step = plan[i];
+        if (table.is_selected(i))
+        {
+            const size_t index = table.column_filter.empty() ? i : table.column_filter_fields[i];
+            if (update)
+            {
+                gather_column(old_columns[index], step, roi.m_rows_buf + offset, stride, count);
+                set_valid(old_columns[index], count);
+                gather_column(columns[index], step, roi.m_rows_buf + image + offset, stride, count);
+            }
+            else
+                gather_column(columns[index], step, roi.m_rows_buf + offset, stride, count);
+            set_valid(columns[index], count);
+        }
+        offset += step.width;
+    }
+
+    rows = count;
+    return true;
+}
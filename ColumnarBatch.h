@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "field.h"
+#include "recordset.h"
+
+namespace slave
+{
+
+class Table;
+struct Row_event_info;
+
+// Values of one column for all rows of a batch, stored contiguously by type.
+// All arrays of the column type have one element per row, NULL and absent values
+// are zero or empty and are marked in the validity bitmap.
+struct Column
+{
+    ColumnType type = ColumnType::Integer;
+    std::string_view name;
+
+    std::vector<int64_t> ints;
+    std::vector<double> reals;
+    std::vector<decimal::Decimal> decimals;
+    // Value of row i is pool[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> offsets;
+    std::string pool;
+
+    // Bit i is set if row i has a value: it is not NULL and is present in the row image
+    std::vector<uint64_t> validity;
+
+    bool valid(size_t row) const { return validity[row / 64] & (uint64_t(1) << (row % 64)); }
+    std::string_view str(size_t row) const { return std::string_view(pool.data() + offsets[row], offsets[row + 1] - offsets[row]); }
+
+    // Keeps allocated memory
+    void clear();
+
+    // Unpacks the value of the next row, returns the end of the packed value
+    const char* append(const Field& field, const char* from, size_t row);
+    void appendNull(size_t row);
+};
+
+// All rows of one rows event by columns, see Slave::setColumnarCallback.
+// Columns are in the order of the table or of the column filter, if it is set.
+struct ColumnarBatch
+{
+    std::vector<Column> columns;
+    // Image before update, empty for Write and Delete
+    std::vector<Column> old_columns;
+    size_t rows = 0;
+
+    std::string_view tbl_name;
+    std::string_view db_name;
+
+    time_t when = 0;
+
+    RecordSet::TypeEvent type_event = RecordSet::Write;
+
+    // Root master ID from which this record originated
+    unsigned int master_id = 0;
+
+    // Prepares empty columns for the table, keeps allocated memory
+    void reset(const Table& table, RecordSet::TypeEvent type);
+
+    // Unpacks the next row image at 'row' into 'columns' or 'old_columns', returns the end of the image.
+    // 'cols' is the bitmap of columns present in the image, as in Row_event_info.
+    const unsigned char* append(const Table& table, std::vector<Column>& image, const unsigned char* row,
+                                unsigned int colcnt, const std::vector<unsigned char>& cols);
+
+    // Unpacks all rows of the event at once, if the plan of the table has fixed_width() and every image
+    // has all columns without NULLs. Rows are of the same size then, and each column is gathered
+    // from all rows by one loop over fixed offsets. Returns false if rows do not match,
+    // nothing is unpacked then. Must be called after reset(), before append().
+    bool append_fixed(const Table& table, const Row_event_info& roi);
+
+private:
+    // Memory of old_columns kept between update events
+    std::vector<Column> m_old_storage;
+};
+
+}// slave
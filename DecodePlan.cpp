@@ -0,0 +1,23 @@
+#include "DecodePlan.h"
+
+using namespace slave;
+
+void DecodePlan::build(const std::vector<std::unique_ptr<Field>>& fields)
+{
+    std::vector<DecodeStep> steps;
+    steps.reserve(fields.size());
+    // Width of DecodeOp::Field is set only for fields of fixed size
+    bool fixed = true;
+    size_t width = 0;
+    for (const auto& field : fields)
+    {
+        steps.push_back(field->decode_step());
+        steps.back().field = field.get();
+        const DecodeStep& step = steps.back();
+        if (step.op == DecodeOp::VarString || step.op == DecodeOp::Blob || !step.width)
+            fixed = false;
+        width += step.width;
+    }
+    m_steps.swap(steps);
+    m_fixed_width = fixed ? width : 0;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "field.h"
+
+namespace slave
+{
+
+// Schema of a table compiled into flat array of operations, one per field.
+// Decodes values without virtual calls for most of types, see DecodeOp.
+// Has to be rebuilt when fields change, see Table::build_plan().
+class DecodePlan
+{
+public:
+    void build(const std::vector<std::unique_ptr<Field>>& fields);
+    void clear() { m_steps.clear(); m_fixed_width = 0; }
+
+    size_t size() const { return m_steps.size(); }
+    // Size of values of a row with all columns and without NULLs,
+    // 0 if some of fields are of variable size. See ColumnarBatch::append_fixed().
+    size_t fixed_width() const { return m_fixed_width; }
+    bool empty() const { return m_steps.empty(); }
+    const DecodeStep& operator[](size_t i) const { return m_steps[i]; }
+
+    // Unpacks the value of i-th field at 'from' into 'value' of the same type as Field::unpack() does.
+    // Returns the end of the packed value.
+    const char* unpack(size_t i, const char* from, FieldValue& value) const
+    {
+        const DecodeStep& step = m_steps[i];
+        switch (step.op)
+        {
+        case DecodeOp::Tiny:
+            setFieldValue(value, *from);
+            return from + 1;
+        case DecodeOp::Short:
+            setFieldValue(value, static_cast<uint16_t>(load_le(from, 2)));
+            return from + 2;
+        case DecodeOp::Medium:
+        case DecodeOp::Date:
+            setFieldValue(value, static_cast<uint32_t>(load_le(from, 3)));
+            return from + 3;
+        case DecodeOp::Long:
+        case DecodeOp::Timestamp:
+            setFieldValue(value, static_cast<uint32_t>(load_le(from, 4)));
+            return from + 4;
+        case DecodeOp::LongLong:
+        case DecodeOp::Datetime:
+            setFieldValue(value, static_cast<unsigned long long>(load_le(from, 8)));
+            return from + 8;
+        case DecodeOp::Datetime2:
+            // Fractional part is ignored
+            setFieldValue(value, Field_datetime::datetime2(load_be(from, 5)));
+            return from + step.width;
+        case DecodeOp::Float:
+        {
+            float tmp;
+            ::memcpy(&tmp, from, sizeof(tmp));
+            setFieldValue(value, tmp);
+            return from + sizeof(tmp);
+        }
+        case DecodeOp::Double:
+        {
+            double tmp;
+            ::memcpy(&tmp, from, sizeof(tmp));
+            setFieldValue(value, tmp);
+            return from + sizeof(tmp);
+        }
+        case DecodeOp::Timestamp2:
+            // Fractional part is ignored
+            setFieldValue(value, static_cast<uint32_t>(load_be(from, 4)));
+            return from + step.width;
+        case DecodeOp::Time:
+        {
+            int32_t tmp = static_cast<int32_t>(load_le(from, 3));
+            if (tmp & 0x800000)
+                tmp |= ~0xffffff;
+            setFieldValue(value, tmp);
+            return from + 3;
+        }
+        case DecodeOp::Enum:
+            if (step.width == 1)
+                setFieldValue(value, int(*from));
+            else
+                setFieldValue(value, int(static_cast<short>(load_le(from, 2))));
+            return from + step.width;
+        case DecodeOp::Set:
+            setFieldValue(value, static_cast<unsigned long long>(load_le(from, step.width)));
+            return from + step.width;
+        case DecodeOp::Bit:
+            setFieldValue(value, static_cast<types::MY_BIT>(load_be(from, step.width)));
+            return from + step.width;
+        case DecodeOp::Decimal:
+        {
+            decimal::Decimal tmp;
+            from = step.field->unpack_decimal(from, tmp);
+            setFieldValue(value, tmp);
+            return from;
+        }
+        case DecodeOp::VarString:
+        case DecodeOp::Blob:
+        {
+            const size_t length = load_le(from, step.width);
+            from += step.width;
+            setFieldValue(value, from, length);
+            return from + length;
+        }
+        case DecodeOp::Field:
+            break;
+        }
+
+        return step.field->unpack(from, value);
+    }
+
+    // Returns the end of the packed value of i-th field at 'from' without unpacking it
+    const char* skip(size_t i, const char* from) const
+    {
+        const DecodeStep& step = m_steps[i];
+        switch (step.op)
+        {
+        case DecodeOp::VarString:
+        case DecodeOp::Blob:
+            return from + step.width + load_le(from, step.width);
+        case DecodeOp::Field:
+            return step.field->skip(from);
+        default:
+            return from + step.width;
+        }
+    }
+
+private:
+    static uint64_t load_le(const char* from, unsigned width)
+    {
+        uint64_t result = 0;
+        for (unsigned i = 0; i < width; ++i)
+            result |= uint64_t(static_cast<unsigned char>(from[i])) << (8 * i);
+        return result;
+    }
+
+    static uint64_t load_be(const char* from, unsigned width)
+    {
+        uint64_t result = 0;
+        for (unsigned i = 0; i < width; ++i)
+            result = (result << 8) | static_cast<unsigned char>(from[i]);
+        return result;
+    }
+
+    std::vector<DecodeStep> m_steps;
+    size_t m_fixed_width = 0;
+};
+
+}// slave
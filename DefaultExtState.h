@@ -60,7 +60,7 @@ public:
     void setMasterPosition(const Position& pos) override
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        position = pos;
+        position.assign(pos);
         intransaction_pos = pos.log_pos;
     }
     void saveMasterPosition() override {}
@@ -109,6 +109,7 @@ public:
     }
     void initTableCount(const std::string& t) override {}
     void incTableCount(const std::string& t) override {}
+    void incTableCount(const std::string& t, unsigned long count) override {}
 };
 
 }// slave
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace slave
+{
+
+struct EventRingStats
+{
+    size_t   capacity        = 0;
+    // Number of events read from network and not yet processed
+    size_t   depth           = 0;
+    // How many times network reading waited for processing because the ring was full
+    uint64_t producer_stalls = 0;
+    // How many times processing waited for network because the ring was empty
+    uint64_t consumer_stalls = 0;
+};
+
+// Bounded single-producer single-consumer ring of binlog packets. It passes events from
+// the network reading thread to the processing thread in pipelined mode (see MasterInfo::pipeline_size).
+// Slots keep their buffers between uses, so there are no allocations after warmup.
+// Both sides spin a little on the lock-free indexes and then fall asleep on a condition variable.
+class EventRing
+{
+public:
+    struct Slot
+    {
+        std::vector<unsigned char> data;
+        unsigned long len = 0;
+        // Reading has failed, 'len' is packet_error or end of data mark, reading thread is over
+        bool error = false;
+        // Event checksum is already verified by the reading thread
+        bool checksum_verified = false;
+    };
+
+    explicit EventRing(size_t capacity)
+        : m_slots(capacity ? capacity : 1)
+    {}
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    size_t capacity() const { return m_slots.size(); }
+
+    size_t depth() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    EventRingStats stats() const
+    {
+        EventRingStats result;
+        result.capacity = capacity();
+        result.depth = depth();
+        result.producer_stalls = m_producer_stalls.load(std::memory_order_relaxed);
+        result.consumer_stalls = m_consumer_stalls.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // Producer side. Waits for a free slot, returns nullptr if 'stop' was raised while waiting.
+    Slot* acquire(const std::atomic<bool>& stop)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (!wait(m_producer_waiting, m_producer_stalls, stop,
+                  [this, tail]() { return tail - m_head.load() < m_slots.size(); }))
+            return nullptr;
+        return &m_slots[tail % m_slots.size()];
+    }
+
+    // Makes the slot returned by acquire() visible to consumer.
+    void publish()
+    {
+        m_tail.fetch_add(1);
+        if (m_consumer_waiting.load())
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_cond.notify_all();
+        }
+    }
+
+    // Consumer side. Waits for the next slot not longer than 'timeout', returns nullptr if there is none.
+    // Slot stays in the ring until pop().
+    Slot* front(std::chrono::milliseconds timeout)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (!wait(m_consumer_waiting, m_consumer_stalls, timeout,
+                  [this, head]() { return m_tail.load() != head; }))
+            return nullptr;
+        return &m_slots[head % m_slots.size()];
+    }
+
+    void pop()
+    {
+        m_head.fetch_add(1);
+        if (m_producer_waiting.load())
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_cond.notify_all();
+        }
+    }
+
+    // Wakes up waiting producer, so it can check its stop flag.
+    void wakeup()
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_cond.notify_all();
+    }
+
+    // Drops all events. Must be called only when producer is stopped.
+    void clear()
+    {
+        m_head.store(m_tail.load());
+    }
+
+private:
+    template <typename Ready>
+    static bool spin(Ready ready)
+    {
+        for (int i = 0; i < spin_count; ++i)
+        {
+            if (ready())
+                return true;
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        return false;
+    }
+
+    template <typename Ready>
+    bool wait(std::atomic<bool>& waiting, std::atomic<uint64_t>& stalls, const std::atomic<bool>& stop, Ready ready)
+    {
+        if (ready())
+            return true;
+        stalls.fetch_add(1, std::memory_order_relaxed);
+        if (spin(ready))
+            return true;
+
+        std::unique_lock<std::mutex> l(m_mutex);
+        waiting.store(true);
+        m_cond.wait(l, [&]() { return ready() || stop.load(); });
+        waiting.store(false);
+        return ready();
+    }
+
+    template <typename Ready>
+    bool wait(std::atomic<bool>& waiting, std::atomic<uint64_t>& stalls, std::chrono::milliseconds timeout, Ready ready)
+    {
+        if (ready())
+            return true;
+        stalls.fetch_add(1, std::memory_order_relaxed);
+        if (spin(ready))
+            return true;
+
+        std::unique_lock<std::mutex> l(m_mutex);
+        waiting.store(true);
+        const bool result = m_cond.wait_for(l, timeout, ready);
+        waiting.store(false);
+        return result;
+    }
+
+    static const int spin_count = 256;
+
+    std::vector<Slot> m_slots;
+
+    // Indexes grow infinitely, slot is index % capacity
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+
+    alignas(64) std::atomic<bool> m_producer_waiting{false};
+    std::atomic<bool> m_consumer_waiting{false};
+    std::atomic<uint64_t> m_producer_stalls{0};
+    std::atomic<uint64_t> m_consumer_stalls{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+}// slave
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "FlatRow.h"
+
+using namespace slave;
+
+RowSchema::RowSchema(std::vector<std::string> names, std::vector<std::string> types)
+    : m_names(std::move(names))
+    , m_types(std::move(types))
+{
+    if (m_names.size() != m_types.size())
+        throw std::runtime_error("RowSchema: count of names and types differ");
+
+    // Columns of column filter absent in the table have empty names and are not looked up
+    std::vector<std::string_view> sorted;
+    for (const auto& name : m_names)
+        if (!name.empty())
+            sorted.push_back(name);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        throw std::runtime_error("RowSchema: duplicate column names");
+
+    // Seeds are tried until all names get distinct slots, the table grows if it takes long
+    size_t size = 1;
+    while (size < m_names.size() * 2)
+        size <<= 1;
+
+    for (uint64_t seed = 0; ; ++seed)
+    {
+        if (seed && seed % 64 == 0)
+            size <<= 1;
+
+        std::vector<uint32_t> slots(size, 0);
+        bool collision = false;
+        for (size_t i = 0; i < m_names.size() && !collision; ++i)
+        {
+            if (m_names[i].empty())
+                continue;
+            uint32_t& slot = slots[hash(m_names[i], seed) & (size - 1)];
+            if (slot)
+                collision = true;
+            else
+                slot = i + 1;
+        }
+
+        if (!collision)
+        {
+            m_seed = seed;
+            m_slots.swap(slots);
+            return;
+        }
+    }
+}
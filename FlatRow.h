@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+
+namespace slave
+{
+
+// Names and types of columns of FlatRow, built once per table and shared by all rows.
+// Lookup by name uses perfect hash: names of the schema have distinct slots.
+class RowSchema
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    RowSchema(std::vector<std::string> names, std::vector<std::string> types);
+
+    size_t size() const { return m_names.size(); }
+    const std::string& name(size_t i) const { return m_names[i]; }
+    const std::string& type(size_t i) const { return m_types[i]; }
+
+    // Index of the column, npos if there is no such column.
+    // The index may be resolved once and used as a handle for all rows of the table.
+    size_t index(std::string_view name) const
+    {
+        const uint32_t slot = m_slots[hash(name, m_seed) & (m_slots.size() - 1)];
+        return slot && m_names[slot - 1] == name ? slot - 1 : npos;
+    }
+
+private:
+    static uint64_t hash(std::string_view name, uint64_t seed)
+    {
+        uint64_t h = 14695981039346656037ULL ^ seed;
+        for (const char c : name)
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        return h ^ (h >> 29);
+    }
+
+    std::vector<std::string> m_names;
+    std::vector<std::string> m_types;
+    uint64_t m_seed = 0;
+    // Index + 1 of the column with this hash slot, 0 if the slot is free
+    std::vector<uint32_t> m_slots;
+};
+
+typedef std::shared_ptr<const RowSchema> PtrRowSchema;
+
+// Row of RowType::Flat: values by index of column in the shared schema.
+// Columns are the same as in Row (all fields or those of column filter, in its order).
+// Columns absent in the row image (see binlog_row_image) have no value.
+class FlatRow
+{
+public:
+    const PtrRowSchema& schema() const { return m_schema; }
+
+    size_t size() const { return m_values.size(); }
+    const std::string& name(size_t i) const { return m_schema->name(i); }
+    const std::string& type(size_t i) const { return m_schema->type(i); }
+
+    // Column is present in the row image, its value may be NULL
+    bool has(size_t i) const { return m_present[i]; }
+    // Empty value if the column is absent
+    const FieldValue& operator[](size_t i) const
+    {
+        static const FieldValue empty;
+        return m_present[i] ? m_values[i] : empty;
+    }
+
+    // nullptr if there is no such column or it is absent
+    const FieldValue* find(std::string_view name) const
+    {
+        const size_t i = m_schema ? m_schema->index(name) : RowSchema::npos;
+        return i != RowSchema::npos && m_present[i] ? &m_values[i] : nullptr;
+    }
+
+    // Throws std::out_of_range if there is no such column or it is absent
+    const FieldValue& at(std::string_view name) const
+    {
+        const FieldValue* value = find(name);
+        if (!value)
+            throw std::out_of_range("FlatRow::at(): no column " + std::string(name));
+        return *value;
+    }
+
+    // Starts new row of the schema. Values of the previous row are kept as storage
+    // for the values of the same columns, see setFieldValue()
+    void reset(const PtrRowSchema& schema)
+    {
+        if (m_schema != schema) {
+            m_schema = schema;
+            m_values.assign(schema->size(), FieldValue());
+        }
+        m_present.assign(schema->size(), false);
+    }
+
+    // Marks the column as present, the value is unpacked into the result
+    FieldValue& emplace(size_t i)
+    {
+        m_present[i] = true;
+        return m_values[i];
+    }
+
+private:
+    PtrRowSchema m_schema;
+    std::vector<FieldValue> m_values;
+    std::vector<bool> m_present;
+};
+
+}// slave
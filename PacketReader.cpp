@@ -0,0 +1,229 @@
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <mysql/my_global.h>
+#undef min
+#undef max
+#undef test
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <zlib.h>
+
+#include "PacketReader.h"
+
+#define ER_NET_PACKETS_OUT_OF_ORDER 1156
+#define ER_NET_UNCOMPRESS_ERROR 1157
+
+namespace
+{
+const size_t packet_header_size = 4;
+// Compressed length, sequence number, length before compression (0 if payload is not compressed)
+const size_t compressed_header_size = 7;
+// Payload of this length means that the packet is continued in the next one
+const unsigned long max_packet_length = 0xffffff;
+}// anonymous-namespace
+
+using namespace slave;
+
+void PacketReader::Buffer::reserve(size_t size)
+{
+    if (begin == end)
+        begin = end = 0;
+
+    if (begin + size > data.size())
+    {
+        // Move the incomplete packet to the beginning, it is usually much smaller than the buffer
+        ::memmove(data.data(), data.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+
+        if (size > data.size())
+            data.resize(size);
+    }
+}
+
+PacketReader::PacketReader(size_t buffer_size)
+{
+    m_raw.data.resize(buffer_size > compressed_header_size ? buffer_size : compressed_header_size);
+}
+
+void PacketReader::reset(int fd, unsigned int read_timeout, bool compressed)
+{
+    m_fd = fd;
+    m_timeout_ms = read_timeout ? static_cast<int>(read_timeout) * 1000 : -1;
+    // Server response to a command starts with sequence number 1
+    m_seq = 1;
+    m_compressed = compressed;
+    m_raw.begin = m_raw.end = 0;
+    m_plain.begin = m_plain.end = 0;
+    if (m_compressed && m_plain.data.empty())
+        m_plain.data.resize(m_raw.data.size());
+    m_errno = 0;
+    m_error.clear();
+}
+
+bool PacketReader::set_error(unsigned int error_number, const std::string& message)
+{
+    m_errno = error_number;
+    m_error = message;
+    return false;
+}
+
+bool PacketReader::receive(size_t size)
+{
+    if (m_raw.size() >= size)
+        return true;
+
+    m_raw.reserve(size);
+
+    while (m_raw.size() < size)
+    {
+        // Read as much as is available, not only the requested size
+        const ssize_t n = ::recv(m_fd, m_raw.data.data() + m_raw.end, m_raw.data.size() - m_raw.end, MSG_DONTWAIT);
+        if (n > 0)
+        {
+            m_raw.end += n;
+            m_bytes_read += n;
+            continue;
+        }
+        if (n == 0)
+            return set_error(CR_SERVER_LOST, "Lost connection to MySQL server during query");
+
+        const int err = errno;
+        if (err == EINTR)
+            continue;
+        if (err != EAGAIN && err != EWOULDBLOCK)
+            return set_error(CR_SERVER_LOST, std::string("Lost connection to MySQL server during query: ") + ::strerror(err));
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        const int res = ::poll(&pfd, 1, m_timeout_ms);
+        if (res == 0)
+            return set_error(CR_SERVER_LOST, "Lost connection to MySQL server during query: read timeout");
+        if (res < 0 && errno != EINTR)
+            return set_error(CR_SERVER_LOST, std::string("Lost connection to MySQL server during query: ") + ::strerror(errno));
+    }
+
+    return true;
+}
+
+bool PacketReader::inflate()
+{
+    if (!receive(compressed_header_size))
+        return false;
+
+    const unsigned long compressed_len = uint3korr(m_raw.head());
+    const unsigned long len = uint3korr(m_raw.head() + 4);
+
+    if (!receive(compressed_header_size + compressed_len))
+        return false;
+
+    const unsigned char* payload = m_raw.head() + compressed_header_size;
+    if (len == 0)
+    {
+        // Small packets are sent as is
+        m_plain.reserve(m_plain.size() + compressed_len);
+        ::memcpy(m_plain.data.data() + m_plain.end, payload, compressed_len);
+        m_plain.end += compressed_len;
+    }
+    else
+    {
+        m_plain.reserve(m_plain.size() + len);
+        uLongf unpacked_len = len;
+        if (::uncompress(m_plain.data.data() + m_plain.end, &unpacked_len, payload, compressed_len) != Z_OK
+            || unpacked_len != len)
+            return set_error(ER_NET_UNCOMPRESS_ERROR, "Couldn't uncompress communication packet");
+        m_plain.end += len;
+    }
+
+    m_raw.begin += compressed_header_size + compressed_len;
+    return true;
+}
+
+bool PacketReader::fill(size_t size)
+{
+    if (!m_compressed)
+        return receive(size);
+
+    while (m_plain.size() < size)
+        if (!inflate())
+            return false;
+    return true;
+}
+
+void PacketReader::parse_error_packet(const unsigned char* packet, unsigned long len)
+{
+    // 0xff, error code, optional '#' and 5 bytes of sql state, message
+    if (len < 3)
+    {
+        set_error(CR_SERVER_LOST, "Malformed error packet");
+        return;
+    }
+
+    const unsigned char* pos = packet + 3;
+    const unsigned char* end = packet + len;
+    if (pos < end && *pos == '#')
+        pos = end - pos > 6 ? pos + 6 : end;
+
+    set_error(uint2korr(packet + 1), std::string(reinterpret_cast<const char*>(pos), end - pos));
+}
+
+unsigned long PacketReader::next(const unsigned char*& packet)
+{
+    m_multi_packet.clear();
+
+    Buffer& buffer = stream();
+    unsigned long len = 0;
+    bool multi = false;
+    while (true)
+    {
+        if (!fill(packet_header_size))
+            return packet_error;
+
+        const unsigned char* header = buffer.head();
+        const unsigned long chunk_len = uint3korr(header);
+        // Compressed protocol has its own sequence numbers for compressed frames
+        if (!m_compressed && header[3] != m_seq)
+        {
+            set_error(ER_NET_PACKETS_OUT_OF_ORDER, "Got packets out of order");
+            return packet_error;
+        }
+        ++m_seq;
+
+        if (!fill(packet_header_size + chunk_len))
+            return packet_error;
+
+        const unsigned char* payload = buffer.head() + packet_header_size;
+        buffer.begin += packet_header_size + chunk_len;
+
+        if (chunk_len < max_packet_length && !multi)
+        {
+            packet = payload;
+            len = chunk_len;
+            break;
+        }
+
+        m_multi_packet.insert(m_multi_packet.end(), payload, payload + chunk_len);
+        multi = true;
+        if (chunk_len < max_packet_length)
+        {
+            packet = m_multi_packet.data();
+            len = m_multi_packet.size();
+            break;
+        }
+    }
+
+    if (len && packet[0] == 255)
+    {
+        parse_error_packet(packet, len);
+        return packet_error;
+    }
+
+    return len;
+}
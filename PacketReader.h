@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace slave
+{
+
+// Built-in reader of MySQL client/server protocol packets, used for binlog stream
+// instead of libmysqlclient (see MasterInfo::native_reader). It takes the socket
+// after COM_BINLOG_DUMP and reads it into a large user-space buffer, so one recv()
+// usually brings many events, and packets are handed out as pointers into that buffer
+// without copying. Multi-packets (payload of 16M and more) are reassembled in a separate buffer.
+// Compressed protocol is supported: compressed frames are unpacked into a second buffer,
+// and packets are handed out from it. SSL connections are not supported.
+class PacketReader
+{
+public:
+    explicit PacketReader(size_t buffer_size);
+
+    PacketReader(const PacketReader&) = delete;
+    PacketReader& operator=(const PacketReader&) = delete;
+
+    // Starts reading of the new connection: drops buffered data and expects
+    // the first packet of the server response. 'read_timeout' is in seconds, 0 means no timeout.
+    // 'compressed' must be true if the connection uses compressed protocol (CLIENT_COMPRESS).
+    void reset(int fd, unsigned int read_timeout, bool compressed = false);
+
+    // Reads the next packet. Returns payload length and sets 'packet' to the payload,
+    // which stays valid until the next call. Returns packet_error on connection error,
+    // timeout or error packet from server, see errorNumber() and error() then.
+    unsigned long next(const unsigned char*& packet);
+
+    unsigned int errorNumber() const { return m_errno; }
+    const std::string& error() const { return m_error; }
+
+    // Total bytes received from socket, i.e. compressed size for compressed protocol
+    uint64_t bytesRead() const { return m_bytes_read; }
+
+    size_t bufferSize() const { return m_raw.data.size(); }
+
+private:
+    struct Buffer
+    {
+        std::vector<unsigned char> data;
+        // Unread data is [begin, end)
+        size_t begin = 0;
+        size_t end = 0;
+
+        size_t size() const { return end - begin; }
+        const unsigned char* head() const { return data.data() + begin; }
+        // Makes room for 'size' bytes from 'begin', moving unread data to the beginning if needed
+        void reserve(size_t size);
+    };
+
+    // Makes sure that at least 'size' bytes of packet stream are available in stream()
+    bool fill(size_t size);
+    // Makes sure that at least 'size' bytes are received from socket into m_raw
+    bool receive(size_t size);
+    // Unpacks the next compressed frame into m_plain
+    bool inflate();
+
+    Buffer& stream() { return m_compressed ? m_plain : m_raw; }
+
+    bool set_error(unsigned int error_number, const std::string& message);
+    void parse_error_packet(const unsigned char* packet, unsigned long len);
+
+    int m_fd = -1;
+    int m_timeout_ms = -1;
+    unsigned char m_seq = 0;
+    bool m_compressed = false;
+
+    // Data received from socket
+    Buffer m_raw;
+    // Unpacked data of compressed protocol
+    Buffer m_plain;
+
+    std::vector<unsigned char> m_multi_packet;
+
+    unsigned int m_errno = 0;
+    std::string m_error;
+    uint64_t m_bytes_read = 0;
+};
+
+}// slave
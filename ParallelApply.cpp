@@ -0,0 +1,123 @@
+#include "ParallelApply.h"
+#include "table.h"
+
+#include "Logging.h"
+
+using namespace slave;
+
+ParallelApply::ParallelApply(unsigned int threads, size_t queue_size)
+    : m_queue_size(queue_size ? queue_size : 1)
+{
+    if (!threads)
+        threads = 1;
+
+    m_workers.reserve(threads);
+    for (unsigned int i = 0; i < threads; ++i)
+        m_workers.emplace_back(new Worker);
+    for (auto& worker : m_workers)
+        worker->thread = std::thread(&ParallelApply::run, this, std::ref(*worker));
+}
+
+ParallelApply::~ParallelApply()
+{
+    m_stop = true;
+    for (auto& worker : m_workers)
+    {
+        std::lock_guard<std::mutex> l(worker->mutex);
+        worker->cond.notify_all();
+    }
+    for (auto& worker : m_workers)
+        worker->thread.join();
+}
+
+void ParallelApply::push(uint64_t hash, const Table& table, RecordSet&& record_set)
+{
+    Worker& worker = *m_workers[hash % m_workers.size()];
+
+    std::unique_lock<std::mutex> l(worker.mutex);
+    worker.cond.wait(l, [&]() { return worker.queue.size() < m_queue_size; });
+    worker.queue.push_back(Task{&table, std::move(record_set)});
+    worker.cond.notify_all();
+}
+
+void ParallelApply::push(uint64_t hash, uint64_t other_hash, const Table& table, RecordSet&& record_set)
+{
+    if (hash % m_workers.size() == other_hash % m_workers.size())
+        push(hash, table, std::move(record_set));
+    else
+        push_ordered(table, std::move(record_set));
+}
+
+void ParallelApply::push_ordered(const Table& table, RecordSet&& record_set)
+{
+    drain();
+    RecordSet row = std::move(record_set);
+    deliver(table, row);
+}
+
+void ParallelApply::wait()
+{
+    drain();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> l(m_error_mutex);
+        std::swap(error, m_error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ParallelApply::run(Worker& worker)
+{
+    std::unique_lock<std::mutex> l(worker.mutex);
+    while (true)
+    {
+        worker.cond.wait(l, [&]() { return !worker.queue.empty() || m_stop; });
+        // Queued rows are delivered even on stop
+        if (worker.queue.empty())
+            return;
+
+        Task task = std::move(worker.queue.front());
+        worker.queue.pop_front();
+        worker.busy = true;
+        worker.cond.notify_all();
+        l.unlock();
+
+        deliver(*task.table, task.record_set);
+
+        l.lock();
+        worker.busy = false;
+        worker.cond.notify_all();
+    }
+}
+
+void ParallelApply::drain()
+{
+    for (auto& worker : m_workers)
+    {
+        std::unique_lock<std::mutex> l(worker->mutex);
+        worker->cond.wait(l, [&]() { return worker->queue.empty() && !worker->busy; });
+    }
+}
+
+void ParallelApply::deliver(const Table& table, RecordSet& record_set)
+{
+    try
+    {
+        table.m_callback(record_set);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR(log, "Callback of table " << table.full_name << " failed: " << e.what());
+        std::lock_guard<std::mutex> el(m_error_mutex);
+        if (!m_error)
+            m_error = std::current_exception();
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> el(m_error_mutex);
+        if (!m_error)
+            m_error = std::current_exception();
+    }
+}
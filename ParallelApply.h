@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "recordset.h"
+
+namespace slave
+{
+
+class Table;
+
+// Runs table callbacks in a pool of worker threads (see MasterInfo::apply_threads).
+// Each row goes to the worker chosen by its hash (of primary key or, if there is no key,
+// of table name), so all changes of one row, or of one table without key, are delivered
+// in the order of binlog. Rows of different keys may be delivered in any order. Update which
+// changes the key is delivered after all earlier rows and before all later rows of both keys.
+// Replication thread calls wait() on transaction boundaries, so the position is saved
+// only after all rows of the transaction are delivered.
+class ParallelApply
+{
+public:
+    ParallelApply(unsigned int threads, size_t queue_size);
+    ~ParallelApply();
+
+    ParallelApply(const ParallelApply&) = delete;
+    ParallelApply& operator=(const ParallelApply&) = delete;
+
+    unsigned int threads() const { return m_workers.size(); }
+
+    // Queues the row for the callback of the table. Waits if the queue of the worker is full.
+    void push(uint64_t hash, const Table& table, RecordSet&& record_set);
+
+    // Queues the row which belongs to both hashes, i.e. update of primary key.
+    // If they are of different workers, the row is delivered by push_ordered().
+    void push(uint64_t hash, uint64_t other_hash, const Table& table, RecordSet&& record_set);
+
+    // Delivers the row by the calling thread after all queued rows, so it is ordered with all of them
+    // and with rows pushed later. Exception of the callback is rethrown by wait(), as of workers.
+    void push_ordered(const Table& table, RecordSet&& record_set);
+
+    // Waits until all queued rows are delivered. Rethrows the first exception
+    // thrown by callbacks since the previous call.
+    void wait();
+
+private:
+    struct Task
+    {
+        const Table* table;
+        RecordSet record_set;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<Task> queue;
+        bool busy = false;
+        std::thread thread;
+    };
+
+    void run(Worker& worker);
+    // Waits until all queued rows are delivered
+    void drain();
+    // Calls the callback, its exception is kept for wait()
+    void deliver(const Table& table, RecordSet& record_set);
+
+    const size_t m_queue_size;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool> m_stop{false};
+
+    std::mutex m_error_mutex;
+    std::exception_ptr m_error;
+};
+
+}// slave
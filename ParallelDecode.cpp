@@ -0,0 +1,84 @@
+#include "ParallelDecode.h"
+
+using namespace slave;
+
+ParallelDecode::ParallelDecode(unsigned int threads, size_t min_event_size)
+    : m_min_event_size(min_event_size)
+{
+    m_threads.reserve(threads);
+    for (unsigned int i = 0; i < threads; ++i)
+        m_threads.emplace_back(&ParallelDecode::loop, this);
+}
+
+ParallelDecode::~ParallelDecode()
+{
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void ParallelDecode::run(size_t count, const std::function<void (size_t)>& task)
+{
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_active = m_threads.size();
+        ++m_generation;
+    }
+    m_cond.notify_all();
+
+    work();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> l(m_mutex);
+        m_done.wait(l, [&]() { return m_active == 0; });
+        m_task = nullptr;
+        std::swap(error, m_error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ParallelDecode::work()
+{
+    for (size_t i = m_next++; i < m_count; i = m_next++)
+    {
+        try
+        {
+            (*m_task)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+    }
+}
+
+void ParallelDecode::loop()
+{
+    size_t generation = 0;
+    std::unique_lock<std::mutex> l(m_mutex);
+    while (true)
+    {
+        m_cond.wait(l, [&]() { return m_generation != generation || m_stop; });
+        if (m_stop)
+            return;
+        generation = m_generation;
+
+        l.unlock();
+        work();
+        l.lock();
+
+        if (--m_active == 0)
+            m_done.notify_all();
+    }
+}
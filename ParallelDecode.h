@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace slave
+{
+
+// Pool of threads decoding rows of large rows events (see MasterInfo::decode_threads).
+// Rows of an event are found by scanning their null bitmaps and sizes of values first,
+// then ranges of rows are decoded by the pool, and callbacks are called in the order of rows.
+class ParallelDecode
+{
+public:
+    // Events with rows of less than 'min_event_size' bytes are decoded by the calling thread
+    ParallelDecode(unsigned int threads, size_t min_event_size);
+    ~ParallelDecode();
+
+    ParallelDecode(const ParallelDecode&) = delete;
+    ParallelDecode& operator=(const ParallelDecode&) = delete;
+
+    unsigned int threads() const { return m_threads.size(); }
+    size_t min_event_size() const { return m_min_event_size; }
+
+    // Calls task(i) for every i in [0, count) by the threads of the pool and the calling thread,
+    // returns when all calls are done. Rethrows the first exception thrown by them.
+    void run(size_t count, const std::function<void (size_t)>& task);
+
+private:
+    void work();
+    void loop();
+
+    const size_t m_min_event_size;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_done;
+    bool m_stop = false;
+    // Incremented by each run(), wakes up the threads
+    size_t m_generation = 0;
+    // Threads which have not finished the current run() yet
+    size_t m_active = 0;
+
+    const std::function<void (size_t)>* m_task = nullptr;
+    size_t m_count = 0;
+    std::atomic<size_t> m_next{0};
+    std::exception_ptr m_error;
+};
+
+}// slave
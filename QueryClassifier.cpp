@@ -0,0 +1,313 @@
+#include <algorithm>
+
+#include "QueryClassifier.h"
+
+using namespace slave;
+
+namespace
+{
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Characters of unquoted identifiers, bytes of multibyte characters included
+inline bool is_name_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c == '_' || c == '$' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+inline char to_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Name of a statement without backticks, in which "``" stands for one backtick
+struct Name
+{
+    std::string_view text;
+    bool escaped = false;
+
+    void assign_to(std::string& s) const
+    {
+        if (!escaped) {
+            s.assign(text.data(), text.size());
+            return;
+        }
+        s.clear();
+        for (size_t i = 0; i < text.size(); ++i) {
+            s.push_back(text[i]);
+            if (text[i] == '`')
+                ++i;
+        }
+    }
+};
+
+// Tokens of a statement, whitespace and comments before every token are skipped
+class Lexer
+{
+public:
+    explicit Lexer(std::string_view query) : p(query.data()), end(query.data() + query.size()) { skip(); }
+
+    bool done() const { return p == end; }
+
+    // Consumes the keyword if it is the next token, 'word' is in lower case
+    bool keyword(std::string_view word)
+    {
+        if (static_cast<size_t>(end - p) < word.size())
+            return false;
+        for (size_t i = 0; i < word.size(); ++i)
+            if (to_lower(p[i]) != word[i])
+                return false;
+        if (p + word.size() != end && is_name_char(p[word.size()]))
+            return false;
+        p += word.size();
+        skip();
+        return true;
+    }
+
+    bool punct(char c)
+    {
+        if (p == end || *p != c)
+            return false;
+        ++p;
+        skip();
+        return true;
+    }
+
+    bool name(Name& n)
+    {
+        if (p == end)
+            return false;
+
+        if (*p == '`') {
+            const char* begin = ++p;
+            n.escaped = false;
+            for (;; ++p) {
+                if (p == end)
+                    return false;
+                if (*p == '`') {
+                    if (p + 1 == end || p[1] != '`')
+                        break;
+                    n.escaped = true;
+                    ++p;
+                }
+            }
+            n.text = std::string_view(begin, p - begin);
+            ++p;
+        } else {
+            const char* begin = p;
+            while (p != end && is_name_char(*p))
+                ++p;
+            if (p == begin)
+                return false;
+            n.text = std::string_view(begin, p - begin);
+            n.escaped = false;
+        }
+        skip();
+        return true;
+    }
+
+    // [db.]table, db is empty if it is not specified
+    bool table(Name& db, Name& tbl)
+    {
+        db = Name();
+        if (!name(tbl))
+            return false;
+        if (!punct('.'))
+            return true;
+        db = tbl;
+        return name(tbl);
+    }
+
+    // Skips a word, a quoted name or string, or any other character
+    void next()
+    {
+        if (*p == '\'' || *p == '"') {
+            const char quote = *p++;
+            while (p != end) {
+                if (*p == '\\' && p + 1 != end) {
+                    p += 2;
+                } else if (*p == quote) {
+                    ++p;
+                    if (p == end || *p != quote)
+                        break;
+                    ++p;
+                } else {
+                    ++p;
+                }
+            }
+        } else if (*p == '`') {
+            Name n;
+            if (!name(n))
+                p = end;
+            return;
+        } else if (is_name_char(*p)) {
+            while (p != end && is_name_char(*p))
+                ++p;
+        } else {
+            ++p;
+        }
+        skip();
+    }
+
+private:
+    void skip()
+    {
+        while (p != end) {
+            if (is_space(*p)) {
+                ++p;
+            } else if (*p == '#' || (*p == '-' && end - p >= 2 && p[1] == '-' && (end - p == 2 || is_space(p[2])))) {
+                while (p != end && *p != '\n')
+                    ++p;
+            } else if (*p == '/' && end - p >= 2 && p[1] == '*') {
+                // Including /*! ... */, which are executed only by MySQL
+                static const std::string_view close = "*/";
+                const char* q = std::search(p + 2, end, close.begin(), close.end());
+                p = q == end ? end : q + close.size();
+            } else {
+                break;
+            }
+        }
+    }
+
+    const char* p;
+    const char* const end;
+};
+
+void append(const QueryClassifier& classifier, const Name& db, const Name& tbl,
+            std::string_view default_db, std::vector<TableKey>& tables)
+{
+    std::string unescaped;
+    std::string_view db_name = default_db;
+    if (!db.text.empty()) {
+        db_name = db.text;
+        if (db.escaped) {
+            db.assign_to(unescaped);
+            db_name = unescaped;
+        }
+    }
+    if (!classifier.hasDatabase(db_name))
+        return;
+
+    tables.emplace_back();
+    tables.back().db_name.assign(db_name.data(), db_name.size());
+    tbl.assign_to(tables.back().table_name);
+}
+
+}// anonymous-namespace
+
+void QueryClassifier::addDatabase(std::string_view db_name)
+{
+    const auto it = std::lower_bound(m_databases.begin(), m_databases.end(), db_name,
+                                     [](const std::string& a, std::string_view b) { return a < b; });
+    if (it == m_databases.end() || *it != db_name)
+        m_databases.emplace(it, db_name);
+}
+
+bool QueryClassifier::hasDatabase(std::string_view db_name) const
+{
+    const auto it = std::lower_bound(m_databases.begin(), m_databases.end(), db_name,
+                                     [](const std::string& a, std::string_view b) { return a < b; });
+    return it != m_databases.end() && *it == db_name;
+}
+
+QueryKind QueryClassifier::classify(std::string_view query, std::string_view default_db, std::vector<TableKey>& tables) const
+{
+    Lexer lex(query);
+
+    // Most of queries of row based binlog
+    if (lex.keyword("begin"))
+        return QueryKind::Begin;
+    if (lex.keyword("commit"))
+        return QueryKind::Commit;
+
+    QueryKind kind;
+    if (lex.keyword("alter")) {
+        if (!lex.keyword("online"))
+            lex.keyword("offline");
+        lex.keyword("ignore");
+        if (!lex.keyword("table"))
+            return QueryKind::Other;
+        kind = QueryKind::AlterTable;
+    } else if (lex.keyword("create")) {
+        if (lex.keyword("or") && !lex.keyword("replace"))
+            return QueryKind::Other;
+        if (lex.keyword("temporary") || !lex.keyword("table"))
+            return QueryKind::Other;
+        if (lex.keyword("if")) {
+            lex.keyword("not");
+            lex.keyword("exists");
+        }
+        kind = QueryKind::CreateTable;
+    } else if (lex.keyword("rename")) {
+        if (!lex.keyword("table"))
+            return QueryKind::Other;
+        kind = QueryKind::RenameTable;
+    } else if (lex.keyword("drop")) {
+        if (lex.keyword("temporary") || !lex.keyword("table"))
+            return QueryKind::Other;
+        if (lex.keyword("if"))
+            lex.keyword("exists");
+        kind = QueryKind::DropTable;
+    } else {
+        return QueryKind::Other;
+    }
+
+    // Tables are reported only for databases with subscriptions
+    if (m_databases.empty())
+        return kind;
+
+    Name db, tbl;
+    switch (kind) {
+    case QueryKind::AlterTable:
+        if (!lex.table(db, tbl))
+            break;
+        // ALTER TABLE ... RENAME [TO | AS] new_name changes the name of the table
+        while (!lex.done()) {
+            if (!lex.keyword("rename")) {
+                lex.next();
+                continue;
+            }
+            if (lex.keyword("column") || lex.keyword("index") || lex.keyword("key"))
+                continue;
+            if (!lex.keyword("to"))
+                lex.keyword("as");
+            Name new_db, new_tbl;
+            if (lex.table(new_db, new_tbl)) {
+                db = new_db;
+                tbl = new_tbl;
+            }
+        }
+        append(*this, db, tbl, default_db, tables);
+        break;
+
+    case QueryKind::CreateTable:
+        if (lex.table(db, tbl))
+            append(*this, db, tbl, default_db, tables);
+        break;
+
+    case QueryKind::RenameTable:
+        // RENAME TABLE a TO b, c TO d: the new names
+        do {
+            if (!lex.table(db, tbl) || !lex.keyword("to") || !lex.table(db, tbl))
+                break;
+            append(*this, db, tbl, default_db, tables);
+        } while (lex.punct(','));
+        break;
+
+    case QueryKind::DropTable:
+        do {
+            if (!lex.table(db, tbl))
+                break;
+            append(*this, db, tbl, default_db, tables);
+        } while (lex.punct(','));
+        break;
+
+    default:
+        break;
+    }
+    return kind;
+}
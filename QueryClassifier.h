@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TableKey.h"
+
+namespace slave
+{
+
+enum class QueryKind
+{
+    Other,
+    Begin,
+    Commit,
+    AlterTable,
+    CreateTable,
+    RenameTable,
+    DropTable
+};
+
+// Classifies statements of QUERY_EVENT by their leading keywords, to find tables changed by DDL.
+// Whitespace and comments between tokens are skipped, names may be quoted with backticks.
+// Statements on temporary tables are of QueryKind::Other, they are not written to row based binlog.
+class QueryClassifier
+{
+public:
+    // Tables of other databases are not reported by classify()
+    void addDatabase(std::string_view db_name);
+    bool hasDatabase(std::string_view db_name) const;
+
+    // Appends to 'tables' the table created or altered, the new names of renamed tables or
+    // the dropped tables, which are in the added databases. Unqualified names are of 'default_db'.
+    QueryKind classify(std::string_view query, std::string_view default_db, std::vector<TableKey>& tables) const;
+
+private:
+    // Sorted
+    std::vector<std::string> m_databases;
+};
+
+}// slave
@@ -0,0 +1,92 @@
+#include <stdexcept>
+
+#include "RowView.h"
+#include "slave_log_event.h"
+#include "table.h"
+
+#include "Logging.h"
+
+using namespace slave;
+
+const unsigned char* RowView::reset(const Table& table, const unsigned char* row,
+                                    unsigned int colcnt, const std::vector<unsigned char>& cols)
+{
+    if (colcnt != table.fields.size()) {
+        LOG_ERROR(log, "Field count mismatch in unpacking row for "
+                  << table.full_name << ": " << colcnt << " != " << table.fields.size());
+        throw std::runtime_error("RowView::reset failed");
+    }
+
+    m_table = &table;
+    m_row = row;
+    m_offsets.assign(colcnt, absent);
+
+    // Null bitmap has bits only for present columns
+    const unsigned char* null_ptr = row;
+    const unsigned char* ptr = row + (n_set_bits(cols, colcnt) + 7) / 8;
+    unsigned int null_mask = 1U;
+    unsigned char null_bits = *null_ptr++;
+
+    for (unsigned int i = 0; i < colcnt; ++i)
+    {
+        if (!cols.empty() && !(cols[i / 8] & (1 << (i & 7))))
+            continue;
+
+        if ((null_mask & 0xFF) == 0) {
+            null_mask = 1U;
+            null_bits = *null_ptr++;
+        }
+
+        if (null_bits & null_mask) {
+            m_offsets[i] = null;
+        } else {
+            m_offsets[i] = ptr - row;
+            ptr = (const unsigned char*)table.fields[i]->skip((const char*)ptr);
+        }
+
+        null_mask <<= 1;
+    }
+
+    return ptr;
+}
+
+int RowView::index(const std::string& name) const
+{
+    if (!m_table)
+        return -1;
+    for (size_t i = 0; i < m_table->fields.size(); ++i)
+        if (m_table->fields[i]->field_name == name)
+            return i;
+    return -1;
+}
+
+const char* RowView::column(unsigned int i) const
+{
+    if (!has(i))
+        throw std::runtime_error("RowView: column " + std::to_string(i) + " is absent in row of "
+                                 + (m_table ? m_table->full_name : std::string("no table")));
+    return m_offsets[i] == null ? nullptr : (const char*)m_row + m_offsets[i];
+}
+
+FieldValue RowView::value(unsigned int i) const
+{
+    const char* const pos = column(i);
+    if (!pos)
+        return nullFieldValue();
+
+    FieldValue result;
+    m_table->fields[i]->unpack(pos, result);
+    return result;
+}
+
+std::string_view RowView::str(unsigned int i) const
+{
+    const char* const pos = column(i);
+    if (!pos)
+        return std::string_view();
+
+    std::string_view result;
+    if (!m_table->fields[i]->view(pos, result))
+        throw std::runtime_error("RowView: column " + m_table->fields[i]->field_name + " of " + m_table->full_name + " is not a string");
+    return result;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "recordset.h"
+#include "types.h"
+
+namespace slave
+{
+
+class Table;
+
+// One row image of a rows event, decoded lazily: only positions of columns are found
+// when the row is read, values are unpacked when they are accessed.
+// Points into the buffer of the event, so it is valid only inside the callback.
+class RowView
+{
+public:
+    // Finds columns of the image at 'row', returns the end of the image.
+    // 'cols' is the bitmap of columns present in the image, as in Row_event_info.
+    const unsigned char* reset(const Table& table, const unsigned char* row,
+                               unsigned int colcnt, const std::vector<unsigned char>& cols);
+
+    // Makes the view empty, keeps allocated memory
+    void clear()
+    {
+        m_table = nullptr;
+        m_row = nullptr;
+        m_offsets.clear();
+    }
+
+    // Number of columns of the table
+    size_t size() const { return m_offsets.size(); }
+
+    // Index of the column by name, -1 if there is no such column or the view is empty
+    int index(const std::string& name) const;
+
+    // Column is present in the image, see binlog_row_image
+    bool has(unsigned int i) const { return i < m_offsets.size() && m_offsets[i] != absent; }
+    bool isNull(unsigned int i) const { return m_offsets[i] == null; }
+
+    // Unpacks the value of the column, NULL value if the column is NULL.
+    // Throws if the column is absent in the image.
+    FieldValue value(unsigned int i) const;
+
+    // Value of a string column (VARCHAR, CHAR, BLOB, TEXT) without copying, empty if NULL.
+    // Throws if the column is absent or is not a string.
+    std::string_view str(unsigned int i) const;
+
+private:
+    static constexpr uint32_t absent = 0xffffffff;
+    static constexpr uint32_t null = 0xfffffffe;
+
+    // Start of the value of present column, nullptr if it is NULL
+    const char* column(unsigned int i) const;
+
+    const Table* m_table = nullptr;
+    const unsigned char* m_row = nullptr;
+    std::vector<uint32_t> m_offsets;
+};
+
+// Like RecordSet, but with lazily decoded rows, see Slave::setViewCallback.
+// For Update m_old_row is the image before update, for Write and Delete it is empty.
+struct RecordView
+{
+    RowView m_row;
+    RowView m_old_row;
+
+    std::string_view tbl_name;
+    std::string_view db_name;
+
+    time_t when = 0;
+
+    RecordSet::TypeEvent type_event = RecordSet::Write;
+
+    // Root master ID from which this record originated
+    unsigned int master_id = 0;
+};
+
+}// slave
@@ -15,10 +15,8 @@
 
 #include <algorithm>
 #include <memory>
-#include <regex>
 #include <string>
 
-#include "aux/parse_list.h"
 #include "Slave.h"
 #include "SlaveStats.h"
 
@@ -33,6 +31,7 @@
 #include <mysql/sql_common.h>
 
 #include <signal.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #define packet_end_data 1
@@ -151,6 +150,11 @@ void Slave::createDatabaseStructure_(table_order_t& tabs, RelayLogInfo& rli) con
 {
     LOG_TRACE(log, "enter: createDatabaseStructure");
 
+    if (m_master_info.schema_from_table_map) {
+        LOG_INFO(log, "Tables are created from TABLE_MAP events");
+        return;
+    }
+
     nanomysql::Connection conn(m_master_info.conn_options);
     const collate_map_t collate_map = readCollateMap(conn);
 
@@ -208,6 +212,10 @@ void Slave::createTable(RelayLogInfo& rli,
         if (z == i->end())
             throw std::runtime_error("Slave::create_table(): DESCRIBE query did not return 'Null'");
 
+        z = i->find("Key");
+        if (z != i->end() && z->second.data == "PRI")
+            table->primary_key.push_back(table->fields.size());
+
         std::string extract_field;
 
         // Extract field type
@@ -337,6 +345,7 @@ void Slave::createTable(RelayLogInfo& rli,
 
     }
 
+    table->build_plan();
 
     rli.setTable(tbl_name, db_name, std::move(table));
 
@@ -346,6 +355,144 @@ void Slave::createTable(RelayLogInfo& rli,
     }
 }
 
+
+
+void Slave::attachCallbacks(Table& table, const TableKey& key)
+{
+    table.m_callback = m_callbacks[key];
+    table.m_batch_callback = m_batch_callbacks[key];
+    table.m_view_callback = m_view_callbacks[key];
+    table.m_columnar_callback = m_columnar_callbacks[key];
+    table.m_binding = m_bindings[key];
+    if (table.m_binding)
+        table.m_binding->resolve(table);
+    table.m_filter = m_filters[key];
+    table.set_column_filter(m_column_filters[key]);
+    table.row_type = m_row_types[key];
+}
+
+
+
+void Slave::createTableFromMap(const Table_map_event_info& tmi, const TableKey& key)
+{
+    m_map_schema.parse(tmi);
+
+    const auto& current = m_rli.getTable(key);
+    if (current && current->map_schema == m_map_schema.hash())
+        return;
+
+    LOG_INFO(log, "Creating table from TABLE_MAP_EVENT: " << key.db_name << "." << key.table_name);
+
+    // Queued rows refer to the table being rebuilt
+    sync_parallel_apply();
+
+    static const std::vector<unsigned> no_primary_key;
+    const size_t count = m_map_schema.columns().size();
+    const std::vector<std::string>* names = &m_map_schema.names();
+    const std::vector<unsigned>* primary_key = m_map_schema.has_primary_key() ? &m_map_schema.primary_key() : &no_primary_key;
+    std::vector<std::string> positions;
+
+    if (names->empty()) {
+        const ColumnNames& read = columnNames(key);
+        names = &read.names;
+        if (!m_map_schema.has_primary_key())
+            primary_key = &read.primary_key;
+
+        if (names->size() != count) {
+            // Table is already changed on master
+            LOG_WARNING(log, "Table " << key.db_name << "." << key.table_name << " has " << names->size()
+                        << " columns on master and " << count << " in binlog, columns are named by their positions"
+                        << " (@1, @2, ...) and column filter and binding by names fail");
+            for (size_t i = 0; i < count; ++i)
+                positions.push_back("@" + std::to_string(i + 1));
+            names = &positions;
+            primary_key = &no_primary_key;
+        }
+    }
+
+    std::unique_ptr<Table> table(new Table(key.db_name, key.table_name));
+    for (size_t i = 0; i < count; ++i)
+        table->fields.push_back(m_map_schema.create_field(i, (*names)[i]));
+    table->primary_key = *primary_key;
+    table->map_schema = m_map_schema.hash();
+    table->build_plan();
+
+    // Rows are not delivered without the columns they are filtered or bound by,
+    // the table is created again from the next TABLE_MAP_EVENT
+    for (const auto& name : m_column_filters[key]) {
+        const bool found = std::any_of(table->fields.begin(), table->fields.end(),
+                                       [&name](const PtrField& field) { return field->getFieldName() == name; });
+        if (!found) {
+            LOG_ERROR(log, "There is no column " << name << " of column filter in " << table->full_name);
+            throw std::runtime_error("Slave::createTableFromMap(): no column " + name + " in " + table->full_name);
+        }
+    }
+    // Binding throws if its columns are not found
+    attachCallbacks(*table, key);
+
+    Table& created = *table;
+    m_rli.setTable(key.table_name, key.db_name, std::move(table));
+
+    auto it = m_ddl_callbacks.find(key);
+    if (it != m_ddl_callbacks.end()) {
+        it->second(key.db_name, key.table_name, created.fields);
+    }
+}
+
+
+
+void Slave::readColumnNames()
+{
+    m_column_names.clear();
+    if (!m_master_info.schema_from_table_map)
+        return;
+
+    nanomysql::Connection conn(m_master_info.conn_options);
+    for (const auto& key : m_table_order) {
+        LOG_INFO(log, "Reading names of columns of: " << key.db_name << "." << key.table_name);
+        m_column_names[key] = readColumnNames(conn, key);
+    }
+}
+
+
+
+const Slave::ColumnNames& Slave::columnNames(const TableKey& key)
+{
+    auto it = m_column_names.find(key);
+    if (it != m_column_names.end())
+        return it->second;
+
+    LOG_INFO(log, "Reading names of columns of: " << key.db_name << "." << key.table_name);
+    nanomysql::Connection conn(m_master_info.conn_options);
+    return m_column_names[key] = readColumnNames(conn, key);
+}
+
+
+
+Slave::ColumnNames Slave::readColumnNames(nanomysql::Connection& conn, const TableKey& key)
+{
+    nanomysql::Connection::result_t res;
+
+    conn.query("SHOW FULL COLUMNS FROM " + key.table_name + " IN " + key.db_name);
+    conn.store(res);
+
+    ColumnNames result;
+    for (nanomysql::Connection::result_t::const_iterator i = res.begin(); i != res.end(); ++i) {
+
+        std::map<std::string,nanomysql::field>::const_iterator z = i->find("Field");
+        if (z == i->end())
+            throw std::runtime_error("Slave::columnNames(): DESCRIBE query did not return 'Field'");
+
+        std::map<std::string,nanomysql::field>::const_iterator k = i->find("Key");
+        if (k != i->end() && k->second.data == "PRI")
+            result.primary_key.push_back(result.names.size());
+
+        result.names.push_back(z->second.data);
+    }
+
+    return result;
+}
+
 namespace
 {
 struct raii_mysql_connector
@@ -449,10 +596,29 @@ void Slave::get_remote_binlog(const std::function<bool()>& _interruptFlag)
     //connect_to_master(false, &mysql);
 
     register_slave_on_master(&mysql);
+    init_parallel_apply();
+
+    const bool pipelined = m_master_info.pipeline_size != 0;
+    if (pipelined)
+    {
+        std::lock_guard<std::mutex> l(m_slave_thread_mutex);
+        if (!m_ring || m_ring->capacity() != m_master_info.pipeline_size)
+            m_ring.reset(new EventRing(m_master_info.pipeline_size));
+    }
+
+    // Reader thread must not outlive the connection
+    struct reader_stopper
+    {
+        Slave& slave;
+        ~reader_stopper() { slave.stop_reader(); }
+    } __reader_stopper{*this};
 
 connected:
     do_checksum_handshake(&mysql);
 
+    // Transaction is read again from its beginning after reconnect
+    clear_transaction();
+
     // Get binlog position saved in ext_state before, or load it
     // from persistent storage. Get false if failed to get binlog position.
     if(!ext_state.getMasterPosition(m_master_info.position))
@@ -468,6 +634,9 @@ connected:
     LOG_INFO(log, "Starting from binlog_pos: " << m_master_info.position);
 
     request_dump(m_master_info.position, &mysql);
+    init_packet_reader();
+    if (pipelined)
+        start_reader();
     gtid_t gtid_next;
 
     while (!_interruptFlag()) {
@@ -476,7 +645,17 @@ connected:
 
             LOG_TRACE(log, "-- reading event --");
 
-            unsigned long len = read_event(&mysql);
+            unsigned long len = 0;
+            const unsigned char* packet = nullptr;
+            bool checksum_verified = false;
+            if (pipelined) {
+                len = read_event_pipelined(packet, checksum_verified);
+                // No events yet, check interrupt flag and wait again
+                if (len == 0)
+                    continue;
+            } else {
+                len = read_event(&mysql, packet);
+            }
 
             ext_state.setStateProcessing(true);
 
@@ -487,19 +666,19 @@ connected:
 
             if (len == packet_error || len == packet_end_data) {
 
-                uint mysql_error_number = mysql_errno(&mysql);
+                uint mysql_error_number = read_errno();
 
                 switch(mysql_error_number) {
                     case ER_NET_PACKET_TOO_LARGE:
                         LOG_ERROR(log, "Myslave: Log entry on master is longer than max_allowed_packet on "
                                   "slave. If the entry is correct, restart the server with a higher value of "
-                                  "max_allowed_packet. max_allowed_packet=" << mysql_error(&mysql) );
+                                  "max_allowed_packet. max_allowed_packet=" << read_error() );
                         break;
                     case ER_MASTER_FATAL_ERROR_READING_BINLOG: // Error -- unknown binlog file.
-                        LOG_ERROR(log, "Myslave: fatal error reading binlog. " <<  mysql_error(&mysql) );
+                        LOG_ERROR(log, "Myslave: fatal error reading binlog. " <<  read_error() );
                         break;
                     case 2013: // Processing error 'Lost connection to MySQL'
-                        LOG_WARNING(log, "Myslave: Error from MySQL: " << mysql_error(&mysql) );
+                        LOG_WARNING(log, "Myslave: Error from MySQL: " << read_error() );
                         // Check if connection closed by user for exiting from the loop
                         if (_interruptFlag())
                         {
@@ -508,8 +687,8 @@ connected:
                         }
                         break;
                     default:
-                        LOG_ERROR(log, "Myslave: Error reading packet from server: " << mysql_error(&mysql)
-                                << "; mysql_error: " << mysql_errno(&mysql));
+                        LOG_ERROR(log, "Myslave: Error reading packet from server: " << read_error()
+                                << "; mysql_error: " << mysql_error_number);
                         break;
                 }
 
@@ -524,108 +703,366 @@ connected:
                 continue;
             }
 
-            slave::Basic_event_info event;
+            handle_event((const char*) packet + 1, len - 1, gtid_next, !checksum_verified);
 
-            if (!slave::read_log_event((const char*) mysql.net.read_pos + 1,
-                                       len - 1,
-                                       event,
-                                       event_stat,
-                                       masterGe56(),
-                                       m_master_info)) {
+        } catch (const std::exception& _ex ) {
 
-                LOG_TRACE(log, "Skipping unknown event.");
-                continue;
-            }
+            LOG_ERROR(log, "Met exception in get_remote_binlog cycle. Message: " << _ex.what() );
+            if (event_stat)
+                event_stat->tickError();
+            usleep(1000*1000);
+            continue;
 
-            //
+        }
 
-            LOG_TRACE(log, "Event log position: " << event.log_pos );
+    } //while
 
-            if (event.log_pos != 0) {
-                m_master_info.position.log_pos = event.log_pos;
-                ext_state.setLastEventTimePos(event.when, event.log_pos);
-            }
+    LOG_WARNING(log, "Binlog monitor was stopped. Binlog events are not listened.");
 
-            LOG_TRACE(log, "seconds_behind_master: " << (::time(NULL) - event.when) );
+    try {
+        sync_parallel_apply();
+    } catch (const std::exception& _ex) {
+        LOG_ERROR(log, "Met exception in callback. Message: " << _ex.what() );
+    }
 
+    stop_reader();
+    deregister_slave_on_master(&mysql);
+}
 
-            // MySQL5.1.23 binlogs can be read only starting from a XID_EVENT
-            // MySQL5.1.23 ev->log_pos -- the binlog offset
+uint64_t Slave::bytesReceived() const
+{
+    return m_bytes_received.load(std::memory_order_relaxed);
+}
 
-            if (event.type == XID_EVENT) {
+EventRingStats Slave::pipelineStats() const
+{
+    std::lock_guard<std::mutex> l(m_slave_thread_mutex);
+    return m_ring ? m_ring->stats() : EventRingStats();
+}
 
-                if (!gtid_next.first.empty())
-                    m_master_info.position.addGtid(gtid_next);
-                ext_state.setMasterPosition(m_master_info.position);
+void Slave::start_reader()
+{
+    m_reader_stop = false;
+    m_reader_done = false;
+    m_ring_slot_taken = false;
+    // Checksum state is passed by value, processing thread keeps changing it in m_master_info
+    m_reader_thread = std::thread(&Slave::reader_loop, this, m_master_info.checksum_in_reader,
+                                  masterGe56(), m_master_info.checksum_alg);
+}
 
-                LOG_TRACE(log, "Got XID event. Using binlog pos: " << m_master_info.position);
+void Slave::stop_reader()
+{
+    if (!m_reader_thread.joinable())
+        return;
 
-                if (m_xid_callback)
-                    m_xid_callback(event.server_id);
+    m_reader_stop = true;
+    if (!m_reader_done)
+    {
+        // Reader may be blocked on reading, and the connection is not needed anymore
+        if (::shutdown(mysql.net.fd, SHUT_RDWR) != 0)
+            LOG_ERROR(log, "Slave::stop_reader: shutdown: failed shutdown socket: " << errno);
+    }
+    m_ring->wakeup();
+    m_reader_thread.join();
 
-            } else  if (event.type == ROTATE_EVENT) {
+    // Events which were read but not processed will be read again after reconnect
+    m_ring->clear();
+    m_ring_slot_taken = false;
+}
 
-                slave::Rotate_event_info rei(event.buf, event.event_len);
+void Slave::reader_loop(bool verify_checksum, bool master_ge_56, enum_binlog_checksum_alg checksum_alg)
+{
+    LOG_DEBUG(log, "Reader thread started");
 
-                /*
-                 * new_log_ident - new binlog name
-                 * pos - position of the starting event
-                 */
+    while (!m_reader_stop) {
 
-                LOG_INFO(log, "Got rotate event.");
+        const unsigned char* packet = nullptr;
+        const ulong len = read_packet(&mysql, packet);
 
-                /* WTF
-                 */
+        EventRing::Slot* slot = m_ring->acquire(m_reader_stop);
+        if (!slot)
+            break;
 
-                if (event.when == 0) {
+        slot->error = (len == packet_error || len == packet_end_data);
+        slot->len = len;
+        if (slot->error) {
+            // Processing thread will handle the error and reconnect
+            m_reader_done = true;
+            m_ring->publish();
+            LOG_DEBUG(log, "Reader thread finished on error");
+            return;
+        }
 
-                    //LOG_TRACE(log, "ROTATE_FAKE");
-                }
+        if (slot->data.size() < len)
+            slot->data.resize(len);
+        ::memcpy(slot->data.data(), packet, len);
 
-                m_master_info.position.log_name = rei.new_log_ident;
-                m_master_info.position.log_pos = rei.pos; // this will always be equal to 4
+        // Event follows OK byte. Mismatch is left for processing thread to report
+        slot->checksum_verified = verify_checksum && len > 1 && packet[0] == 0
+            && verify_event_checksum((const char*) packet + 1, len - 1, master_ge_56, checksum_alg);
+        m_ring->publish();
+    }
 
-                ext_state.setMasterPosition(m_master_info.position);
+    m_reader_done = true;
+    LOG_DEBUG(log, "Reader thread stopped");
+}
 
-                LOG_TRACE(log, "new position is " << m_master_info.position);
-                LOG_TRACE(log, "ROTATE_EVENT processed OK.");
-            }
-            else if (event.type == GTID_LOG_EVENT)
-            {
-                LOG_TRACE(log, "Got GTID event.");
-                if (!gtid_next.first.empty())
-                {
-                    m_master_info.position.addGtid(gtid_next);
-                    ext_state.setMasterPosition(m_master_info.position);
-                }
-                Gtid_event_info gei(event.buf, event.event_len);
-                LOG_TRACE(log, "GTID_NEXT: sid = " << gei.m_sid << ", gno =  " << gei.m_gno);
-                gtid_next.first = gei.m_sid;
-                gtid_next.second = gei.m_gno;
+ulong Slave::read_event_pipelined(const unsigned char*& packet, bool& checksum_verified)
+{
+    ext_state.setStateProcessing(false);
+
+    // The previous event was processed in place, so its slot is released only now
+    if (m_ring_slot_taken) {
+        m_ring->pop();
+        m_ring_slot_taken = false;
+    }
+
+    EventRing::Slot* slot = m_ring->front(std::chrono::milliseconds(100));
+    if (!slot)
+        return 0;
+
+    const ulong len = slot->len;
+    if (slot->error) {
+        m_ring->pop();
+        // After reader thread is over, read_errno() and read_error() may be used by this thread
+        stop_reader();
+        return len;
+    }
+
+    m_ring_slot_taken = true;
+    packet = slot->data.data();
+    checksum_verified = slot->checksum_verified;
+    return len;
+}
+
+void Slave::get_local_binlog(BinlogFileSource& source, const std::function<bool()>& _interruptFlag)
+{
+    // Start from the saved position, if any, otherwise from the beginning of the first binlog
+    if (ext_state.getMasterPosition(m_master_info.position) && !m_master_info.position.log_name.empty())
+        source.seek(m_master_info.position.log_name, m_master_info.position.log_pos);
+
+    LOG_INFO(log, "Starting from binlog_pos: " << m_master_info.position);
+
+    init_parallel_apply();
+    clear_transaction();
+
+    gtid_t gtid_next;
+    const char* buf = nullptr;
+    unsigned int len = 0;
+
+    while (!_interruptFlag()) {
+
+        // The source can not move past a broken event or file, so reading is not retried
+        try {
+
+            if (!source.next(buf, len))
+                break;
+
+        } catch (const std::exception& _ex) {
+
+            LOG_ERROR(log, "Failed to read local binlog at binlog_pos: " << m_master_info.position << ". Message: " << _ex.what() );
+            if (event_stat)
+                event_stat->tickError();
+            try {
+                sync_parallel_apply();
+            } catch (const std::exception& _cb_ex) {
+                LOG_ERROR(log, "Met exception in callback. Message: " << _cb_ex.what() );
             }
+            throw;
+        }
 
-            if (process_event(event, m_rli))
-            {
-                LOG_TRACE(log, "Error in processing event.");
+        try {
+
+            // There is no master to ask for its version, so take it from binlog
+            if (source.serverVersion() != m_master_version) {
+                m_master_version = source.serverVersion();
+                // since 5.6.4 storage for temporal types has changed
+                m_master_info.is_old_storage = m_master_version < 50604;
             }
 
+            // Binlog may end without ROTATE_EVENT, i.e. after server restart
+            if (m_master_info.position.log_name != source.logName()) {
+                m_master_info.position.log_name = source.logName();
+                m_master_info.position.log_pos = 0;
+            }
 
+            handle_event(buf, len, gtid_next);
 
         } catch (const std::exception& _ex ) {
 
-            LOG_ERROR(log, "Met exception in get_remote_binlog cycle. Message: " << _ex.what() );
+            LOG_ERROR(log, "Met exception in get_local_binlog cycle. Message: " << _ex.what() );
             if (event_stat)
                 event_stat->tickError();
-            usleep(1000*1000);
             continue;
+        }
+    }
+
+    try {
+        sync_parallel_apply();
+    } catch (const std::exception& _ex) {
+        LOG_ERROR(log, "Met exception in callback. Message: " << _ex.what() );
+    }
+
+    LOG_INFO(log, "Finished reading local binlogs at binlog_pos: " << m_master_info.position);
+}
+
+void Slave::handle_event(const char* buf, unsigned int len, gtid_t& gtid_next, bool verify_checksum)
+{
+    slave::Basic_event_info event;
+
+    if (!slave::read_log_event(buf,
+                               len,
+                               event,
+                               event_stat,
+                               masterGe56(),
+                               m_master_info,
+                               verify_checksum)) {
+
+        LOG_TRACE(log, "Skipping unknown event.");
+        return;
+    }
+
+    //
+
+    LOG_TRACE(log, "Event log position: " << event.log_pos );
+
+    if (event.log_pos != 0) {
+        m_master_info.position.log_pos = event.log_pos;
+        ext_state.setLastEventTimePos(event.when, event.log_pos);
+    }
+
+    LOG_TRACE(log, "seconds_behind_master: " << (::time(NULL) - event.when) );
+
+
+    // MySQL5.1.23 binlogs can be read only starting from a XID_EVENT
+    // MySQL5.1.23 ev->log_pos -- the binlog offset
 
+    if (event.type == XID_EVENT) {
+
+        // Transaction is over only when all its rows are delivered
+        sync_parallel_apply();
+
+        if (!gtid_next.first.empty())
+            m_master_info.position.addGtid(gtid_next);
+
+        deliver_transaction(event, gtid_next);
+
+        ext_state.setMasterPosition(m_master_info.position);
+
+        LOG_TRACE(log, "Got XID event. Using binlog pos: " << m_master_info.position);
+
+        if (m_xid_callback)
+            m_xid_callback(event.server_id);
+
+    } else  if (event.type == ROTATE_EVENT) {
+
+        slave::Rotate_event_info rei(event.buf, event.event_len);
+
+        /*
+         * new_log_ident - new binlog name
+         * pos - position of the starting event
+         */
+
+        LOG_INFO(log, "Got rotate event.");
+
+        /* WTF
+         */
+
+        if (event.when == 0) {
+
+            //LOG_TRACE(log, "ROTATE_FAKE");
         }
 
-    } //while
+        sync_parallel_apply();
 
-    LOG_WARNING(log, "Binlog monitor was stopped. Binlog events are not listened.");
+        m_master_info.position.log_name = rei.new_log_ident;
+        m_master_info.position.log_pos = rei.pos; // this will always be equal to 4
 
-    deregister_slave_on_master(&mysql);
+        ext_state.setMasterPosition(m_master_info.position);
+
+        LOG_TRACE(log, "new position is " << m_master_info.position);
+        LOG_TRACE(log, "ROTATE_EVENT processed OK.");
+    }
+    else if (event.type == GTID_LOG_EVENT)
+    {
+        LOG_TRACE(log, "Got GTID event.");
+        if (!gtid_next.first.empty())
+        {
+            sync_parallel_apply();
+            m_master_info.position.addGtid(gtid_next);
+            ext_state.setMasterPosition(m_master_info.position);
+        }
+        m_gei.parse(event.buf, event.event_len);
+        LOG_TRACE(log, "GTID_NEXT: sid = " << m_gei.m_sid << ", gno =  " << m_gei.m_gno);
+        gtid_next.first = m_gei.m_sid;
+        gtid_next.second = m_gei.m_gno;
+    }
+    else if (event.type == QUERY_EVENT && !m_transaction.records.empty())
+    {
+        // Non-transactional tables are changed between BEGIN and COMMIT queries
+        m_qei.parse(event.buf, event.event_len);
+        if (m_qei.query == "COMMIT")
+            deliver_transaction(event, gtid_next);
+    }
+
+    if (process_event(event, m_rli))
+    {
+        LOG_TRACE(log, "Error in processing event.");
+    }
+}
+
+void Slave::deliver_transaction(const Basic_event_info& bei, const gtid_t& gtid)
+{
+    if (m_transaction.records.empty())
+        return;
+
+    m_transaction.log_name = m_master_info.position.log_name;
+    m_transaction.log_pos = m_master_info.position.log_pos;
+    m_transaction.gtid = gtid;
+    m_transaction.when = bei.when;
+    m_transaction.master_id = bei.server_id;
+
+    try
+    {
+        m_transaction_callback(m_transaction);
+    }
+    catch (...)
+    {
+        clear_transaction();
+        throw;
+    }
+    clear_transaction();
+}
+
+void Slave::clear_transaction()
+{
+    // Rows are destroyed before their memory is released
+    m_transaction.records.clear();
+    m_arena.release();
+}
+
+void Slave::init_parallel_apply()
+{
+    if (!m_master_info.decode_threads)
+        m_parallel_decode.reset();
+    else if (!m_parallel_decode || m_parallel_decode->threads() != m_master_info.decode_threads
+             || m_parallel_decode->min_event_size() != m_master_info.decode_min_event_size)
+        m_parallel_decode.reset(new ParallelDecode(m_master_info.decode_threads, m_master_info.decode_min_event_size));
+
+    if (!m_master_info.apply_threads)
+    {
+        m_parallel_apply.reset();
+        return;
+    }
+
+    if (!m_parallel_apply || m_parallel_apply->threads() != m_master_info.apply_threads)
+        m_parallel_apply.reset(new ParallelApply(m_master_info.apply_threads, m_master_info.apply_queue_size));
+}
+
+void Slave::sync_parallel_apply()
+{
+    if (m_parallel_apply)
+        m_parallel_apply->wait();
 }
 
 void Slave::register_slave_on_master(MYSQL* mysql)
@@ -792,73 +1229,6 @@ void Slave::do_checksum_handshake(MYSQL* mysql)
 
 
 
-namespace
-{
-// returns table key list (db name + table name) based on query and default database name
-std::vector<slave::TableKey> checkAlterOrCreateQuery(const slave::Query_event_info& qei)
-{
-    static const std::regex replace_regex(R"(/\*.*?\*/)", std::regex_constants::optimize);
-    static const std::regex alter_rename_regex(R"((?:alter\s+table\s+.*rename\s+)(?:to\s+|as\s+)?(?:`?(\w+)`?\.)?`?(\w+)`?)",
-                                               std::regex_constants::optimize | std::regex_constants::icase);
-    static const std::regex rename_regex(R"((?:rename\s+table\s+)(?:`?\w+`?\.)?`?(?:\w+)`?(?:\s+to\s+)(?:`?(\w+)`?\.)?`?(\w+)`?)",
-                                         std::regex_constants::optimize | std::regex_constants::icase);
-    static const std::regex rename_sub_regex(R"((?:`?\w+`?\.)?`?(?:\w+)`?(?:\s+to\s+)(?:`?(\w+)`?\.)?`?(\w+)`?)",
-                                             std::regex_constants::optimize | std::regex_constants::icase);
-    static const std::regex common_regex(R"((?:alter\s+table|create\s+table(?:\s+if\s+not\s+exists)?)\s+(?:`?(\w+)`?\.)?`?(\w+)`?)",
-                                         std::regex_constants::optimize | std::regex_constants::icase);
-
-    // replace newlines and comments to whitespaces
-    std::string s;
-    std::replace_copy(qei.query.begin(), qei.query.end(), std::back_inserter(s), '\n', ' ');
-    s = std::regex_replace(s, replace_regex, " ");
-
-    std::vector<TableKey> tableKeys;
-    std::smatch sm;
-    // check statement on ALTER TABLE ... RENAME ...
-    if (std::regex_search(s, sm, alter_rename_regex))
-    {
-        tableKeys.emplace_back(sm[1], sm[2]);
-    }
-    // check statement on RENAME TABLE ... TO ..., ... TO ..., ...
-    else if (std::regex_search(s, sm, rename_regex))
-    {
-        tableKeys.emplace_back(sm[1], sm[2]);
-        bool first = true;
-        aux::parse_list(s.c_str(), [&first, &tableKeys](std::string_view sub)
-        {
-            if (first)
-            {
-                first = false;
-                return;
-            }
-
-            std::match_results<std::string_view::const_iterator> sm;
-            if (std::regex_search(sub.begin(), sub.end(), sm, rename_sub_regex))
-            {
-                tableKeys.emplace_back(sm[1], sm[2]);
-            }
-        });
-    }
-    // check statement on CREATE or common ALTER
-    else if (std::regex_search(s, sm, common_regex))
-    {
-        tableKeys.emplace_back(sm[1], sm[2]);
-    }
-
-    // if database name wasn't explicitly specified in query, take default database name
-    for (auto& tableKey: tableKeys)
-    {
-        if (tableKey.db_name.empty())
-        {
-            tableKey.db_name = qei.db_name;
-        }
-    }
-    return tableKeys;
-}
-}// anonymouos-namespace
-
-
-
 int Slave::process_event(const slave::Basic_event_info& bei, RelayLogInfo& m_rli)
 {
 
@@ -873,26 +1243,41 @@ int Slave::process_event(const slave::Basic_event_info& bei, RelayLogInfo& m_rli
     {
         // Check for ALTER TABLE or CREATE TABLE
 
-        slave::Query_event_info qei(bei.buf, bei.event_len);
+        m_qei.parse(bei.buf, bei.event_len);
 
-        LOG_TRACE(log, "Received QUERY_EVENT: " << qei.query);
+        LOG_TRACE(log, "Received QUERY_EVENT: " << m_qei.query);
 
-        const auto& tableKeys = checkAlterOrCreateQuery(qei);
-        for (const auto& key : tableKeys)
+        m_ddl_tables.clear();
+        const QueryKind kind = m_query_classifier.classify(m_qei.query, m_qei.db_name, m_ddl_tables);
+        for (const auto& key : m_ddl_tables)
         {
-            if (m_table_order.count(key) == 1)
+            if (m_table_order.count(key) == 0)
+                continue;
+
+            if (m_master_info.schema_from_table_map)
+            {
+                // Table is created again from its next TABLE_MAP_EVENT, with names read again
+                m_column_names.erase(key);
+                const auto& table = m_rli.getTable(key);
+                if (table)
+                    table->map_schema = 0;
+                m_rli.m_table_cache.clear();
+            }
+            else if (kind == QueryKind::DropTable)
             {
+                // Table is rebuilt when it is created again
+                LOG_INFO(log, "Replicated table is dropped: " << key.db_name << "." << key.table_name);
+            }
+            else
+            {
+                // Queued rows refer to the table being rebuilt
+                sync_parallel_apply();
                 LOG_DEBUG(log, "Rebuilding database structure: " << key.first << "." << key.second);
                 table_order_t order {key};
                 createDatabaseStructure_(order, m_rli);
                 auto it = m_rli.m_table_map.find(key);
                 if (it != m_rli.m_table_map.end())
-                {
-                    it->second->m_callback = m_callbacks[key];
-                    it->second->m_filter = m_filters[key];
-                    it->second->set_column_filter(m_column_filters[key]);
-                    it->second->row_type = m_row_types[key];
-                }
+                    attachCallbacks(*it->second, key);
             }
         }
         break;
@@ -902,46 +1287,79 @@ int Slave::process_event(const slave::Basic_event_info& bei, RelayLogInfo& m_rli
     {
         LOG_TRACE(log, "Got TABLE_MAP_EVENT.");
 
-        slave::Table_map_event_info tmi(bei.buf, bei.event_len);
+        m_tmi.parse_header(bei.buf, bei.event_len);
+        const Table_map_event_info& tmi = m_tmi;
 
-        const TableKey table_key{tmi.m_dbnam, tmi.m_tblnam};
+        // Transactions map the same tables again and again: nothing to do if the event is not changed
+        Table* mapped = nullptr;
+        if (m_rli.isTableMapProcessed(tmi.m_table_id, tmi.m_hash, tmi.m_body, mapped)) {
+            if (!mapped)
+                LOG_TRACE(log, "Ignoring TABLE_MAP_EVENT for unreplicated table");
+            else if (event_stat)
+                event_stat->processTableMap(tmi.m_table_id, mapped->table_name, mapped->database_name);
+            break;
+        }
+
+        m_tmi.parse_body(bei.buf, bei.event_len);
+
+        m_table_key.db_name = tmi.m_dbnam;
+        m_table_key.table_name = tmi.m_tblnam;
+        const TableKey& table_key = m_table_key;
         if (m_table_order.find(table_key) == m_table_order.cend()) {
             LOG_TRACE(log, "Ignoring TABLE_MAP_EVENT for unreplicated table");
+            m_rli.setIgnoredTableId(tmi.m_table_id, tmi.m_hash, tmi.m_body);
             break;
         }
 
-        m_rli.setTableName(tmi.m_table_id, tmi.m_tblnam, tmi.m_dbnam);
+        // Before the table id is cached, creating a table drops the cache
+        if (m_master_info.schema_from_table_map)
+            createTableFromMap(tmi, table_key);
+
+        m_rli.setTableName(tmi.m_table_id, tmi.m_tblnam, tmi.m_dbnam, tmi.m_hash, tmi.m_body);
 
         if (m_master_version >= 50604)
         {
             const auto& table = m_rli.getTable(table_key);
-            if (table && tmi.m_cols_types.size() == table->fields.size())
+            if (table && tmi.m_width == table->fields.size())
             {
+                bool changed = false;
                 int i = 0;
-                for (const auto& x : tmi.m_cols_types)
+                for (unsigned long n = 0; n < tmi.m_width; ++n)
                 {
-                    switch (x)
+                    bool old_storage;
+                    switch (tmi.m_cols_types[n])
                     {
                     case MYSQL_TYPE_TIMESTAMP:
                     case MYSQL_TYPE_DATETIME:
                     case MYSQL_TYPE_TIME:
-                        static_cast<Field_temporal*>(table->fields[i].get())->reset(true);
+                        old_storage = true;
                         break;
                     case MYSQL_TYPE_TIMESTAMP2:
                     case MYSQL_TYPE_DATETIME2:
                     case MYSQL_TYPE_TIME2:
-                        static_cast<Field_temporal*>(table->fields[i].get())->reset(false);
+                        old_storage = false;
                         break;
                     default:
-                        break;
+                        i++;
+                        continue;
+                    }
+
+                    auto field = static_cast<Field_temporal*>(table->fields[i].get());
+                    if (field->old_storage() != old_storage)
+                    {
+                        field->reset(old_storage);
+                        changed = true;
                     }
                     i++;
                 }
+
+                if (changed)
+                    table->build_plan();
             }
         }
 
         if (event_stat)
-            event_stat->processTableMap(tmi.m_table_id, tmi.m_tblnam, tmi.m_dbnam);
+            event_stat->processTableMap(tmi.m_table_id, table_key.table_name, table_key.db_name);
 
         break;
     }
@@ -957,9 +1375,17 @@ int Slave::process_event(const slave::Basic_event_info& bei, RelayLogInfo& m_rli
                                   bei.type == DELETE_ROWS_EVENT_V1 || bei.type == DELETE_ROWS_EVENT ? "DELETE" :
                                   "UPDATE") << "_ROWS_EVENT");
 
-        Row_event_info roi(bei.buf, bei.event_len, (bei.type == UPDATE_ROWS_EVENT_V1 || bei.type == UPDATE_ROWS_EVENT), masterGe56());
+        // Most of row events are usually for not replicated tables
+        if (skip_row_event(m_rli, bei, event_stat))
+            break;
+
+        m_roi.parse(bei.buf, bei.event_len, (bei.type == UPDATE_ROWS_EVENT_V1 || bei.type == UPDATE_ROWS_EVENT), masterGe56());
+        const Row_event_info& roi = m_roi;
 
-        apply_row_event(m_rli, bei, roi, ext_state, event_stat);
+        if (m_transaction_callback)
+            apply_row_event(m_rli, bei, roi, ext_state, event_stat, nullptr, &m_transaction, m_parallel_decode.get());
+        else
+            apply_row_event(m_rli, bei, roi, ext_state, event_stat, m_parallel_apply.get(), nullptr, m_parallel_decode.get());
 
         break;
     }
@@ -1033,27 +1459,66 @@ void Slave::request_dump(const Position& pos, MYSQL* mysql)
     }
 }
 
-ulong Slave::read_event(MYSQL* mysql)
+void Slave::init_packet_reader()
 {
+    // Receive window is negotiated on connect, so a larger buffer set now helps only
+    // within the window scale chosen by kernel for the default buffer
+    if (m_master_info.socket_rcvbuf > 0
+        && ::setsockopt(mysql.net.fd, SOL_SOCKET, SO_RCVBUF, &m_master_info.socket_rcvbuf, sizeof(m_master_info.socket_rcvbuf)) != 0)
+        LOG_WARNING(log, "Can't set SO_RCVBUF to " << m_master_info.socket_rcvbuf << ": " << errno);
 
-    ulong len;
+    m_native_reading = false;
+    if (!m_master_info.native_reader)
+        return;
+
+    if (mysql_get_ssl_cipher(&mysql))
+    {
+        LOG_WARNING(log, "Connection to master uses SSL, binlog is read by libmysqlclient");
+        return;
+    }
+
+    if (!m_packet_reader || m_packet_reader->bufferSize() < m_master_info.read_buffer_size)
+        m_packet_reader.reset(new PacketReader(m_master_info.read_buffer_size));
+    // Server may refuse compression, so the actual protocol is taken from the connection
+    m_packet_reader->reset(mysql.net.fd, m_master_info.conn_options.mysql_read_timeout, mysql.net.compress);
+    m_native_reading = true;
+}
+
+ulong Slave::read_event(MYSQL* mysql, const unsigned char*& packet)
+{
     ext_state.setStateProcessing(false);
+    return read_packet(mysql, packet);
+}
+
+ulong Slave::read_packet(MYSQL* mysql, const unsigned char*& packet)
+{
+
+    ulong len;
 
+    if (m_native_reading) {
+        const uint64_t bytes_read = m_packet_reader->bytesRead();
+        len = m_packet_reader->next(packet);
+        m_bytes_received.fetch_add(m_packet_reader->bytesRead() - bytes_read, std::memory_order_relaxed);
+    } else {
 #if MYSQL_VERSION_ID < 50705
-    len = cli_safe_read(mysql);
+        len = cli_safe_read(mysql);
 #else
-    len = cli_safe_read(mysql, nullptr);
+        len = cli_safe_read(mysql, nullptr);
 #endif
+        packet = mysql->net.read_pos;
+        if (len != packet_error)
+            m_bytes_received.fetch_add(len + NET_HEADER_SIZE, std::memory_order_relaxed);
+    }
 
     if (len == packet_error) {
-        LOG_ERROR(log, "Myslave: Error reading packet from server: " << mysql_error(mysql)
-                  << "; mysql_error: " << mysql_errno(mysql));
+        LOG_ERROR(log, "Myslave: Error reading packet from server: " << read_error()
+                  << "; mysql_error: " << read_errno());
 
         return packet_error;
     }
 
     // check for end-of-data
-    if (len < 8 && mysql->net.read_pos[0] == 254) {
+    if (len < 8 && packet[0] == 254) {
 
         LOG_ERROR(log, "read_event(): end of data\n");
         return packet_end_data;
@@ -1062,6 +1527,16 @@ ulong Slave::read_event(MYSQL* mysql)
     return len;
 }
 
+unsigned int Slave::read_errno()
+{
+    return m_native_reading ? m_packet_reader->errorNumber() : mysql_errno(&mysql);
+}
+
+std::string Slave::read_error()
+{
+    return m_native_reading ? m_packet_reader->error() : std::string(mysql_error(&mysql));
+}
+
 void Slave::generateSlaveId()
 {
 
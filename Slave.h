@@ -27,17 +27,28 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <thread>
 
 #include <pthread.h>
 
 #include <mysql/mysql.h>
 
 #include "binlog_pos.h"
+#include "BinlogFileSource.h"
+#include "EventRing.h"
+#include "ParallelApply.h"
+#include "ParallelDecode.h"
+#include "PacketReader.h"
+#include "QueryClassifier.h"
 #include "slave_log_event.h"
 #include "SlaveStats.h"
 #include "TableKey.h"
+#include "TableMapSchema.h"
+#include "TypedBinding.h"
 
 
 namespace slave
@@ -50,6 +61,10 @@ public:
 
     typedef std::set<TableKey> table_order_t;
     typedef std::map<TableKey, callback> callbacks_t;
+    typedef std::map<TableKey, batch_callback> batch_callbacks_t;
+    typedef std::map<TableKey, view_callback> view_callbacks_t;
+    typedef std::map<TableKey, columnar_callback> columnar_callbacks_t;
+    typedef std::map<TableKey, std::shared_ptr<RowBinding>> bindings_t;
     typedef std::map<TableKey, filter> filters_t;
     typedef std::map<TableKey, ddl_callback> ddl_callbacks_t;
 
@@ -73,6 +88,10 @@ private:
 
     table_order_t m_table_order;
     callbacks_t m_callbacks;
+    batch_callbacks_t m_batch_callbacks;
+    view_callbacks_t m_view_callbacks;
+    columnar_callbacks_t m_columnar_callbacks;
+    bindings_t m_bindings;
     ddl_callbacks_t m_ddl_callbacks;
     filters_t m_filters;
     column_filters_t m_column_filters;
@@ -81,10 +100,54 @@ private:
     typedef std::function<void (unsigned int)> xid_callback_t;
     xid_callback_t m_xid_callback;
 
+    transaction_callback m_transaction_callback;
+    // Memory of rows of RowType::Arena of the current transaction
+    std::pmr::monotonic_buffer_resource m_arena;
+    // Rows of the current transaction, if m_transaction_callback is set
+    Transaction m_transaction;
+
     RelayLogInfo m_rli;
 
+    // Parsed events, reused so that steady state replication does not allocate
+    Query_event_info m_qei;
+    Table_map_event_info m_tmi;
+    Row_event_info m_roi;
+    Gtid_event_info m_gei;
+    TableKey m_table_key;
+
+    // Finds tables of m_table_order changed by DDL statements
+    QueryClassifier m_query_classifier;
+    std::vector<TableKey> m_ddl_tables;
+
+    // Names of columns and primary key read from master for tables created from TABLE_MAP_EVENT,
+    // see MasterInfo::schema_from_table_map
+    struct ColumnNames
+    {
+        std::vector<std::string> names;
+        std::vector<unsigned> primary_key;
+    };
+    std::map<TableKey, ColumnNames> m_column_names;
+    TableMapSchema m_map_schema;
+
+    // See MasterInfo::apply_threads
+    std::unique_ptr<ParallelApply> m_parallel_apply;
+    // See MasterInfo::decode_threads
+    std::unique_ptr<ParallelDecode> m_parallel_decode;
+
     pthread_t m_slave_thread_id = 0;
-    std::mutex m_slave_thread_mutex;
+    mutable std::mutex m_slave_thread_mutex;
+
+    // Pipelined mode, see MasterInfo::pipeline_size
+    std::unique_ptr<EventRing> m_ring;
+    std::thread m_reader_thread;
+    std::atomic<bool> m_reader_stop{false};
+    std::atomic<bool> m_reader_done{false};
+    bool m_ring_slot_taken = false;
+
+    // Built-in protocol reader, see MasterInfo::native_reader
+    std::unique_ptr<PacketReader> m_packet_reader;
+    bool m_native_reading = false;
+    std::atomic<uint64_t> m_bytes_received{0};
 
     void createDatabaseStructure_(table_order_t& tabs, RelayLogInfo& rli) const;
 
@@ -111,6 +174,8 @@ public:
     // Reads current binlog position from database
     Position getLastBinlogPos() const;
 
+    // RecordSet passed to the callback is reused for the next rows of the table to avoid allocations,
+    // so it must be copied or moved from to be kept after the callback returns.
     void setCallback(const std::string& _db_name, const std::string& _tbl_name, callback _callback,
                      const cols_t& column_filter, RowType row_type = RowType::Map, EventKind filter = eAll)
     {
@@ -123,7 +188,12 @@ public:
     {
         const TableKey key{_db_name, _tbl_name};
         m_table_order.insert(key);
+        m_query_classifier.addDatabase(_db_name);
         m_callbacks[key] = _callback;
+        m_batch_callbacks.erase(key);
+        m_view_callbacks.erase(key);
+        m_columnar_callbacks.erase(key);
+        m_bindings.erase(key);
         m_filters[key] = filter;
         m_column_filters[key] = cols_t();
         m_row_types[key] = row_type;
@@ -131,6 +201,64 @@ public:
         ext_state.initTableCount(_db_name + "." + _tbl_name);
     }
 
+    // Like setCallback(), but the callback gets all rows of one rows event at once.
+    // The vector and its RecordSets are reused for the next events of the table,
+    // so rows must be moved out of it to be kept after the callback returns.
+    // The callback is called in the replication thread even if MasterInfo::apply_threads is set.
+    void setBatchCallback(const std::string& _db_name, const std::string& _tbl_name, batch_callback _callback,
+                          RowType row_type = RowType::Map, EventKind filter = eAll)
+    {
+        setCallback(_db_name, _tbl_name, callback(), row_type, filter);
+        m_batch_callbacks[{_db_name, _tbl_name}] = _callback;
+    }
+
+    void setBatchCallback(const std::string& _db_name, const std::string& _tbl_name, batch_callback _callback,
+                          const cols_t& column_filter, RowType row_type = RowType::Map, EventKind filter = eAll)
+    {
+        setBatchCallback(_db_name, _tbl_name, _callback, row_type, filter);
+        m_column_filters[{_db_name, _tbl_name}] = column_filter;
+    }
+
+    // Like setCallback(), but rows are not unpacked in advance: RecordView points into the event
+    // and unpacks only the columns which are accessed, strings may be read without copying.
+    // Column filter is not needed then. RecordView is valid only inside the callback.
+    // The callback is called in the replication thread even if MasterInfo::apply_threads is set.
+    void setViewCallback(const std::string& _db_name, const std::string& _tbl_name, view_callback _callback,
+                         EventKind filter = eAll)
+    {
+        setCallback(_db_name, _tbl_name, callback(), RowType::Map, filter);
+        m_view_callbacks[{_db_name, _tbl_name}] = _callback;
+    }
+
+    // Like setBatchCallback(), but rows of the event are unpacked by columns into typed arrays,
+    // without FieldValue. Only columns from column_filter are unpacked, if it is not empty.
+    // ColumnarBatch is reused for the next events of the table.
+    // The callback is called in the replication thread even if MasterInfo::apply_threads is set.
+    void setColumnarCallback(const std::string& _db_name, const std::string& _tbl_name, columnar_callback _callback,
+                             const cols_t& column_filter = cols_t(), EventKind filter = eAll)
+    {
+        setCallback(_db_name, _tbl_name, callback(), column_filter, RowType::Vector, filter);
+        m_columnar_callbacks[{_db_name, _tbl_name}] = _callback;
+    }
+
+    // Decodes rows of the table straight into struct Row and calls _callback(TypedRecordSet<Row>&).
+    // Columns are bound to members by pairs of arguments:
+    //     slave.bind<MyRow>("db", "tbl", callback, &MyRow::id, "id", &MyRow::price, "price");
+    // Members may be integers, floating point, decimal::Decimal, std::string, std::string_view
+    // (valid only inside the callback) or std::optional of them to distinguish NULL.
+    // Columns are resolved by createDatabaseStructure() (or on TABLE_MAP_EVENT of the table,
+    // see MasterInfo::schema_from_table_map), which throws std::runtime_error
+    // if a column does not exist, is bound twice or its type does not match the member:
+    // integer members must be as wide as the column and signed for signed columns,
+    // DOUBLE columns are not bound to float.
+    // The callback is called in the replication thread even if MasterInfo::apply_threads is set.
+    template <typename Row, typename Callback, typename... Columns>
+    void bind(const std::string& _db_name, const std::string& _tbl_name, Callback _callback, const Columns&... columns)
+    {
+        setCallback(_db_name, _tbl_name, callback());
+        m_bindings[{_db_name, _tbl_name}] = make_binding<Row>(std::move(_callback), columns...);
+    }
+
     void setDDLCallback(const std::string& _db_name, const std::string& _tbl_name, ddl_callback _callback)
     {
         m_ddl_callbacks[{_db_name, _tbl_name}] = _callback;
@@ -141,20 +269,37 @@ public:
         m_xid_callback = _callback;
     }
 
+    // Rows of the tables set by setCallback() are collected and passed to this callback
+    // all at once on the end of each transaction, before XID callback and before the position
+    // is saved in ext_state. Table callbacks are not called then, and apply threads are not used.
+    // Filters of event kinds and columns are applied as usual.
+    // Rows of tables with RowType::Arena are allocated from memory released at once
+    // after the callback, see Transaction::arena.
+    void setTransactionCallback(transaction_callback _callback)
+    {
+        m_transaction_callback = _callback;
+        m_transaction.arena = &m_arena;
+    }
+
     void get_remote_binlog(const std::function<bool()>& _interruptFlag = &Slave::falseFunction);
 
+    // Processes events from local binlog files instead of master, see BinlogFileSource.
+    // Starts from the position from ext_state, if any, and returns when all files are read.
+    // Master version is taken from binlogs, so init() is not needed, but table structures
+    // are still read from master by createDatabaseStructure(), unless they are created from binlog,
+    // see MasterInfo::schema_from_table_map.
+    // Exceptions of callbacks are logged and skipped, errors of reading binlogs are rethrown.
+    void get_local_binlog(BinlogFileSource& source, const std::function<bool()>& _interruptFlag = &Slave::falseFunction);
+
     void createDatabaseStructure() {
 
         m_rli.clear();
+        readColumnNames();
 
         createDatabaseStructure_(m_table_order, m_rli);
 
-        for (RelayLogInfo::name_to_table_t::iterator i = m_rli.m_table_map.begin(); i != m_rli.m_table_map.end(); ++i) {
-            i->second->m_callback = m_callbacks[i->first];
-            i->second->m_filter = m_filters[i->first];
-            i->second->set_column_filter(m_column_filters[i->first]);
-            i->second->row_type = m_row_types[i->first];
-        }
+        for (RelayLogInfo::name_to_table_t::iterator i = m_rli.m_table_map.begin(); i != m_rli.m_table_map.end(); ++i)
+            attachCallbacks(*i->second, i->first);
     }
 
     table_order_t getTableOrder() const {
@@ -174,6 +319,16 @@ public:
     // You should take care that interruptFlag will return 'true' after connection is closed.
     void close_connection();
 
+    // Queue state between network reading and processing threads in pipelined mode.
+    // Can be called from any thread.
+    EventRingStats pipelineStats() const;
+
+    // Bytes of binlog stream received from master since creation of the Slave.
+    // Built-in reader counts bytes read from socket (compressed, if compression is on),
+    // libmysqlclient reader counts bytes of packets (after decompression).
+    // Can be called from any thread.
+    uint64_t bytesReceived() const;
+
 protected:
 
 
@@ -184,15 +339,52 @@ protected:
 
     int process_event(const slave::Basic_event_info& bei, RelayLogInfo& rli);
 
+    // Parses event, tracks master position and passes event to process_event()
+    void handle_event(const char* buf, unsigned int len, gtid_t& gtid_next, bool verify_checksum = true);
+
+    // Passes collected rows to the transaction callback, if any
+    void deliver_transaction(const Basic_event_info& bei, const gtid_t& gtid);
+    // Drops collected rows and releases the arena
+    void clear_transaction();
+
+    // Creates threads of apply and decode, if they are set in MasterInfo
+    void init_parallel_apply();
+    // Waits until rows queued for apply threads are delivered
+    void sync_parallel_apply();
+
     void request_dump_wo_gtid(const std::string& logname, unsigned long start_position, MYSQL* mysql);
     void request_dump(const Position& pos, MYSQL* mysql);
 
-    ulong read_event(MYSQL* mysql);
+    // Sets up the connection socket and chooses the reader of binlog stream after request_dump()
+    void init_packet_reader();
+    ulong read_event(MYSQL* mysql, const unsigned char*& packet);
+    ulong read_packet(MYSQL* mysql, const unsigned char*& packet);
+    // Error of the last read_event()
+    unsigned int read_errno();
+    std::string read_error();
+
+    void start_reader();
+    void stop_reader();
+    void reader_loop(bool verify_checksum, bool master_ge_56, enum_binlog_checksum_alg checksum_alg);
+    // Takes the next packet read by the reader thread, returns 0 if there is no packet yet.
+    ulong read_event_pipelined(const unsigned char*& packet, bool& checksum_verified);
 
     void createTable(RelayLogInfo& rli,
                      const std::string& db_name, const std::string& tbl_name,
                      const collate_map_t& collate_map, nanomysql::Connection& conn) const;
 
+    // Sets callbacks, filters and row type of the table
+    void attachCallbacks(Table& table, const TableKey& key);
+
+    // Creates the table from TABLE_MAP_EVENT, unless it is already created from the same column types
+    void createTableFromMap(const Table_map_event_info& tmi, const TableKey& key);
+    // Reads names of columns of all replicated tables by createDatabaseStructure(),
+    // if tables are created from TABLE_MAP_EVENT
+    void readColumnNames();
+    // Names of columns read by readColumnNames(), or read again after DDL of the table
+    const ColumnNames& columnNames(const TableKey& key);
+    static ColumnNames readColumnNames(nanomysql::Connection& conn, const TableKey& key);
+
     void register_slave_on_master(MYSQL* mysql);
     void deregister_slave_on_master(MYSQL* mysql);
     void do_checksum_handshake(MYSQL* mysql);
@@ -54,6 +54,44 @@ struct MasterInfo {
     enum_binlog_checksum_alg checksum_alg = BINLOG_CHECKSUM_ALG_OFF;
     bool is_old_storage = true;
     bool gtid_mode = false;
+    // Number of events buffered between network reading thread and processing thread.
+    // If 0, events are read and processed one by one in the thread of get_remote_binlog.
+    size_t pipeline_size = 0;
+    // In pipelined mode, verify event checksums in network reading thread, so it is not
+    // on the way of events to callbacks.
+    bool checksum_in_reader = false;
+    // Read binlog stream with built-in protocol reader (see PacketReader) instead of libmysqlclient.
+    // SSL connections are always read by libmysqlclient.
+    bool native_reader = false;
+    // Initial size of the receive buffer of built-in reader, it grows if an event doesn't fit.
+    size_t read_buffer_size = 4 * 1024 * 1024;
+    // SO_RCVBUF of the connection socket, 0 means system default.
+    int socket_rcvbuf = 0;
+    // Number of threads calling table callbacks. Rows are distributed by primary key (by table,
+    // if there is no primary key), so changes of one row are delivered in order, update of the key
+    // is ordered with rows of the old and of the new key. Position is saved after all rows of
+    // the transaction are delivered. If 0, callbacks are called by the thread of get_remote_binlog.
+    unsigned int apply_threads = 0;
+    // Rows queued for each of apply threads at most
+    size_t apply_queue_size = 1024;
+    // Number of threads decoding rows of large rows events together with the thread of get_remote_binlog.
+    // Rows of an event are found by a quick scan first, then decoded by ranges in parallel;
+    // callbacks get them in the order of binlog anyway. If 0, rows are decoded one by one.
+    unsigned int decode_threads = 0;
+    // Rows events with rows of this size at least are decoded by decode threads
+    size_t decode_min_event_size = 256 * 1024;
+    // Fields of tables are created from column types and metadata of TABLE_MAP_EVENT on the first event
+    // of each table and whenever they change, instead of SHOW FULL COLUMNS in createDatabaseStructure()
+    // and on DDL, so they always decode rows of the binlog position. Names of columns are taken from
+    // the event if master writes them (binlog_row_metadata=FULL of MySQL 8.0), otherwise they are read
+    // from master by createDatabaseStructure(). After DDL of a table they are read again on its next
+    // TABLE_MAP_EVENT by SHOW FULL COLUMNS in the replication thread, which waits for this query.
+    // If the query fails, the event is logged as an error and skipped with rows of the table,
+    // until the next TABLE_MAP_EVENT of the table reads names successfully. If master has other
+    // number of columns than the event, columns are named "@1", "@2", ... with a warning.
+    // The table is not created if a column of its column filter or binding (see Slave::bind())
+    // is not found, then rows of the table are skipped with errors too.
+    bool schema_from_table_map = false;
 
     MasterInfo() : connect_retry(10) {}
 
@@ -109,6 +147,12 @@ struct ExtStateIface {
     // so there is no function for getting this statistics.
     virtual void initTableCount(const std::string& t) = 0;
     virtual void incTableCount(const std::string& t) = 0;
+    // Several rows at once, i.e. by batch callback
+    virtual void incTableCount(const std::string& t, unsigned long count)
+    {
+        for (; count; --count)
+            incTableCount(t);
+    }
 
     virtual ~ExtStateIface() {}
 };
@@ -126,7 +170,7 @@ struct EmptyExtState: public ExtStateIface {
     time_t getLastUpdateTime()                  override { return 0; }
     time_t getLastEventTime()                   override { return 0; }
     unsigned long getIntransactionPos()         override { return intransaction_pos; }
-    void setMasterPosition(const Position& pos) override { position = pos; intransaction_pos = pos.log_pos; }
+    void setMasterPosition(const Position& pos) override { position.assign(pos); intransaction_pos = pos.log_pos; }
     void saveMasterPosition()                   override {}
     bool loadMasterPosition(Position& pos)      override { pos.clear(); return false; }
     bool getMasterPosition(Position& pos)       override
@@ -145,6 +189,7 @@ struct EmptyExtState: public ExtStateIface {
     bool getStateProcessing()                   override { return false; }
     void initTableCount(const std::string& t)   override {}
     void incTableCount(const std::string& t)    override {}
+    void incTableCount(const std::string& t, unsigned long count) override {}
 
 private:
     Position        position;
@@ -199,6 +244,12 @@ public:
     virtual void tickModifyEventFailed(const unsigned long /*id*/, EventKind /*kind*/) {}
     // UPDATE/INSERT/DELETE rows successfully processed (Modify event may affect several rows of table).
     virtual void tickModifyRowDone(const unsigned long /*id*/, EventKind /*kind*/, uint64_t /*callbackWorkTimeNanoSeconds*/) {}
+    // Several rows processed by one batch callback, time is of the whole batch.
+    virtual void tickModifyRowsDone(const unsigned long id, EventKind kind, unsigned long rows, uint64_t callbackWorkTimeNanoSeconds)
+    {
+        for (unsigned long i = 0; i < rows; ++i)
+            tickModifyRowDone(id, kind, callbackWorkTimeNanoSeconds / rows);
+    }
     // Errors during processing
     virtual void tickError() {}
 };
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace slave
+{
+
+class Table;
+
+// Flat open-addressing hash from table_id of binlog to the Table it is mapped to.
+// Entry with nullptr table is negative: the table id is known to be not replicated.
+class TableIdCache
+{
+public:
+    struct Entry
+    {
+        unsigned long table_id;
+        Table* table;
+        // Table_map_event_info::m_hash and m_body of the last processed map event, hash is 0 if unknown.
+        // The body is kept to tell events with colliding hashes apart, its storage is reused.
+        size_t map_hash;
+        std::string map_body;
+    };
+
+    // Cache is dropped when it grows above this size, entries are filled again by TABLE_MAP events
+    static constexpr size_t max_size = 1 << 16;
+
+    // nullptr if the table id is not cached
+    const Entry* find(unsigned long table_id) const
+    {
+        if (m_entries.empty())
+            return nullptr;
+        for (size_t i = slot(table_id);; i = (i + 1) & m_mask) {
+            const Entry& entry = m_entries[i];
+            if (entry.table_id == table_id)
+                return &entry;
+            if (entry.table_id == empty)
+                return nullptr;
+        }
+    }
+
+    void set(unsigned long table_id, Table* table, size_t map_hash = 0, std::string_view map_body = {})
+    {
+        if (2 * (m_size + 1) > m_entries.size()) {
+            if (m_size >= max_size)
+                clear();
+            rehash(m_entries.empty() ? 16 : 2 * m_entries.size());
+        }
+        for (size_t i = slot(table_id);; i = (i + 1) & m_mask) {
+            Entry& entry = m_entries[i];
+            if (entry.table_id == empty) {
+                entry.table_id = table_id;
+                entry.table = table;
+                entry.map_hash = map_hash;
+                entry.map_body.assign(map_body.data(), map_body.size());
+                ++m_size;
+                return;
+            }
+            if (entry.table_id == table_id) {
+                entry.table = table;
+                entry.map_hash = map_hash;
+                entry.map_body.assign(map_body.data(), map_body.size());
+                return;
+            }
+        }
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_mask = 0;
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+
+private:
+    // Table ids are 6 bytes long, so the value is never a real table id
+    static constexpr unsigned long empty = ~0UL;
+
+    size_t slot(unsigned long table_id) const
+    {
+        // Fibonacci hashing, consecutive table ids are spread over the table
+        return (static_cast<uint64_t>(table_id) * 0x9e3779b97f4a7c15ULL >> 32) & m_mask;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Entry> entries(capacity, Entry{empty, nullptr, 0, {}});
+        entries.swap(m_entries);
+        m_mask = capacity - 1;
+        m_size = 0;
+        for (Entry& entry : entries)
+            if (entry.table_id != empty)
+                insert(std::move(entry));
+    }
+
+    // Moves the entry of a new table id in, bodies are not copied on rehash
+    void insert(Entry&& entry)
+    {
+        size_t i = slot(entry.table_id);
+        while (m_entries[i].table_id != empty)
+            i = (i + 1) & m_mask;
+        m_entries[i] = std::move(entry);
+        ++m_size;
+    }
+
+    std::vector<Entry> m_entries;
+    size_t m_mask = 0;
+    size_t m_size = 0;
+};
+
+}// slave
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+#include "TableMapSchema.h"
+#include "collate.h"
+#include "slave_log_event.h"
+
+#include "Logging.h"
+
+using namespace slave;
+
+namespace
+{
+
+// Types of optional metadata of MySQL 8.0
+enum OptionalMetadata
+{
+    COLUMN_NAME             = 4,
+    SIMPLE_PRIMARY_KEY      = 8,
+    PRIMARY_KEY_WITH_PREFIX = 9
+};
+
+void broken()
+{
+    LOG_ERROR(log, "TableMapSchema::parse: metadata of TABLE_MAP_EVENT is out of the event");
+    throw std::runtime_error("TableMapSchema::parse failed");
+}
+
+// Length encoded integer
+uint64_t read_length(const unsigned char*& p, const unsigned char* end)
+{
+    if (p >= end)
+        broken();
+
+    size_t bytes = 0;
+    uint64_t result = *p++;
+    switch (result) {
+    case 252: bytes = 2; break;
+    case 253: bytes = 3; break;
+    case 254: bytes = 8; break;
+    default:
+        // 251 is NULL
+        return result < 251 ? result : 0;
+    }
+    if (end - p < static_cast<ptrdiff_t>(bytes))
+        broken();
+
+    result = 0;
+    for (size_t i = 0; i < bytes; ++i)
+        result |= uint64_t(p[i]) << (8 * i);
+    p += bytes;
+    return result;
+}
+
+size_t metadata_size(unsigned char type)
+{
+    switch (type) {
+    case slave::MYSQL_TYPE_FLOAT:
+    case slave::MYSQL_TYPE_DOUBLE:
+    case slave::MYSQL_TYPE_TINY_BLOB:
+    case slave::MYSQL_TYPE_BLOB:
+    case slave::MYSQL_TYPE_MEDIUM_BLOB:
+    case slave::MYSQL_TYPE_LONG_BLOB:
+    case slave::MYSQL_TYPE_GEOMETRY:
+    case slave::MYSQL_TYPE_JSON:
+    case slave::MYSQL_TYPE_TIMESTAMP2:
+    case slave::MYSQL_TYPE_DATETIME2:
+    case slave::MYSQL_TYPE_TIME2:
+        return 1;
+    case slave::MYSQL_TYPE_VARCHAR:
+    case slave::MYSQL_TYPE_VAR_STRING:
+    case slave::MYSQL_TYPE_BIT:
+    case slave::MYSQL_TYPE_NEWDECIMAL:
+    case slave::MYSQL_TYPE_STRING:
+    case slave::MYSQL_TYPE_ENUM:
+    case slave::MYSQL_TYPE_SET:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+// MYSQL_TYPE_STRING is also written for CHAR, ENUM and SET, the real type is in metadata
+// together with the length of CHAR in bytes or the pack length of ENUM and SET
+void string_type(const TableMapSchema::Column& column, unsigned& real_type, unsigned& length)
+{
+    real_type = column.meta[0];
+    length = column.meta[1];
+    if ((real_type & 0x30) != 0x30) {
+        length |= ((real_type & 0x30) ^ 0x30) << 4;
+        real_type |= 0x30;
+    }
+}
+
+std::string with_digits(const char* name, unsigned digits)
+{
+    return digits ? std::string(name) + "(" + std::to_string(digits) + ")" : std::string(name);
+}
+
+}// anonymous-namespace
+
+void TableMapSchema::parse(const Table_map_event_info& tmi)
+{
+    const unsigned char* p = tmi.m_cols_types + tmi.m_width;
+    const unsigned char* const end = tmi.m_end;
+
+    const uint64_t metadata_length = read_length(p, end);
+    if (static_cast<uint64_t>(end - p) < metadata_length)
+        broken();
+    const unsigned char* const metadata_end = p + metadata_length;
+
+    m_columns.resize(tmi.m_width);
+    for (unsigned long i = 0; i < tmi.m_width; ++i) {
+        Column& column = m_columns[i];
+        column = Column();
+        column.type = tmi.m_cols_types[i];
+        const size_t size = metadata_size(column.type);
+        if (static_cast<size_t>(metadata_end - p) < size)
+            broken();
+        std::copy(p, p + size, column.meta);
+        p += size;
+    }
+    m_hash = std::hash<std::string_view>()(std::string_view((const char*)tmi.m_cols_types, metadata_end - tmi.m_cols_types));
+
+    m_names.clear();
+    m_primary_key.clear();
+    m_has_primary_key = false;
+
+    // Null bits of columns, then optional metadata
+    p = metadata_end + (tmi.m_width + 7) / 8;
+    while (p < end) {
+        const unsigned char type = *p++;
+        const uint64_t length = read_length(p, end);
+        if (static_cast<uint64_t>(end - p) < length)
+            broken();
+        const unsigned char* const field_end = p + length;
+
+        switch (type) {
+        case COLUMN_NAME:
+            while (p < field_end) {
+                const uint64_t size = read_length(p, field_end);
+                if (static_cast<uint64_t>(field_end - p) < size)
+                    broken();
+                m_names.emplace_back((const char*)p, size);
+                p += size;
+            }
+            break;
+        case SIMPLE_PRIMARY_KEY:
+        case PRIMARY_KEY_WITH_PREFIX:
+            m_has_primary_key = true;
+            while (p < field_end) {
+                m_primary_key.push_back(read_length(p, field_end));
+                if (type == PRIMARY_KEY_WITH_PREFIX)
+                    read_length(p, field_end);
+            }
+            break;
+        }
+        p = field_end;
+    }
+
+    if (!m_names.empty() && m_names.size() != m_columns.size()) {
+        LOG_WARNING(log, "TableMapSchema::parse: " << m_names.size() << " names of " << m_columns.size() << " columns are ignored");
+        m_names.clear();
+    }
+    std::sort(m_primary_key.begin(), m_primary_key.end());
+}
+
+std::string TableMapSchema::type(size_t i) const
+{
+    const Column& column = m_columns[i];
+    switch (column.type) {
+    case MYSQL_TYPE_TINY:       return "tinyint";
+    case MYSQL_TYPE_SHORT:      return "smallint";
+    case MYSQL_TYPE_INT24:      return "mediumint";
+    case MYSQL_TYPE_LONG:       return "int";
+    case MYSQL_TYPE_LONGLONG:   return "bigint";
+    case MYSQL_TYPE_FLOAT:      return "float";
+    case MYSQL_TYPE_DOUBLE:     return "double";
+    case MYSQL_TYPE_YEAR:       return "year";
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_NEWDATE:    return "date";
+    case MYSQL_TYPE_TIMESTAMP:  return "timestamp";
+    case MYSQL_TYPE_DATETIME:   return "datetime";
+    case MYSQL_TYPE_TIME:       return "time";
+    case MYSQL_TYPE_TIMESTAMP2: return with_digits("timestamp", column.meta[0]);
+    case MYSQL_TYPE_DATETIME2:  return with_digits("datetime", column.meta[0]);
+    case MYSQL_TYPE_TIME2:      return with_digits("time", column.meta[0]);
+    case MYSQL_TYPE_JSON:       return "json";
+    case MYSQL_TYPE_GEOMETRY:   return "geometry";
+
+    case MYSQL_TYPE_NEWDECIMAL:
+        return "decimal(" + std::to_string(column.meta[0]) + "," + std::to_string(column.meta[1]) + ")";
+
+    case MYSQL_TYPE_BIT:
+        return "bit(" + std::to_string(column.meta[1] * 8 + column.meta[0]) + ")";
+
+    case MYSQL_TYPE_VARCHAR:
+    case MYSQL_TYPE_VAR_STRING:
+        return "varchar(" + std::to_string(column.meta[0] | column.meta[1] << 8) + ")";
+
+    case MYSQL_TYPE_BLOB:
+        switch (column.meta[0]) {
+        case 1:  return "tinyblob";
+        case 3:  return "mediumblob";
+        case 4:  return "longblob";
+        default: return "blob";
+        }
+
+    case MYSQL_TYPE_STRING:
+    {
+        unsigned real_type, length;
+        string_type(column, real_type, length);
+        if (real_type == MYSQL_TYPE_ENUM)
+            return "enum";
+        if (real_type == MYSQL_TYPE_SET)
+            return "set";
+        return "char(" + std::to_string(length) + ")";
+    }
+
+    default:
+        return "type " + std::to_string(column.type);
+    }
+}
+
+PtrField TableMapSchema::create_field(size_t i, const std::string& name) const
+{
+    const Column& column = m_columns[i];
+    const std::string type = this->type(i);
+
+    // Lengths of strings are in bytes
+    collate_info ci;
+    ci.maxlen = 1;
+
+    switch (column.type) {
+    case MYSQL_TYPE_TINY:       return PtrField(new Field_tiny(name, type));
+    case MYSQL_TYPE_SHORT:      return PtrField(new Field_short(name, type));
+    case MYSQL_TYPE_INT24:      return PtrField(new Field_medium(name, type));
+    case MYSQL_TYPE_LONG:       return PtrField(new Field_long(name, type));
+    case MYSQL_TYPE_LONGLONG:   return PtrField(new Field_longlong(name, type));
+    case MYSQL_TYPE_FLOAT:      return PtrField(new Field_float(name, type));
+    case MYSQL_TYPE_DOUBLE:     return PtrField(new Field_double(name, type));
+    case MYSQL_TYPE_YEAR:       return PtrField(new Field_year(name, type));
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_NEWDATE:    return PtrField(new Field_date(name, type));
+    case MYSQL_TYPE_TIMESTAMP:  return PtrField(new Field_timestamp(name, type, true));
+    case MYSQL_TYPE_TIMESTAMP2: return PtrField(new Field_timestamp(name, type, false));
+    case MYSQL_TYPE_DATETIME:   return PtrField(new Field_datetime(name, type, true));
+    case MYSQL_TYPE_DATETIME2:  return PtrField(new Field_datetime(name, type, false));
+    case MYSQL_TYPE_TIME:       return PtrField(new Field_time(name, type, true));
+    case MYSQL_TYPE_TIME2:      return PtrField(new Field_time(name, type, false));
+    case MYSQL_TYPE_NEWDECIMAL: return PtrField(new Field_decimal(name, type));
+    case MYSQL_TYPE_BIT:        return PtrField(new Field_bit(name, type));
+
+    case MYSQL_TYPE_VARCHAR:
+    case MYSQL_TYPE_VAR_STRING:
+        return PtrField(new Field_varstring(name, type, ci));
+
+    // JSON (in binary format of MySQL) and GEOMETRY are packed as blobs of the length in metadata
+    case MYSQL_TYPE_BLOB:
+    case MYSQL_TYPE_JSON:
+    case MYSQL_TYPE_GEOMETRY:
+        switch (column.meta[0]) {
+        case 1:  return PtrField(new Field_tinyblob(name, type));
+        case 2:  return PtrField(new Field_blob(name, type));
+        case 3:  return PtrField(new Field_mediumblob(name, type));
+        case 4:  return PtrField(new Field_longblob(name, type));
+        }
+        break;
+
+    case MYSQL_TYPE_STRING:
+    {
+        unsigned real_type, length;
+        string_type(column, real_type, length);
+        // Numbers of elements giving the pack length
+        if (real_type == MYSQL_TYPE_ENUM)
+            return PtrField(new Field_enum(name, type, length == 1 ? 1 : 255));
+        if (real_type == MYSQL_TYPE_SET)
+            return PtrField(new Field_set(name, type, length * 8));
+        return PtrField(new Field_varstring(name, type, ci));
+    }
+    }
+
+    LOG_ERROR(log, "TableMapSchema::create_field: column " << name << " of " << type << " is not supported");
+    throw std::runtime_error("TableMapSchema::create_field failed: " + type);
+}
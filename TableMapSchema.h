@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "table.h"
+
+namespace slave
+{
+
+struct Table_map_event_info;
+
+// Columns of a table as TABLE_MAP_EVENT describes them: types with their metadata (lengths
+// of strings, precision of decimals and of fractional seconds), names and primary key if master
+// writes them (MySQL 8.0 with binlog_row_metadata=FULL). Fields created from it decode rows of
+// the binlog position of the event, see MasterInfo::schema_from_table_map.
+class TableMapSchema
+{
+public:
+    struct Column
+    {
+        unsigned char type = 0;
+        unsigned char meta[2] = {0, 0};
+    };
+
+    // Throws std::runtime_error if metadata is broken
+    void parse(const Table_map_event_info& tmi);
+
+    const std::vector<Column>& columns() const { return m_columns; }
+    // Empty if the event has no names of columns
+    const std::vector<std::string>& names() const { return m_names; }
+    // Indexes of primary key columns in ascending order, valid if has_primary_key()
+    const std::vector<unsigned>& primary_key() const { return m_primary_key; }
+    bool has_primary_key() const { return m_has_primary_key; }
+
+    // Hash of types and metadata of columns, equal for schemas decoding rows the same way
+    size_t hash() const { return m_hash; }
+
+    // Type of the column as in SHOW FULL COLUMNS, but lengths of strings are in bytes,
+    // and enum and set are without elements: "varchar(150)", "decimal(10,2)", "datetime(3)", "enum"
+    std::string type(size_t i) const;
+
+    // Throws std::runtime_error if the type is not supported
+    PtrField create_field(size_t i, const std::string& name) const;
+
+private:
+    std::vector<Column> m_columns;
+    std::vector<std::string> m_names;
+    std::vector<unsigned> m_primary_key;
+    bool m_has_primary_key = false;
+    size_t m_hash = 0;
+};
+
+}// slave
@@ -0,0 +1,448 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "field.h"
+#include "recordset.h"
+#include "slave_log_event.h"
+#include "table.h"
+
+namespace slave
+{
+
+// Row of a table decoded into user struct, see Slave::bind.
+// For Update m_old_row is the image before update, for Write and Delete it is not used.
+template <typename Row>
+struct TypedRecordSet
+{
+    Row m_row;
+    Row m_old_row;
+
+    RecordSet::TypeEvent type_event = RecordSet::Write;
+    time_t when = 0;
+
+    // Root master ID from which this record originated
+    unsigned int master_id = 0;
+};
+
+// Size of values of Field::unpack_int() in bytes and whether they are signed,
+// for checking members bound to integer columns
+struct IntegerColumn
+{
+    unsigned int size;
+    bool is_signed;
+};
+
+inline IntegerColumn integer_column(const Field& field)
+{
+    const DecodeStep step = field.decode_step();
+    const bool is_unsigned = field.field_type.find("unsigned") != std::string::npos;
+    switch (step.op)
+    {
+    case DecodeOp::Tiny:
+        // YEAR is stored as unsigned offset from 1900
+        return {1, !is_unsigned && field.field_type.compare(0, 4, "year") != 0};
+    case DecodeOp::Short:       return {2, !is_unsigned};
+    case DecodeOp::Medium:      return {3, !is_unsigned};
+    case DecodeOp::Long:        return {4, !is_unsigned};
+    case DecodeOp::LongLong:    return {8, !is_unsigned};
+    case DecodeOp::Date:        return {3, false};
+    case DecodeOp::Timestamp:
+    case DecodeOp::Timestamp2:  return {4, false};
+    case DecodeOp::Datetime:
+    case DecodeOp::Datetime2:   return {8, false};
+    case DecodeOp::Enum:
+    case DecodeOp::Set:
+    case DecodeOp::Bit:         return {step.width, false};
+    default:
+        // TIME may be negative, other types are without own operation
+        return {dynamic_cast<const Field_time*>(&field) ? 4u : 8u, true};
+    }
+}
+
+// Decoding of one column into a member of type T, chosen at compile time.
+// NULL values and columns absent in the row image are reset to T().
+template <typename T, typename Enable = void>
+struct ColumnDecoder
+{
+    static_assert(sizeof(T) == 0, "Unsupported type of bound member");
+};
+
+template <typename T>
+struct ColumnDecoder<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    // Member must hold every value of the column: it is not narrower than the column,
+    // and it is signed if the column is signed. bool is bound only to 1 byte columns.
+    static bool accepts(const Field& field)
+    {
+        if (field.column_type() != ColumnType::Integer)
+            return false;
+        const IntegerColumn column = integer_column(field);
+        if (std::is_same<T, bool>::value)
+            return column.size == 1;
+        if (column.is_signed)
+            return std::is_signed<T>::value && sizeof(T) >= column.size;
+        return sizeof(T) > column.size || (sizeof(T) == column.size && std::is_unsigned<T>::value);
+    }
+    static const char* decode(const Field& field, const char* from, T& value)
+    {
+        int64_t tmp;
+        from = field.unpack_int(from, tmp);
+        value = static_cast<T>(tmp);
+        return from;
+    }
+    static void reset(T& value) { value = T(); }
+};
+
+template <typename T>
+struct ColumnDecoder<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    // DOUBLE is not bound to float, which loses its precision
+    static bool accepts(const Field& field)
+    {
+        return field.column_type() == ColumnType::Real
+            && (sizeof(T) >= sizeof(double) || field.decode_step().op == DecodeOp::Float);
+    }
+    static const char* decode(const Field& field, const char* from, T& value)
+    {
+        double tmp;
+        from = field.unpack_real(from, tmp);
+        value = static_cast<T>(tmp);
+        return from;
+    }
+    static void reset(T& value) { value = T(); }
+};
+
+template <>
+struct ColumnDecoder<decimal::Decimal>
+{
+    static bool accepts(const Field& field) { return field.column_type() == ColumnType::Decimal; }
+    static const char* decode(const Field& field, const char* from, decimal::Decimal& value)
+    {
+        return field.unpack_decimal(from, value);
+    }
+    static void reset(decimal::Decimal& value) { value = decimal::Decimal(); }
+};
+
+template <>
+struct ColumnDecoder<std::string>
+{
+    static bool accepts(const Field& field) { return field.column_type() == ColumnType::String; }
+    static const char* decode(const Field& field, const char* from, std::string& value)
+    {
+        std::string_view tmp;
+        field.view(from, tmp);
+        // Keeps the capacity of the string of the previous row
+        value.assign(tmp.data(), tmp.size());
+        return tmp.data() + tmp.size();
+    }
+    static void reset(std::string& value) { value.clear(); }
+};
+
+// Points into the event, valid only inside the callback
+template <>
+struct ColumnDecoder<std::string_view>
+{
+    static bool accepts(const Field& field) { return field.column_type() == ColumnType::String; }
+    static const char* decode(const Field& field, const char* from, std::string_view& value)
+    {
+        field.view(from, value);
+        return value.data() + value.size();
+    }
+    static void reset(std::string_view& value) { value = std::string_view(); }
+};
+
+// Distinguishes NULL from zero value
+template <typename T>
+struct ColumnDecoder<std::optional<T>>
+{
+    static bool accepts(const Field& field) { return ColumnDecoder<T>::accepts(field); }
+    static const char* decode(const Field& field, const char* from, std::optional<T>& value)
+    {
+        if (!value)
+            value.emplace();
+        return ColumnDecoder<T>::decode(field, from, *value);
+    }
+    static void reset(std::optional<T>& value) { value.reset(); }
+};
+
+// Values of the column narrower than the member, which are extended to the member: with sign
+// for signed columns and with zeros for unsigned ones. Field::unpack_int() does not extend
+// the sign of SMALLINT, MEDIUMINT and INT, but does it for 1 byte columns, even unsigned ones.
+struct Extension
+{
+    // Bits of values of the column, 0 if the member is not wider than the column
+    unsigned int bits = 0;
+    bool is_signed = false;
+};
+
+template <typename T>
+Extension column_extension(const Field& field, const T*)
+{
+    if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value) {
+        if (field.column_type() == ColumnType::Integer) {
+            const IntegerColumn column = integer_column(field);
+            if (column.size < sizeof(T))
+                return {column.size * 8, column.is_signed};
+        }
+    }
+    return Extension();
+}
+
+template <typename T>
+Extension column_extension(const Field& field, const std::optional<T>*)
+{
+    return column_extension(field, static_cast<const T*>(nullptr));
+}
+
+template <typename T>
+void extend(T& value, Extension extension)
+{
+    if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value) {
+        typedef typename std::make_unsigned<T>::type U;
+        const U low = static_cast<U>(value) & ((U(1) << extension.bits) - 1);
+        if (!extension.is_signed) {
+            value = static_cast<T>(low);
+            return;
+        }
+        const U sign = U(1) << (extension.bits - 1);
+        value = static_cast<T>((low ^ sign) - sign);
+    }
+}
+
+template <typename T>
+void extend(std::optional<T>& value, Extension extension)
+{
+    extend(*value, extension);
+}
+
+// Member of user struct bound to the column
+template <typename Row, typename T>
+struct BoundColumn
+{
+    T Row::* member;
+    std::string name;
+};
+
+template <typename Row>
+std::tuple<> bind_columns()
+{
+    return std::tuple<>();
+}
+
+// Makes tuple of BoundColumn from arguments: member, column name, member, column name...
+template <typename Row, typename T, typename Name, typename... Rest>
+auto bind_columns(T Row::* member, const Name& name, const Rest&... rest)
+{
+    return std::tuple_cat(std::make_tuple(BoundColumn<Row, T>{member, name}), bind_columns<Row>(rest...));
+}
+
+// Type-erased binding of a table, called by apply_row_event()
+class RowBinding
+{
+public:
+    virtual ~RowBinding() {}
+
+    // Finds bound columns in the table and checks their types. Throws std::runtime_error if a column
+    // is absent, is bound twice or its values do not fit into the member (see ColumnDecoder::accepts).
+    virtual void resolve(const Table& table) = 0;
+
+    // Decodes rows of the event and calls the callback for each of them. Returns the number of rows.
+    virtual size_t apply(const Table& table, const Basic_event_info& bei, const Row_event_info& roi,
+                         RecordSet::TypeEvent type) = 0;
+};
+
+template <typename Row, typename Callback, typename... Columns>
+class TypedBinding : public RowBinding
+{
+public:
+    TypedBinding(Callback callback, std::tuple<Columns...> columns)
+    :   m_callback(std::move(callback))
+    ,   m_columns(std::move(columns))
+    {}
+
+    void resolve(const Table& table) override
+    {
+        std::vector<int> slots(table.fields.size(), -1);
+        std::array<Extension, sizeof...(Columns)> extensions{};
+        resolve_columns(table, slots, extensions, std::index_sequence_for<Columns...>());
+        m_slots.swap(slots);
+        m_extensions = extensions;
+    }
+
+    size_t apply(const Table& table, const Basic_event_info& bei, const Row_event_info& roi,
+                 RecordSet::TypeEvent type) override
+    {
+        if (roi.m_width != m_slots.size()) {
+            throw std::runtime_error("Field count mismatch in unpacking row for " + table.full_name + ": "
+                                     + std::to_string(roi.m_width) + " != " + std::to_string(m_slots.size()));
+        }
+
+        m_record.type_event = type;
+        m_record.when = bei.when;
+        m_record.master_id = bei.server_id;
+
+        size_t count = 0;
+        const unsigned char* row_start = roi.m_rows_buf;
+        while (row_start < roi.m_rows_end) {
+            if (type == RecordSet::Update) {
+                row_start = unpack(table, m_record.m_old_row, row_start, roi.m_cols);
+                row_start = unpack(table, m_record.m_row, row_start, roi.m_cols_ai);
+            } else {
+                row_start = unpack(table, m_record.m_row, row_start, roi.m_cols);
+            }
+            ++count;
+
+            m_callback(m_record);
+        }
+        return count;
+    }
+
+private:
+    typedef const char* (*decode_t)(const std::tuple<Columns...>&, const Field&, const char*, Row&, Extension);
+    typedef void (*reset_t)(const std::tuple<Columns...>&, Row&);
+
+    template <size_t I>
+    static const char* decode(const std::tuple<Columns...>& columns, const Field& field, const char* from, Row& row,
+                              Extension extension)
+    {
+        const auto& column = std::get<I>(columns);
+        typedef typename std::remove_reference<decltype(row.*column.member)>::type T;
+        from = ColumnDecoder<T>::decode(field, from, row.*column.member);
+        if (extension.bits)
+            extend(row.*column.member, extension);
+        return from;
+    }
+
+    template <size_t I>
+    static void reset(const std::tuple<Columns...>& columns, Row& row)
+    {
+        const auto& column = std::get<I>(columns);
+        typedef typename std::remove_reference<decltype(row.*column.member)>::type T;
+        ColumnDecoder<T>::reset(row.*column.member);
+    }
+
+    template <size_t... I>
+    void resolve_columns(const Table& table, std::vector<int>& slots,
+                         std::array<Extension, sizeof...(Columns)>& extensions, std::index_sequence<I...>)
+    {
+        (resolve_column<I>(table, slots, extensions), ...);
+    }
+
+    template <size_t I>
+    void resolve_column(const Table& table, std::vector<int>& slots, std::array<Extension, sizeof...(Columns)>& extensions)
+    {
+        const auto& column = std::get<I>(m_columns);
+        typedef typename std::remove_reference<decltype(std::declval<Row&>().*column.member)>::type T;
+
+        for (size_t i = 0; i < table.fields.size(); ++i)
+        {
+            const Field& field = *table.fields[i];
+            if (field.field_name != column.name)
+                continue;
+            if (slots[i] >= 0)
+                throw std::runtime_error("Column " + column.name + " of " + table.full_name + " is bound twice");
+            if (!ColumnDecoder<T>::accepts(field))
+                throw std::runtime_error("Column " + column.name + " of type '" + field.field_type + "' in "
+                                         + table.full_name + " can not be bound to member of incompatible type"
+                                         + " (narrower, unsigned for signed column or of other kind)");
+            slots[i] = I;
+            extensions[I] = column_extension(field, static_cast<const T*>(nullptr));
+            return;
+        }
+        throw std::runtime_error("There is no column " + column.name + " in " + table.full_name + " to bind");
+    }
+
+    template <size_t... I>
+    static std::array<decode_t, sizeof...(I)> make_decoders(std::index_sequence<I...>)
+    {
+        return {{ &decode<I>... }};
+    }
+
+    template <size_t... I>
+    static std::array<reset_t, sizeof...(I)> make_resetters(std::index_sequence<I...>)
+    {
+        return {{ &reset<I>... }};
+    }
+
+    const unsigned char* unpack(const Table& table, Row& row, const unsigned char* start,
+                                const std::vector<unsigned char>& cols) const
+    {
+        static const auto decoders = make_decoders(std::index_sequence_for<Columns...>());
+        static const auto resetters = make_resetters(std::index_sequence_for<Columns...>());
+
+        const unsigned int colcnt = m_slots.size();
+
+        // Null bitmap has bits only for present columns
+        const unsigned char* null_ptr = start;
+        const char* ptr = (const char*)start + (n_set_bits(cols, colcnt) + 7) / 8;
+        unsigned int null_mask = 1U;
+        unsigned char null_bits = *null_ptr++;
+
+        for (unsigned int i = 0; i < colcnt; ++i)
+        {
+            const int slot = m_slots[i];
+
+            if (!cols.empty() && !(cols[i / 8] & (1 << (i & 7)))) {
+                if (slot >= 0)
+                    resetters[slot](m_columns, row);
+                continue;
+            }
+
+            if ((null_mask & 0xFF) == 0) {
+                null_mask = 1U;
+                null_bits = *null_ptr++;
+            }
+
+            if (null_bits & null_mask) {
+                if (slot >= 0)
+                    resetters[slot](m_columns, row);
+            } else if (slot >= 0) {
+                ptr = decoders[slot](m_columns, *table.fields[i], ptr, row, m_extensions[slot]);
+            } else {
+                ptr = table.fields[i]->skip(ptr);
+            }
+
+            null_mask <<= 1;
+        }
+
+        return (const unsigned char*)ptr;
+    }
+
+    Callback m_callback;
+    std::tuple<Columns...> m_columns;
+    // Index of bound column of each field of the table, -1 if the field is not bound
+    std::vector<int> m_slots;
+    // Extension of values of each bound column to the member
+    std::array<Extension, sizeof...(Columns)> m_extensions{};
+    TypedRecordSet<Row> m_record;
+};
+
+template <typename Row, typename Callback, typename Tuple>
+struct TypedBindingOf;
+
+template <typename Row, typename Callback, typename... Columns>
+struct TypedBindingOf<Row, Callback, std::tuple<Columns...>>
+{
+    typedef TypedBinding<Row, Callback, Columns...> type;
+};
+
+// Binding of columns to members: make_binding<Row>(callback, &Row::id, "id", &Row::price, "price"...)
+template <typename Row, typename Callback, typename... Args>
+std::shared_ptr<RowBinding> make_binding(Callback callback, const Args&... args)
+{
+    auto columns = bind_columns<Row>(args...);
+    typedef typename TypedBindingOf<Row, Callback, decltype(columns)>::type binding_t;
+    return std::make_shared<binding_t>(std::move(callback), std::move(columns));
+}
+
+}// slave
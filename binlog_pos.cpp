@@ -165,6 +165,25 @@ void Position::parseGtid(const std::string& input)
     });
 }
 
+void Position::assign(const Position& other)
+{
+    log_name = other.log_name;
+    log_pos = other.log_pos;
+
+    bool same_sids = gtid_executed.size() == other.gtid_executed.size();
+    for (auto it = other.gtid_executed.begin(); same_sids && it != other.gtid_executed.end(); ++it)
+        same_sids = gtid_executed.count(it->first) == 1;
+
+    if (!same_sids)
+    {
+        gtid_executed = other.gtid_executed;
+        return;
+    }
+    // Nodes of interval lists are reused by assignment
+    for (const auto& x : other.gtid_executed)
+        gtid_executed.find(x.first)->second = x.second;
+}
+
 void Position::addGtid(const gtid_t& gtid)
 {
     auto it = gtid_executed.find(gtid.first);
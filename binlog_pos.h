@@ -33,6 +33,10 @@ struct Position
     bool empty() const { return (log_name.empty() || log_pos == 0) && gtid_executed.empty(); }
     void clear() { log_name.clear(); log_pos = 0; gtid_executed.clear(); }
 
+    // Copies 'other' reusing memory of this position, so saving of the position
+    // with the same set of GTID sources does not allocate
+    void assign(const Position& other);
+
     void parseGtid(const std::string& input);
     void addGtid(const gtid_t& gtid);
     size_t encodedGtidSize() const;
@@ -0,0 +1,197 @@
+#include <zlib.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SLAVE_CRC32_PCLMUL
+#include <immintrin.h>
+#endif
+
+#include "crc32.h"
+
+namespace
+{
+
+uint32_t crc32_zlib(uint32_t crc, const unsigned char* pos, size_t length)
+{
+    // zlib takes length as unsigned int
+    while (length > 0)
+    {
+        const unsigned int chunk = length > 0x40000000 ? 0x40000000 : static_cast<unsigned int>(length);
+        crc = static_cast<uint32_t>(::crc32(crc, pos, chunk));
+        pos += chunk;
+        length -= chunk;
+    }
+    return crc;
+}
+
+#ifdef SLAVE_CRC32_PCLMUL
+
+// Folding of 4x128 bits blocks with carry-less multiplication and Barrett reduction,
+// see Intel paper "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+// Constants are for the reflected polynomial 0x04c11db7 of zlib.
+// Buffer length must be at least 64 and a multiple of 16, 'crc' is not inverted.
+__attribute__((target("pclmul,sse4.1")))
+uint32_t crc32_pclmul_fold(uint32_t crc, const unsigned char* buf, size_t len)
+{
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+
+    buf += 64;
+    len -= 64;
+
+    // Parallel fold of 64 bytes blocks
+    while (len >= 64)
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+        x1 = _mm_xor_si128(x1, x5);
+        x2 = _mm_xor_si128(x2, x6);
+        x3 = _mm_xor_si128(x3, x7);
+        x4 = _mm_xor_si128(x4, x8);
+
+        x1 = _mm_xor_si128(x1, y5);
+        x2 = _mm_xor_si128(x2, y6);
+        x3 = _mm_xor_si128(x3, y7);
+        x4 = _mm_xor_si128(x4, y8);
+
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold into 128 bits
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(x1, x2);
+    x1 = _mm_xor_si128(x1, x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(x1, x3);
+    x1 = _mm_xor_si128(x1, x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(x1, x4);
+    x1 = _mm_xor_si128(x1, x5);
+
+    // Single fold of the rest 16 bytes blocks
+    while (len >= 16)
+    {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(x1, x2);
+        x1 = _mm_xor_si128(x1, x5);
+
+        buf += 16;
+        len -= 16;
+    }
+
+    // Fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i*)poly);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+uint32_t crc32_pclmul(uint32_t crc, const unsigned char* pos, size_t length)
+{
+    // Short buffers are not worth the setup of folding
+    if (length >= 64)
+    {
+        const size_t chunk = length & ~static_cast<size_t>(15);
+        crc = ~crc32_pclmul_fold(~crc, pos, chunk);
+        pos += chunk;
+        length -= chunk;
+    }
+    return length ? crc32_zlib(crc, pos, length) : crc;
+}
+
+#endif // SLAVE_CRC32_PCLMUL
+
+typedef uint32_t (*crc32_func)(uint32_t, const unsigned char*, size_t);
+
+struct crc32_impl
+{
+    crc32_func func;
+    const char* name;
+};
+
+crc32_impl choose_crc32()
+{
+#ifdef SLAVE_CRC32_PCLMUL
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+        return { crc32_pclmul, "pclmul" };
+#endif
+    return { crc32_zlib, "zlib" };
+}
+
+const crc32_impl& impl()
+{
+    static const crc32_impl result = choose_crc32();
+    return result;
+}
+
+}// anonymous-namespace
+
+namespace slave
+{
+
+uint32_t checksum_crc32(uint32_t crc, const unsigned char* pos, size_t length)
+{
+    return impl().func(crc, pos, length);
+}
+
+const char* checksum_crc32_impl()
+{
+    return impl().name;
+}
+
+}// slave
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace slave
+{
+
+// CRC32 of binlog events, same as zlib crc32(). Uses carry-less multiplication (PCLMULQDQ)
+// when CPU supports it, the implementation is chosen at runtime, zlib is the fallback.
+uint32_t checksum_crc32(uint32_t crc, const unsigned char* pos, size_t length);
+
+// Implementation in use: "pclmul" or "zlib"
+const char* checksum_crc32_impl();
+
+}// slave
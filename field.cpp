@@ -38,73 +38,150 @@ namespace slave
 
 
 
+const char* Field::unpack_int(const char* from, int64_t& value) const {
+    throw std::runtime_error("Field::unpack_int(): field '" + field_name + "' of type '" + field_type + "' is not integer");
+}
+
+const char* Field::unpack_real(const char* from, double& value) const {
+    throw std::runtime_error("Field::unpack_real(): field '" + field_name + "' of type '" + field_type + "' is not real");
+}
+
+const char* Field::unpack_decimal(const char* from, decimal::Decimal& value) const {
+    throw std::runtime_error("Field::unpack_decimal(): field '" + field_name + "' of type '" + field_type + "' is not decimal");
+}
+
 Field_num::Field_num(const std::string& field_name_arg, const std::string& type):
     Field(field_name_arg, type) {}
 
 Field_tiny::Field_tiny(const std::string& field_name_arg, const std::string& type):
     Field_num(field_name_arg, type) {}
 
-const char* Field_tiny::unpack(const char* from) {
+const char* Field_tiny::unpack_int(const char* from, int64_t& value) const {
 
     char tmp = *((char*)(from));
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_tiny::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const char tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  tiny: " << (int)(tmp) << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_tiny::decode_step() const {
+    return { DecodeOp::Tiny, 1 };
 }
 
 
 Field_short::Field_short(const std::string& field_name_arg, const std::string& type):
     Field_num(field_name_arg, type) {}
 
-const char* Field_short::unpack(const char* from) {
+const char* Field_short::unpack_int(const char* from, int64_t& value) const {
 
     uint16 tmp = uint2korr(from);
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_short::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const uint16 tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  short: " << tmp << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_short::decode_step() const {
+    return { DecodeOp::Short, 2 };
 }
 
 Field_medium::Field_medium(const std::string& field_name_arg, const std::string& type):
     Field_num(field_name_arg, type) {}
 
-const char* Field_medium::unpack(const char* from) {
+const char* Field_medium::unpack_int(const char* from, int64_t& value) const {
 
     uint32 tmp = uint3korr(from);
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_medium::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const uint32 tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  medium: " << tmp << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_medium::decode_step() const {
+    return { DecodeOp::Medium, 3 };
 }
 
 Field_long::Field_long(const std::string& field_name_arg, const std::string& type):
     Field_num(field_name_arg, type) {}
 
-const char* Field_long::unpack(const char* from) {
+const char* Field_long::unpack_int(const char* from, int64_t& value) const {
 
     uint32 tmp = uint4korr(from);
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_long::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const uint32 tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  long: " << tmp << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_long::decode_step() const {
+    return { DecodeOp::Long, 4 };
 }
 
 Field_longlong::Field_longlong(const std::string& field_name_arg, const std::string& type):
     Field_num(field_name_arg, type) {}
 
-const char* Field_longlong::unpack(const char* from) {
+const char* Field_longlong::unpack_int(const char* from, int64_t& value) const {
 
     ulonglong tmp = uint8korr(from);
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_longlong::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const ulonglong tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  longlong: " << tmp << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_longlong::decode_step() const {
+    return { DecodeOp::LongLong, 8 };
 }
 
 Field_real::Field_real(const std::string& field_name_arg, const std::string& type):
@@ -113,30 +190,50 @@ Field_real::Field_real(const std::string& field_name_arg, const std::string& typ
 Field_double::Field_double(const std::string& field_name_arg, const std::string& type):
     Field_real(field_name_arg, type) {}
 
-const char* Field_double::unpack(const char* from) {
+const char* Field_double::unpack_real(const char* from, double& value) const {
+
+    value = *((double*)(from));
+    return from + pack_length();
+}
+
+const char* Field_double::unpack(const char* from, FieldValue& data) const {
 
     double tmp = *((double*)(from));
-    field_data = tmp;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  double: " << tmp << " // " << pack_length());
 
     return from + pack_length();
 }
 
+DecodeStep Field_double::decode_step() const {
+    return { DecodeOp::Double, sizeof(double) };
+}
+
 
 Field_float::Field_float(const std::string& field_name_arg, const std::string& type):
     Field_real(field_name_arg, type) {}
 
-const char* Field_float::unpack(const char* from) {
+const char* Field_float::unpack_real(const char* from, double& value) const {
+
+    value = *((float*)(from));
+    return from + pack_length();
+}
+
+const char* Field_float::unpack(const char* from, FieldValue& data) const {
 
     float tmp = *((float*)(from));
-    field_data = tmp;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  float: " << tmp << " // " << pack_length());
 
     return from + pack_length();
 }
 
+DecodeStep Field_float::decode_step() const {
+    return { DecodeOp::Float, sizeof(float) };
+}
+
 
 Field_str::Field_str(const std::string& field_name_arg, const std::string& type):
     Field(field_name_arg, type) {}
@@ -190,7 +287,23 @@ void Field_timestamp::reset(bool old_storage, bool ctor_call)
     }
 }
 
-const char* Field_timestamp::unpack(const char* from) {
+const char* Field_timestamp::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const uint32 tmp = value;
+    setFieldValue(data, tmp);
+
+    LOG_TRACE(log, "  timestamp: " << tmp << " // " << pack_length());
+
+    return from;
+}
+
+DecodeStep Field_timestamp::decode_step() const {
+    return { is_old_storage ? DecodeOp::Timestamp : DecodeOp::Timestamp2, (unsigned char)pack_length() };
+}
+
+const char* Field_timestamp::unpack_int(const char* from, int64_t& value) const {
 
     uint32 tmp;
     if (is_old_storage)
@@ -208,10 +321,7 @@ const char* Field_timestamp::unpack(const char* from) {
             *((unsigned char *)&tmp + 3 - i) = *(from + i);
     }
 
-    field_data = tmp;
-
-    LOG_TRACE(log, "  timestamp: " << tmp << " // " << pack_length());
-
+    value = tmp;
     return from + pack_length();
 }
 
@@ -263,7 +373,24 @@ void Field_datetime::reset(bool old_storage, bool ctor_call)
     }
 }
 
-const char* Field_datetime::unpack(const char* from)
+const char* Field_datetime::unpack(const char* from, FieldValue& data) const
+{
+    int64_t value;
+    from = unpack_int(from, value);
+    const ulonglong tmp = value;
+    setFieldValue(data, tmp);
+
+    LOG_TRACE(log, "  datetime: " << tmp << " // " << pack_length());
+
+    return from;
+}
+
+DecodeStep Field_datetime::decode_step() const
+{
+    return { is_old_storage ? DecodeOp::Datetime : DecodeOp::Datetime2, (unsigned char)pack_length() };
+}
+
+const char* Field_datetime::unpack_int(const char* from, int64_t& value) const
 {
     ulonglong tmp;
     if (is_old_storage)
@@ -284,42 +411,58 @@ const char* Field_datetime::unpack(const char* from)
         // ---------------------------
         // 40 bits = 5 bytes
 
-        ulonglong data;
+        ulonglong data = 0;
         for (unsigned int i = 0; i < 5; ++i)
             *((unsigned char *)&data + 4 - i) = *(from + i);
 
-        tmp = data & 63;
-        data >>= 6;
-        tmp += (data & 63) * 100;
-        data >>= 6;
-        tmp += (data & 31) * 10000;
-        data >>= 5;
-        tmp += (data & 31) * 1000000;
-        data >>= 5;
-
-        ulonglong year_month = data & ((1 << 17) - 1);
-        tmp += year_month % 13 * 100000000;
-        tmp += year_month / 13 * 10000000000;
+        tmp = datetime2(data);
     }
 
-    field_data = tmp;
-
-    LOG_TRACE(log, "  datetime: " << tmp << " // " << pack_length());
-
+    value = tmp;
     return from + pack_length();
 }
 
+unsigned long long Field_datetime::datetime2(uint64_t data)
+{
+    unsigned long long tmp = data & 63;
+    data >>= 6;
+    tmp += (data & 63) * 100;
+    data >>= 6;
+    tmp += (data & 31) * 10000;
+    data >>= 5;
+    tmp += (data & 31) * 1000000;
+    data >>= 5;
+
+    const unsigned long long year_month = data & ((1 << 17) - 1);
+    tmp += year_month % 13 * 100000000;
+    tmp += year_month / 13 * 10000000000;
+    return tmp;
+}
+
 Field_date::Field_date(const std::string& field_name_arg, const std::string& type):
     Field_str(field_name_arg, type) {}
 
-const char* Field_date::unpack(const char* from) {
+const char* Field_date::unpack_int(const char* from, int64_t& value) const {
 
     uint32 tmp = uint3korr(from);
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_date::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const uint32 tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  date: " << tmp << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_date::decode_step() const {
+    return { DecodeOp::Date, 3 };
 }
 
 Field_time::Field_time(const std::string& field_name_arg, const std::string& type, bool old_storage):
@@ -367,7 +510,24 @@ void Field_time::reset(bool old_storage, bool ctor_call)
     }
 }
 
-const char* Field_time::unpack(const char* from) {
+const char* Field_time::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const int32 tmp = value;
+    setFieldValue(data, tmp);
+
+    LOG_TRACE(log, "  time: " << tmp << " // " << pack_length());
+
+    return from;
+}
+
+DecodeStep Field_time::decode_step() const {
+    // New storage is decoded by unpack()
+    return { is_old_storage ? DecodeOp::Time : DecodeOp::Field, (unsigned char)pack_length() };
+}
+
+const char* Field_time::unpack_int(const char* from, int64_t& value) const {
 
     int32 tmp;
     if (is_old_storage)
@@ -403,10 +563,7 @@ const char* Field_time::unpack(const char* from) {
             tmp = -tmp;
     }
 
-    field_data = tmp;
-
-    LOG_TRACE(log, "  time: " << tmp << " // " << pack_length());
-
+    value = tmp;
     return from + pack_length();
 }
 
@@ -423,7 +580,10 @@ Field_enum::Field_enum(const std::string& field_name_arg, const std::string& typ
     }
 }
 
-const char* Field_enum::unpack(const char* from) {
+Field_enum::Field_enum(const std::string& field_name_arg, const std::string& type, unsigned short count):
+    Field_str(field_name_arg, type), count_elements(count) {}
+
+const char* Field_enum::unpack_int(const char* from, int64_t& value) const {
 
     int tmp;
 
@@ -435,11 +595,24 @@ const char* Field_enum::unpack(const char* from) {
         tmp = int(*((short*)(from)));
     }
 
-    field_data = tmp;
+    value = tmp;
+    return from + pack_length();
+}
+
+const char* Field_enum::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const int tmp = value;
+    setFieldValue(data, tmp);
 
     LOG_TRACE(log, "  enum: " << tmp << " // " << pack_length());
 
-    return from + pack_length();
+    return from;
+}
+
+DecodeStep Field_enum::decode_step() const {
+    return { DecodeOp::Enum, (unsigned char)pack_length() };
 }
 
 Field_set::Field_set(const std::string& field_name_arg, const std::string& type):
@@ -456,7 +629,26 @@ Field_set::Field_set(const std::string& field_name_arg, const std::string& type)
     }
 }
 
-const char* Field_set::unpack(const char* from) {
+Field_set::Field_set(const std::string& field_name_arg, const std::string& type, unsigned short count):
+    Field_enum(field_name_arg, type, count) {}
+
+const char* Field_set::unpack(const char* from, FieldValue& data) const {
+
+    int64_t value;
+    from = unpack_int(from, value);
+    const ulonglong tmp = value;
+    setFieldValue(data, tmp);
+
+    LOG_TRACE(log, "  set: " << tmp << " // " << pack_length());
+
+    return from;
+}
+
+DecodeStep Field_set::decode_step() const {
+    return { DecodeOp::Set, (unsigned char)pack_length() };
+}
+
+const char* Field_set::unpack_int(const char* from, int64_t& value) const {
     ulonglong tmp;
 
     switch(pack_length()) {
@@ -480,10 +672,7 @@ const char* Field_set::unpack(const char* from) {
         break;
     }
 
-    field_data = tmp;
-
-    LOG_TRACE(log, "  set: " << tmp << " // " << pack_length());
-
+    value = tmp;
     return from + pack_length();
 }
 
@@ -513,25 +702,40 @@ Field_varstring::Field_varstring(const std::string& field_name_arg, const std::s
     field_length = symbols;
 }
 
-const char* Field_varstring::unpack(const char* from) {
+bool Field_varstring::view(const char* from, std::string_view& value) const {
 
     unsigned length_row;
     if (length_bytes == 1) {
-        //length_row = (unsigned int) (unsigned char) (*to = *from++);
         length_row = (unsigned int) (unsigned char) (*from++);
-
     } else {
         length_row = uint2korr(from);
-        from++;
-        from++;
+        from += 2;
     }
 
-    std::string tmp(from, length_row);
+    value = std::string_view(from, length_row);
+    return true;
+}
 
-    LOG_TRACE(log, "  varstr: '" << tmp << "' // " << length_bytes << " " << length_row);
-    field_data = std::move(tmp);
+const char* Field_varstring::skip(const char* from) const {
 
-    return from + length_row;
+    std::string_view value;
+    view(from, value);
+    return value.data() + value.size();
+}
+
+const char* Field_varstring::unpack(const char* from, FieldValue& data) const {
+
+    std::string_view value;
+    view(from, value);
+
+    LOG_TRACE(log, "  varstr: '" << value << "' // " << length_bytes << " " << value.size());
+    setFieldValue(data, value.data(), value.size());
+
+    return value.data() + value.size();
+}
+
+DecodeStep Field_varstring::decode_step() const {
+    return { DecodeOp::VarString, (unsigned char)length_bytes };
 }
 
 
@@ -547,21 +751,34 @@ Field_mediumblob::Field_mediumblob(const std::string& field_name_arg, const std:
 Field_longblob::Field_longblob(const std::string& field_name_arg, const std::string& type):
     Field_blob(field_name_arg, type) { packlength = 4; }
 
-const char* Field_blob::unpack(const char* from) {
+bool Field_blob::view(const char* from, std::string_view& value) const {
+
+    value = std::string_view(from + packlength, get_length(from));
+    return true;
+}
+
+const char* Field_blob::skip(const char* from) const {
+
+    return from + packlength + get_length(from);
+}
+
+const char* Field_blob::unpack(const char* from, FieldValue& data) const {
 
     const unsigned length_row = get_length(from);
     from += packlength;
 
-    std::string tmp(from, length_row);
-
-    LOG_TRACE(log, "  blob: '" << tmp << "' // " << packlength << " " << length_row);
-    field_data = std::move(tmp);
+    LOG_TRACE(log, "  blob: '" << std::string_view(from, length_row) << "' // " << packlength << " " << length_row);
+    setFieldValue(data, from, length_row);
 
     return from + length_row;
 }
 
+DecodeStep Field_blob::decode_step() const {
+    return { DecodeOp::Blob, (unsigned char)packlength };
+}
+
 
-unsigned int Field_blob::get_length(const char *pos) {
+unsigned int Field_blob::get_length(const char *pos) const {
 
     switch (packlength)
     {
@@ -632,17 +849,28 @@ Field_decimal::Field_decimal(const std::string& field_name_arg, const std::strin
     field_length = (intg / 9) * 4 + dig2bytes[intg % 9] + (frac / 9) * 4 + dig2bytes[frac % 9];
 }
 
-const char* Field_decimal::unpack(const char *from)
+const char* Field_decimal::unpack_decimal(const char* from, decimal::Decimal& value) const
+{
+    decimal::from_binary(from, value, intg + frac, frac);
+    return from + pack_length();
+}
+
+const char* Field_decimal::unpack(const char* from, FieldValue& data) const
 {
     decimal::Decimal result;
     // maybe_unused, because it is only output to log as for now
     [[maybe_unused]]
     decimal::error err = decimal::from_binary(from, result, intg + frac, frac);
     LOG_TRACE(log, "decimal::unpack: -> '" << result << "', " << err);
-    field_data = result;
+    setFieldValue(data, result);
     return from + pack_length();
 }
 
+DecodeStep Field_decimal::decode_step() const
+{
+    return { DecodeOp::Decimal, (unsigned char)pack_length() };
+}
+
 
 Field_bit::Field_bit(const std::string& field_name_arg, const std::string& type)
     : Field(field_name_arg, type)
@@ -663,21 +891,36 @@ Field_bit::Field_bit(const std::string& field_name_arg, const std::string& type)
         throw std::runtime_error("Field_bit: incorrect data length");
 }
 
-const char* Field_bit::unpack(const char *from)
+const char* Field_bit::unpack_int(const char* from, int64_t& value) const
 {
-    uint64_t value = 0;
+    uint64_t tmp = 0;
 
     for (const char *b = from, *e = from + _pack_length; b < e; ++b)
     {
-        value <<= 8;
-        value |= *(const uint8*)b;
+        tmp <<= 8;
+        tmp |= *(const uint8*)b;
     }
 
+    value = tmp;
+    return from + _pack_length;
+}
+
+const char* Field_bit::unpack(const char* from, FieldValue& data) const
+{
+    int64_t tmp;
+    from = unpack_int(from, tmp);
+    const types::MY_BIT value = tmp;
+
     LOG_TRACE(log, "  bit: 0x" << std::hex << value);
 
-    field_data = value;
+    setFieldValue(data, value);
 
-    return from + _pack_length;
+    return from;
+}
+
+DecodeStep Field_bit::decode_step() const
+{
+    return { DecodeOp::Bit, (unsigned char)_pack_length };
 }
 
 } // namespace slave
@@ -17,6 +17,7 @@
 #define __SLAVE_FIELD_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <list>
 
@@ -31,15 +32,58 @@
 namespace slave
 {
 
+// How values of the column are stored in columnar mode, see ColumnarBatch
+enum class ColumnType
+{
+    Integer,    // int64_t, same value as in FieldValue
+    Real,       // double
+    Decimal,    // decimal::Decimal
+    String      // bytes
+};
+
+class Field;
+
+// Operation of DecodePlan, defines how the packed value is read and the type stored in FieldValue
+enum class DecodeOp : unsigned char
+{
+    Field,          // virtual Field::unpack(), for types without own operation
+    Tiny,           // char, 1 byte
+    Short,          // uint16, 2 bytes
+    Medium,         // uint32, 3 bytes
+    Long,           // uint32, 4 bytes
+    LongLong,       // ulonglong, 8 bytes
+    Float,          // float
+    Double,         // double
+    Date,           // uint32, 3 bytes
+    Timestamp,      // uint32, 4 bytes little endian, old storage
+    Timestamp2,     // uint32, 4 bytes big endian and fractional part of width - 4 bytes
+    Datetime,       // ulonglong, 8 bytes, old storage
+    Datetime2,      // ulonglong, 5 bytes big endian and fractional part of width - 5 bytes
+    Time,           // int32, 3 bytes, old storage
+    Enum,           // int, signed 1 or 2 bytes
+    Set,            // ulonglong, width bytes little endian
+    Bit,            // uint64_t, width bytes big endian
+    Decimal,        // decimal::Decimal
+    VarString,      // std::string with length of width bytes
+    Blob            // std::string with length of width bytes
+};
+
+struct DecodeStep
+{
+    DecodeOp op = DecodeOp::Field;
+    // Size of fixed width value or of length prefix
+    unsigned char width = 0;
+    const Field* field = nullptr;
+};
+
 class Field
 {
 public:
     const std::string field_type;
     const std::string field_name;
 
-    FieldValue field_data;
-
-    virtual const char* unpack(const char *from) = 0;
+    // Unpacks the value at 'from' into 'data', returns the end of the packed value
+    virtual const char* unpack(const char* from, FieldValue& data) const = 0;
 
     Field(const std::string& field_name_arg, const std::string& type) :
         field_type(type),
@@ -50,7 +94,23 @@ public:
 
     virtual unsigned int pack_length() const = 0;
 
-    const std::string getFieldName() {
+    // Returns the end of the packed value at 'from' without unpacking it
+    virtual const char* skip(const char* from) const { return from + pack_length(); }
+
+    // Packed value of string types as is, without copying. Returns false for other types.
+    virtual bool view(const char* from, std::string_view& value) const { return false; }
+
+    // Typed unpacking without FieldValue, only the one matching column_type() is implemented.
+    // Return the end of the packed value.
+    virtual ColumnType column_type() const { return ColumnType::Integer; }
+    virtual const char* unpack_int(const char* from, int64_t& value) const;
+    virtual const char* unpack_real(const char* from, double& value) const;
+    virtual const char* unpack_decimal(const char* from, decimal::Decimal& value) const;
+
+    // Operation of DecodePlan for the field, 'field' of the result is not set
+    virtual DecodeStep decode_step() const { return DecodeStep(); }
+
+    const std::string& getFieldName() const {
         return field_name;
     }
 };
@@ -89,7 +149,9 @@ class Field_tiny: public Field_num {
     unsigned int pack_length() const { return 1; }
 public:
     Field_tiny(const std::string& field_name_arg, const std::string& type);
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_short: public Field_num {
@@ -97,7 +159,9 @@ class Field_short: public Field_num {
 public:
     Field_short(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_medium: public Field_num {
@@ -105,7 +169,9 @@ class Field_medium: public Field_num {
 public:
     Field_medium(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_long: public Field_num {
@@ -113,7 +179,9 @@ class Field_long: public Field_num {
 public:
     Field_long(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_longlong: public Field_num {
@@ -121,7 +189,9 @@ class Field_longlong: public Field_num {
 public:
     Field_longlong(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_float: public Field_real {
@@ -129,7 +199,10 @@ class Field_float: public Field_real {
 public:
     Field_float(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    ColumnType column_type() const { return ColumnType::Real; }
+    const char* unpack_real(const char* from, double& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_double: public Field_real {
@@ -137,7 +210,10 @@ class Field_double: public Field_real {
 public:
     Field_double(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    ColumnType column_type() const { return ColumnType::Real; }
+    const char* unpack_real(const char* from, double& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_temporal: public Field_longstr {
@@ -148,6 +224,8 @@ public:
     virtual ~Field_temporal() {}
 
     virtual void reset(bool old_storage, bool ctor_call = false) = 0;
+
+    bool old_storage() const { return is_old_storage; }
 };
 
 class Field_timestamp: public Field_temporal {
@@ -155,7 +233,9 @@ public:
     Field_timestamp(const std::string& field_name_arg, const std::string& type, bool old_storage);
 
     void reset(bool old_storage, bool ctor_call = false);
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_year: public Field_tiny {
@@ -168,7 +248,9 @@ class Field_date: public Field_str {
 public:
     Field_date(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_time: public Field_temporal {
@@ -176,7 +258,9 @@ public:
     Field_time(const std::string& field_name_arg, const std::string& type, bool old_storage);
 
     void reset(bool old_storage, bool ctor_call = false);
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_datetime: public Field_temporal {
@@ -184,7 +268,12 @@ public:
     Field_datetime(const std::string& field_name_arg, const std::string& type, bool old_storage);
 
     void reset(bool old_storage, bool ctor_call = false);
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
+
+    // Value of new storage from its first 5 bytes read as big endian number
+    static unsigned long long datetime2(uint64_t packed);
 };
 
 class Field_varstring: public Field_longstr {
@@ -198,15 +287,23 @@ public:
     Field_varstring(const std::string& field_name_arg, const std::string& type,
                     const collate_info& collate);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* skip(const char* from) const;
+    bool view(const char* from, std::string_view& value) const;
+    ColumnType column_type() const { return ColumnType::String; }
+    DecodeStep decode_step() const;
 };
 
 class Field_blob: public Field_longstr {
-    unsigned int get_length(const char *ptr);
+    unsigned int get_length(const char *ptr) const;
 public:
     Field_blob(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* skip(const char* from) const;
+    bool view(const char* from, std::string_view& value) const;
+    ColumnType column_type() const { return ColumnType::String; }
+    DecodeStep decode_step() const;
 
 protected:
     // Number of bytes for holding the data length
@@ -236,9 +333,13 @@ class Field_enum: public Field_str {
 
 public:
     Field_enum(const std::string& field_name_arg, const std::string& type);
+    // Elements are not known, only their number
+    Field_enum(const std::string& field_name_arg, const std::string& type, unsigned short count);
 
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 
 protected:
     unsigned int packlength;
@@ -257,8 +358,11 @@ class Field_set: public Field_enum {
 
 public:
     Field_set(const std::string& field_name_arg, const std::string& type);
+    Field_set(const std::string& field_name_arg, const std::string& type, unsigned short count);
 
-    const char* unpack(const char* from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_decimal : public Field_longstr {
@@ -266,7 +370,10 @@ class Field_decimal : public Field_longstr {
     int frac;
 public:
     Field_decimal(const std::string& field_name_arg, const std::string& type);
-    const char* unpack(const char *from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    ColumnType column_type() const { return ColumnType::Decimal; }
+    const char* unpack_decimal(const char* from, decimal::Decimal& value) const;
+    DecodeStep decode_step() const;
 };
 
 class Field_bit : public Field
@@ -276,7 +383,9 @@ class Field_bit : public Field
 public:
     Field_bit(const std::string& field_name_arg, const std::string& type);
 
-    const char* unpack(const char *from);
+    const char* unpack(const char* from, FieldValue& data) const;
+    const char* unpack_int(const char* from, int64_t& value) const;
+    DecodeStep decode_step() const;
 
     unsigned int pack_length() const {
         return _pack_length;
@@ -37,6 +37,8 @@ struct mysql_conn_opts
     unsigned int mysql_connect_timeout  = 10;
     unsigned int mysql_read_timeout     = 60 * 15;
     unsigned int mysql_write_timeout    = 60 * 15;
+    // Use compressed client/server protocol, trades CPU for network traffic
+    bool        mysql_compress          = false;
 };
 
 class Connection {
@@ -113,6 +115,11 @@ public:
             mysql_options(connection, MYSQL_OPT_WRITE_TIMEOUT, &write_timeout);
         }
 
+        if (opts.mysql_compress)
+        {
+            mysql_options(connection, MYSQL_OPT_COMPRESS, nullptr);
+        }
+
         mysql_ssl_set( connection
                      , opts.mysql_ssl_key.empty() ? nullptr : opts.mysql_ssl_key.c_str()
                      , opts.mysql_ssl_cert.empty() ? nullptr : opts.mysql_ssl_cert.c_str()
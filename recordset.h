@@ -16,8 +16,13 @@
 #define __SLAVE_RECORDSET_H_
 
 #include <map>
+#include <memory_resource>
 #include <string>
+#include <vector>
 
+#include "ArenaRow.h"
+#include "binlog_pos.h"
+#include "FlatRow.h"
 #include "types.h"
 
 namespace slave
@@ -33,6 +38,10 @@ struct RecordSet
     Row       m_old_row;
     RowVector m_row_vec;
     RowVector m_old_row_vec;
+    FlatRow   m_row_flat;
+    FlatRow   m_old_row_flat;
+    ArenaRow  m_row_arena;
+    ArenaRow  m_old_row_arena;
     RowType   row_type = RowType::Map;
 
     std::string tbl_name;
@@ -46,6 +55,71 @@ struct RecordSet
 
     // Root master ID from which this record originated
     unsigned int master_id = 0;
+
+    // Drops the row before update, which is left in a reused RecordSet by a previous update.
+    // Its storage is kept aside for the next update, see reuse_old_row()
+    void clear_old_row()
+    {
+        if (!m_old_row.empty())
+            m_old_row.swap(m_old_row_storage.row);
+        if (!m_old_row_vec.empty())
+            m_old_row_vec.swap(m_old_row_storage.row_vec);
+        if (m_old_row_flat.size())
+            std::swap(m_old_row_flat, m_old_row_storage.row_flat);
+        if (m_old_row_arena.size())
+            std::swap(m_old_row_arena, m_old_row_storage.row_arena);
+    }
+
+    // Takes back the storage of the row before update dropped by clear_old_row(), to be overwritten
+    void reuse_old_row()
+    {
+        if (m_old_row.empty())
+            m_old_row.swap(m_old_row_storage.row);
+        if (m_old_row_vec.empty())
+            m_old_row_vec.swap(m_old_row_storage.row_vec);
+        if (!m_old_row_flat.size())
+            std::swap(m_old_row_flat, m_old_row_storage.row_flat);
+        if (!m_old_row_arena.size())
+            std::swap(m_old_row_arena, m_old_row_storage.row_arena);
+    }
+
+private:
+    // Storage of the dropped row before update, it is not copied with RecordSet
+    struct OldRowStorage
+    {
+        Row       row;
+        RowVector row_vec;
+        FlatRow   row_flat;
+        ArenaRow  row_arena;
+
+        OldRowStorage() = default;
+        OldRowStorage(const OldRowStorage&) {}
+        OldRowStorage(OldRowStorage&&) = default;
+        OldRowStorage& operator=(const OldRowStorage&) { return *this; }
+        OldRowStorage& operator=(OldRowStorage&&) = default;
+    };
+
+    OldRowStorage m_old_row_storage;
+};
+
+// Rows of one transaction, from BEGIN to XID_EVENT (or COMMIT for non-transactional tables),
+// in the order of binlog. See Slave::setTransactionCallback.
+struct Transaction
+{
+    std::vector<RecordSet> records;
+
+    // Binlog position of the end of the transaction
+    std::string   log_name;
+    unsigned long log_pos = 0;
+    // Empty if GTID is not used
+    gtid_t        gtid;
+
+    time_t when = 0;
+    unsigned int master_id = 0;
+
+    // Rows of RowType::Arena are allocated here. It is released at once after the transaction
+    // callback returns, so they must not be used after that, copy them instead.
+    std::pmr::memory_resource* arena = nullptr;
 };
 
 }// slave
@@ -16,11 +16,15 @@
 #define __SLAVE_RELAYLOGINFO_H_
 
 #include "table.h"
+#include "TableIdCache.h"
 #include "TableKey.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 
 
@@ -39,25 +43,93 @@ public:
     typedef std::map<TableKey, PtrTable> name_to_table_t;
     name_to_table_t m_table_map;
 
+    // Sorted keys of m_map_table_name, for fast rejecting of row events of not replicated tables
+    std::vector<unsigned long> m_table_ids;
+
+    // Tables of the mapped table ids, to resolve row events without lookups by name,
+    // and ids of not replicated tables. Dropped when any table is rebuilt.
+    TableIdCache m_table_cache;
+
 
     void clear() {
         m_map_table_name.clear();
         m_table_map.clear();
+        m_table_ids.clear();
+        m_table_cache.clear();
+    }
+
+
+    // map_hash and map_body are Table_map_event_info::m_hash and m_body of the map event, see isTableMapProcessed()
+    void setTableName(unsigned long table_id, std::string_view table_name, std::string_view db_name,
+                      size_t map_hash = 0, std::string_view map_body = {}) {
+        // Strings of the known table id are assigned in place, without allocation
+        TableKey& key = m_map_table_name[table_id];
+        key.db_name = db_name;
+        key.table_name = table_name;
+
+        const auto it = std::lower_bound(m_table_ids.begin(), m_table_ids.end(), table_id);
+        if (it == m_table_ids.end() || *it != table_id)
+            m_table_ids.insert(it, table_id);
+
+        if (Table* table = getTable(key).get())
+            m_table_cache.set(table_id, table, map_hash, map_body);
     }
 
+    // TABLE_MAP_EVENT of not replicated table: row events of the id are skipped with one cache lookup
+    void setIgnoredTableId(unsigned long table_id, size_t map_hash = 0, std::string_view map_body = {})
+    {
+        const TableIdCache::Entry* entry = m_table_cache.find(table_id);
+        if (!entry || entry->table) {
+            // The id may be reused by the server for another table
+            m_map_table_name.erase(table_id);
+            const auto it = std::lower_bound(m_table_ids.begin(), m_table_ids.end(), table_id);
+            if (it != m_table_ids.end() && *it == table_id)
+                m_table_ids.erase(it);
+        }
+
+        m_table_cache.set(table_id, nullptr, map_hash, map_body);
+    }
+
+    // The same map event was the last one processed for the table id, so it can be skipped.
+    // The hash is compared first, bodies are compared only if it matches.
+    // 'table' is set to the table of the id, nullptr if it is not replicated.
+    bool isTableMapProcessed(unsigned long table_id, size_t map_hash, std::string_view map_body, Table*& table) const
+    {
+        const TableIdCache::Entry* entry = m_table_cache.find(table_id);
+        if (!entry || !entry->map_hash || entry->map_hash != map_hash || entry->map_body != map_body)
+            return false;
+        table = entry->table;
+        return true;
+    }
+
+    bool hasTableId(unsigned long table_id) const
+    {
+        if (const TableIdCache::Entry* entry = m_table_cache.find(table_id))
+            return entry->table;
+        return std::binary_search(m_table_ids.begin(), m_table_ids.end(), table_id);
+    }
+
+    // nullptr if the table id is not mapped or its table is not replicated
+    Table* getTableById(unsigned long table_id)
+    {
+        if (const TableIdCache::Entry* entry = m_table_cache.find(table_id))
+            return entry->table;
 
-    void setTableName(unsigned long table_id, const std::string& table_name, const std::string& db_name) {
-        m_map_table_name[table_id] = {db_name, table_name};
+        Table* table = getTable(getTableNameById(table_id)).get();
+        if (table)
+            m_table_cache.set(table_id, table);
+        return table;
     }
 
-    TableKey getTableNameById(int table_id) const
+    const TableKey& getTableNameById(unsigned long table_id) const
     {
+        static const TableKey empty;
         id_to_name_t::const_iterator p = m_map_table_name.find(table_id);
 
         if (p != m_map_table_name.end()) {
             return p->second;
         } else {
-            return {};
+            return empty;
         }
     }
 
@@ -75,6 +147,8 @@ public:
     void setTable(const std::string& table_name, const std::string& db_name, PtrTable&& table)
     {
         m_table_map[{db_name, table_name}] = std::move(table);
+        // Cached pointer may refer to the replaced table
+        m_table_cache.clear();
     }
 
 };
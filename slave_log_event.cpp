@@ -12,7 +12,10 @@
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <set>
@@ -24,8 +27,10 @@
 
 #include <mysql/mysql.h>
 
-#include <zlib.h>
-
+#include "crc32.h"
+#include "ParallelApply.h"
+#include "ParallelDecode.h"
+#include "TypedBinding.h"
 #include "relayloginfo.h"
 #include "slave_log_event.h"
 
@@ -47,14 +52,6 @@ void bin2hex_nz(char* dst, const uint8_t* src, size_t sz_src)
         *dst++ = hex[src[i] & 0x0f];
     }
 }
-
-std::string bin2hex(const uint8_t* src, size_t sz_src)
-{
-    std::string res;
-    res.resize(sz_src * 2);
-    bin2hex_nz(const_cast<char*>(res.data()), src, sz_src);
-    return res;
-}
 } // namespace anonymous
 
 namespace slave {
@@ -93,11 +90,11 @@ Rotate_event_info::Rotate_event_info(const char* buf, unsigned int event_len) {
 }
 
 
-Query_event_info::Query_event_info(const char* buf, unsigned int event_len) {
+void Query_event_info::parse(const char* buf, unsigned int event_len) {
 
     if (event_len < LOG_EVENT_HEADER_LEN + QUERY_HEADER_LEN) {
         LOG_ERROR(log, "Sanity check failed: " << event_len << " " << LOG_EVENT_HEADER_LEN + QUERY_HEADER_LEN);
-        throw std::runtime_error("Query_event_info::Query_event_info failed");
+        throw std::runtime_error("Query_event_info::parse failed");
     }
 
     unsigned int db_len = (unsigned int)buf[LOG_EVENT_HEADER_LEN + Q_DB_LEN_OFFSET];
@@ -112,36 +109,46 @@ Query_event_info::Query_event_info(const char* buf, unsigned int event_len) {
 }
 
 
-Table_map_event_info::Table_map_event_info(const char* buf, unsigned int event_len) {
+void Table_map_event_info::parse_header(const char* buf, unsigned int event_len) {
 
     if (event_len < LOG_EVENT_HEADER_LEN + TABLE_MAP_HEADER_LEN + 2) {
         LOG_ERROR(log, "Sanity check failed: " << event_len << " " << LOG_EVENT_HEADER_LEN + TABLE_MAP_HEADER_LEN + 2);
-        throw std::runtime_error("Table_map_event_info::Table_map_event_info failed");
+        throw std::runtime_error("Table_map_event_info::parse failed");
     }
 
     m_table_id = uint6korr(buf + LOG_EVENT_HEADER_LEN + TM_MAPID_OFFSET);
+    m_body = std::string_view(buf + LOG_EVENT_HEADER_LEN, event_len - LOG_EVENT_HEADER_LEN);
+    m_hash = std::hash<std::string_view>()(m_body);
+}
+
+void Table_map_event_info::parse_body(const char* buf, unsigned int event_len) {
 
     unsigned char* p_dblen = (unsigned char*)(buf + LOG_EVENT_HEADER_LEN + TABLE_MAP_HEADER_LEN);
     size_t dblen = *(p_dblen);
 
-    m_dbnam.assign((const char*)(p_dblen + 1), dblen);
+    m_dbnam = std::string_view((const char*)(p_dblen + 1), dblen);
 
     unsigned char* p_tblen = p_dblen + dblen + 2;
     size_t tblen = *(p_tblen);
 
-    m_tblnam.assign((const char*)(p_tblen + 1), tblen);
+    m_tblnam = std::string_view((const char*)(p_tblen + 1), tblen);
 
     unsigned char* p_width = p_tblen + tblen + 2;
-    unsigned long width = net_field_length(&p_width);
+    m_width = net_field_length(&p_width);
+    m_cols_types = p_width;
+    m_end = (const unsigned char*)buf + event_len;
 
-    m_cols_types.assign(p_width, p_width + width);
+    if (m_cols_types + m_width > m_end) {
+        LOG_ERROR(log, "Sanity check failed: " << m_width << " columns of " << event_len << " bytes event");
+        throw std::runtime_error("Table_map_event_info::parse failed");
+    }
 }
 
-Row_event_info::Row_event_info(const char* buf, unsigned int event_len, bool do_update, bool master_ge_56) {
+void Row_event_info::parse(const char* buf, unsigned int event_len, bool do_update, bool master_ge_56) {
     const unsigned int rows_header_len = master_ge_56 ? ROWS_HEADER_LEN : ROWS_HEADER_LEN_V1;
     if (event_len < LOG_EVENT_HEADER_LEN + rows_header_len + 2) {
         LOG_ERROR(log, "Sanity check failed: " << event_len << " " << LOG_EVENT_HEADER_LEN + rows_header_len + 2);
-        throw std::runtime_error("Row_event_info::Row_event_info failed");
+        throw std::runtime_error("Row_event_info::parse failed");
     }
 
     has_after_image = do_update;
@@ -160,20 +167,23 @@ Row_event_info::Row_event_info(const char* buf, unsigned int event_len, bool do_
 
         m_cols_ai.assign(start, start + m_cols.size());
         start += m_cols_ai.size();
+    } else {
+        m_cols_ai.clear();
     }
 
     m_rows_buf = start;
     m_rows_end = start + (event_len - ((char*)start - buf));
 }
 
-Gtid_event_info::Gtid_event_info(const char* buf, unsigned int event_len)
+void Gtid_event_info::parse(const char* buf, unsigned int event_len)
 {
     if (event_len < LOG_EVENT_HEADER_LEN + GTID_EVENT_LEN) {
         LOG_ERROR(log, "Sanity check failed: " << event_len << " " << LOG_EVENT_HEADER_LEN + GTID_EVENT_LEN);
-        throw std::runtime_error("Gtid_event_info::Gtid_event_info failed");
+        throw std::runtime_error("Gtid_event_info::parse failed");
     }
 
-    m_sid = bin2hex((uchar*)buf + LOG_EVENT_HEADER_LEN + ENCODED_FLAG_LENGTH, ENCODED_SID_LENGTH);
+    m_sid.resize(ENCODED_SID_LENGTH * 2);
+    bin2hex_nz(&m_sid[0], (uchar*)buf + LOG_EVENT_HEADER_LEN + ENCODED_FLAG_LENGTH, ENCODED_SID_LENGTH);
     m_gno = sint8korr(buf + LOG_EVENT_HEADER_LEN + ENCODED_FLAG_LENGTH + ENCODED_SID_LENGTH);
 }
 
@@ -247,13 +257,39 @@ inline void check_format_description(const char* buf, unsigned int event_len, bo
 }
 
 
-inline uint32_t checksum_crc32(uint32_t crc, const unsigned char* pos, size_t length)
+inline bool checksum_matches(const char* buf, uint event_len, uint32_t& incoming, uint32_t& computed)
 {
-    return static_cast<uint32_t>(::crc32(static_cast<unsigned int>(crc), pos, static_cast<unsigned int>(length)));
+    ::memcpy(&incoming, buf + event_len - BINLOG_CHECKSUM_LEN, sizeof(incoming));
+    incoming = le32toh(incoming);
+
+    computed = checksum_crc32(0L, nullptr, 0);
+    computed = checksum_crc32(computed, (const unsigned char*)buf, event_len - BINLOG_CHECKSUM_LEN);
+
+    return incoming == computed;
 }
 
 
-bool read_log_event(const char* buf, uint event_len, Basic_event_info& bei, EventStatIface* event_stat, bool master_ge_56, MasterInfo& master_info)
+bool verify_event_checksum(const char* buf, uint event_len, bool master_ge_56, enum_binlog_checksum_alg& alg)
+{
+    if (event_len < LOG_EVENT_HEADER_LEN || (uint) event_len != uint4korr(buf+EVENT_LEN_OFFSET))
+        return false;
+
+    if (master_ge_56 && (uchar) buf[EVENT_TYPE_OFFSET] == FORMAT_DESCRIPTION_EVENT)
+    {
+        const enum_binlog_checksum_alg event_alg = static_cast<enum_binlog_checksum_alg>(*(buf + event_len - BINLOG_CHECKSUM_LEN - BINLOG_CHECKSUM_ALG_DESC_LEN));
+        if (event_alg == BINLOG_CHECKSUM_ALG_OFF || event_alg == BINLOG_CHECKSUM_ALG_CRC32)
+            alg = event_alg;
+    }
+
+    if (alg != BINLOG_CHECKSUM_ALG_CRC32)
+        return false;
+
+    uint32_t incoming, computed;
+    return checksum_matches(buf, event_len, incoming, computed);
+}
+
+
+bool read_log_event(const char* buf, uint event_len, Basic_event_info& bei, EventStatIface* event_stat, bool master_ge_56, MasterInfo& master_info, bool verify_checksum)
 
 {
 
@@ -279,14 +315,8 @@ bool read_log_event(const char* buf, uint event_len, Basic_event_info& bei, Even
 
     if (master_info.checksumEnabled())
     {
-        uint32_t incoming;
-        ::memcpy(&incoming, buf + event_len - BINLOG_CHECKSUM_LEN, sizeof(incoming));
-        incoming = le32toh(incoming);
-
-        uint32_t computed = checksum_crc32(0L, nullptr, 0);
-        computed = checksum_crc32(computed, (const unsigned char*)buf, event_len - BINLOG_CHECKSUM_LEN);
-
-        if (incoming != computed)
+        uint32_t incoming, computed;
+        if (verify_checksum && !checksum_matches(buf, event_len, incoming, computed))
         {
             LOG_ERROR(log, "CRC32 check failed: incoming (" << incoming << ") != computed (" << computed << ")");
             throw std::runtime_error("slave::read_log_event failed");
@@ -407,37 +437,183 @@ size_t n_set_bits(const std::vector<unsigned char>& b, unsigned int count) {
     return ret;
 }
 
+// Slot of the row for the value of field 'index', the value is unpacked right into it.
+// 'position' is the number of columns of the row image before the field.
+// nullptr if the field is excluded by column filter.
 template <typename T>
-void fill_row(const slave::Table& table, T& row, unsigned index, const slave::FieldValue& value);
+slave::FieldValue* row_slot(const slave::Table& table, T& row, unsigned index, unsigned position);
 
 template <>
-void fill_row<slave::Row>(const slave::Table& table, slave::Row& row, unsigned index, const slave::FieldValue& value)
+slave::FieldValue* row_slot<slave::Row>(const slave::Table& table, slave::Row& row, unsigned index, unsigned position)
 {
+    if (!table.is_selected(index))
+        return nullptr;
+
+    // Node of the previous row is reused, the key is not copied then
     const auto& field = table.fields[index];
-    if (table.column_filter.empty() || table.column_filter[index / 8] & (1 << (index & 7)))
-        row[field->getFieldName()] = std::make_pair(field->field_type, value);
+    auto& cell = row[field->getFieldName()];
+    cell.first = field->field_type;
+    return &cell.second;
 }
 
 template <>
-void fill_row<slave::RowVector>(const slave::Table& table, slave::RowVector& row, unsigned index, const slave::FieldValue& value)
+slave::FieldValue* row_slot<slave::RowVector>(const slave::Table& table, slave::RowVector& row, unsigned index, unsigned position)
+{
+    if (!table.is_selected(index))
+        return nullptr;
+
+    auto& cell = row[table.column_filter.empty() ? position : table.column_filter_fields[index]];
+    cell.first = table.fields[index]->field_type;
+    return &cell.second;
+}
+
+template <>
+slave::FieldValue* row_slot<slave::FlatRow>(const slave::Table& table, slave::FlatRow& row, unsigned index, unsigned position)
 {
-    const auto& field = table.fields[index];
     if (table.column_filter.empty())
-        row.emplace_back(field->field_type, value);
-    else if (table.column_filter[index / 8] & (1 << (index & 7)))
-        row[table.column_filter_fields[index]] = std::make_pair(field->field_type, value);
+        return &row.emplace(index);
+    if (!table.is_selected(index))
+        return nullptr;
+    return &row.emplace(table.column_filter_fields[index]);
 }
 
+// Prepares the row of the previous row image for the next one with 'count' columns.
+// Storage of values is kept when all columns are present, so they are just overwritten.
 template <typename T>
-void reserve_row(const slave::Table& table, T& row) {}
+void reserve_row(const slave::Table& table, T& row, unsigned count, bool all_cols);
 
 template <>
-void reserve_row<slave::RowVector>(const slave::Table& table, slave::RowVector& row)
+void reserve_row<slave::Row>(const slave::Table& table, slave::Row& row, unsigned count, bool all_cols)
 {
-    if (table.column_filter.empty())
-        row.reserve(table.fields.size());
-    else
-        row.resize(table.column_filter_count);
+    if (!all_cols)
+        row.clear();
+}
+
+template <>
+void reserve_row<slave::RowVector>(const slave::Table& table, slave::RowVector& row, unsigned count, bool all_cols)
+{
+    if (table.column_filter.empty()) {
+        row.resize(count);
+        return;
+    }
+
+    row.resize(table.column_filter_count);
+    if (!all_cols) {
+        for (auto& cell : row) {
+            cell.first.clear();
+            cell.second = slave::FieldValue();
+        }
+    }
+}
+
+template <>
+void reserve_row<slave::FlatRow>(const slave::Table& table, slave::FlatRow& row, unsigned count, bool all_cols)
+{
+    row.reset(table.row_schema());
+}
+
+// Hash of raw primary key values of a row, for choosing a worker in parallel apply mode
+struct KeyHash
+{
+    uint64_t value = 14695981039346656037ULL;
+    // Number of key fields hashed
+    unsigned fields = 0;
+    // Hash of key fields of the row after update, there are none if the update does not touch the key
+    uint64_t after_value = 14695981039346656037ULL;
+    unsigned after_fields = 0;
+
+    void set_after(const KeyHash& after)
+    {
+        after_value = after.value;
+        after_fields = after.fields;
+    }
+
+    void add(const unsigned char* begin, const unsigned char* end)
+    {
+        for (; begin != end; ++begin)
+            value = (value ^ *begin) * 1099511628211ULL;
+        ++fields;
+    }
+
+    // Whole key is hashed, there were no NULL or absent key fields
+    bool complete(const slave::Table& table) const
+    {
+        return !table.primary_key.empty() && fields == table.primary_key.size();
+    }
+
+    // Update changes the key, or may change it if only a part of the key is in the row after update
+    bool changed(const slave::Table& table) const
+    {
+        return after_fields && (after_fields != table.primary_key.size() || after_value != value);
+    }
+
+    bool after_complete(const slave::Table& table) const
+    {
+        return after_fields == table.primary_key.size();
+    }
+
+    uint64_t mixed() const { return mix(value); }
+    uint64_t after_mixed() const { return mix(after_value); }
+
+    static uint64_t mix(uint64_t h)
+    {
+        // FNV has weak low bits, and worker is chosen by modulo
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+bool all_bits_set(const std::vector<unsigned char>& b, unsigned int count)
+{
+    if (b.empty())
+        return true;
+
+    for (unsigned int i = 0; i < count / 8; ++i)
+        if (b[i] != 0xFF)
+            return false;
+
+    if (!(count & 7))
+        return true;
+
+    const unsigned char tail = (1 << (count & 7)) - 1;
+    return (b[count / 8] & tail) == tail;
+}
+
+bool all_bytes_zero(const unsigned char* begin, const unsigned char* end)
+{
+    for (; begin != end; ++begin)
+        if (*begin)
+            return false;
+    return true;
+}
+
+// Row with all columns present and without NULL values, decoded by the plan of the table
+template <typename T>
+unsigned char* unpack_full_row(const slave::Table& table,
+                               T& _row,
+                               unsigned int colcnt,
+                               unsigned char* ptr,
+                               KeyHash* key)
+{
+    const slave::DecodePlan& plan = table.plan;
+    auto key_field = table.primary_key.begin();
+
+    for (unsigned i = 0; i < colcnt; i++)
+    {
+        const char* const field_start = (const char*)ptr;
+        if (slave::FieldValue* slot = row_slot<T>(table, _row, i, i))
+            ptr = (unsigned char*)plan.unpack(i, field_start, *slot);
+        else
+            ptr = (unsigned char*)plan.skip(i, field_start);
+        if (key && key_field != table.primary_key.end() && *key_field == i) {
+            key->add((const unsigned char*)field_start, ptr);
+            ++key_field;
+        }
+    }
+
+    return ptr;
 }
 
 template <typename T>
@@ -445,7 +621,8 @@ unsigned char* unpack_row(const slave::Table& table,
                           T& _row,
                           unsigned int colcnt,
                           unsigned char* row,
-                          const std::vector<unsigned char>& cols)
+                          const std::vector<unsigned char>& cols,
+                          KeyHash* key = nullptr)
 {
 
     LOG_TRACE(log, "Unpacking row: " << "fields in the table " << table.fields.size() << ", fields in the event " << colcnt
@@ -457,25 +634,40 @@ unsigned char* unpack_row(const slave::Table& table,
         throw std::runtime_error("unpack_row failed");
     }
 
+    // Plan is not built for tables created by hand
+    const bool use_plan = table.plan.size() == colcnt;
+    const bool all_cols = all_bits_set(cols, colcnt);
+    const unsigned present_count = all_cols ? colcnt : n_set_bits(cols, colcnt);
+
+    reserve_row<T>(table, _row, present_count, all_cols);
 
     // pointer to start of data; skip master_null_bytes
 
-    size_t master_null_byte_count = (n_set_bits(cols, colcnt) + 7) / 8;
+    size_t master_null_byte_count = (present_count + 7) / 8;
 
     unsigned char* ptr = row + master_null_byte_count;
 
+    if (use_plan && all_cols && all_bytes_zero(row, ptr))
+        return unpack_full_row(table, _row, colcnt, ptr, key);
+
     //
     unsigned char* null_ptr = row;
     unsigned int null_mask = 1U;
     unsigned char null_bits = *null_ptr++;
 
-    reserve_row<T>(table, _row);
+    // Next primary key field to hash
+    auto key_field = table.primary_key.begin();
+    // Columns of the row image before the current one
+    unsigned position = 0;
 
     for (unsigned i = 0; i < colcnt; i++)
     {
         const auto& field = table.fields[i];
+        const bool is_key = key && key_field != table.primary_key.end() && *key_field == i;
+        if (is_key)
+            ++key_field;
 
-        if (!cols.empty() && !(cols[i / 8] & (1 << (i & 7)))) {
+        if (!all_cols && !(cols[i / 8] & (1 << (i & 7)))) {
 
             LOG_TRACE(log, "field " << field->getFieldName() << " is not in column list.");
             continue;
@@ -496,16 +688,32 @@ unsigned char* unpack_row(const slave::Table& table,
             // and put empty slave::FieldValue value to slave::Row's value
             // in order to indicate presence of NULL value.
 
-            fill_row<T>(table, _row, i, nullFieldValue());
+            if (slave::FieldValue* slot = row_slot<T>(table, _row, i, position))
+                *slot = nullFieldValue();
         }
         else
         {
-            // We unpack the field to some certain value if it was NOT NULL
-            ptr = (unsigned char*)field->unpack((const char*)ptr);
-            fill_row<T>(table, _row, i, field->field_data);
+            // We unpack the field to some certain value if it was NOT NULL,
+            // right into the row
+            unsigned char* const field_start = ptr;
+            slave::FieldValue* const slot = row_slot<T>(table, _row, i, position);
+            if (!slot) {
+                // Only the length of the value excluded by column filter is read
+                if (use_plan)
+                    ptr = (unsigned char*)table.plan.skip(i, (const char*)ptr);
+                else
+                    ptr = (unsigned char*)field->skip((const char*)ptr);
+            } else if (use_plan) {
+                ptr = (unsigned char*)table.plan.unpack(i, (const char*)ptr, *slot);
+            } else {
+                ptr = (unsigned char*)field->unpack((const char*)ptr, *slot);
+            }
+            if (is_key)
+                key->add(field_start, ptr);
         }
 
         null_mask <<= 1;
+        ++position;
 
         LOG_TRACE(log, "field: " << field->getFieldName());
 
@@ -515,19 +723,82 @@ unsigned char* unpack_row(const slave::Table& table,
 }
 
 
-unsigned char* do_writedelete_row(const slave::Table& table,
-                                  const Basic_event_info& bei,
-                                  const Row_event_info& roi,
-                                  unsigned char* row_start,
-                                  ExtStateIface &ext_state) {
+void call_callback(const slave::Table& table,
+                   slave::RecordSet& _record_set,
+                   ExtStateIface &ext_state,
+                   slave::ParallelApply* parallel,
+                   slave::Transaction* transaction,
+                   const KeyHash& key)
+{
+    if (transaction) {
+        table.count_callback(ext_state);
+        transaction->records.push_back(std::move(_record_set));
+        return;
+    }
 
-    slave::RecordSet _record_set;
+    if (!parallel) {
+        table.call_callback(_record_set, ext_state);
+        return;
+    }
 
-    unsigned char* t = nullptr;
-    if (table.row_type == RowType::Map)
-        t = unpack_row(table, _record_set.m_row, roi.m_width, row_start, roi.m_cols);
-    else
-        t = unpack_row(table, _record_set.m_row_vec, roi.m_width, row_start, roi.m_cols);
+    table.count_callback(ext_state);
+    // Rows of a table without primary key are delivered by one worker in order
+    if (!key.complete(table)) {
+        parallel->push(std::hash<std::string>()(table.full_name), table, std::move(_record_set));
+        return;
+    }
+    // Update of the key is ordered with the rows of both keys
+    if (key.changed(table)) {
+        if (key.after_complete(table))
+            parallel->push(key.mixed(), key.after_mixed(), table, std::move(_record_set));
+        else
+            parallel->push_ordered(table, std::move(_record_set));
+        return;
+    }
+    parallel->push(key.mixed(), table, std::move(_record_set));
+}
+
+// Unpacks a row image into the row of RecordSet of the type of the table
+unsigned char* unpack_image(const slave::Table& table,
+                            const Row_event_info& roi,
+                            unsigned char* row_start,
+                            const std::vector<unsigned char>& cols,
+                            slave::Row& row,
+                            slave::RowVector& row_vec,
+                            slave::FlatRow& row_flat,
+                            slave::ArenaRow& row_arena,
+                            std::pmr::memory_resource* arena,
+                            KeyHash* key) {
+
+    switch (table.row_type) {
+    case RowType::Map:
+        return unpack_row(table, row, roi.m_width, row_start, cols, key);
+    case RowType::Vector:
+        return unpack_row(table, row_vec, roi.m_width, row_start, cols, key);
+    case RowType::Flat:
+        return unpack_row(table, row_flat, roi.m_width, row_start, cols, key);
+    case RowType::Arena:
+    {
+        // Decoded as FlatRow and copied into the memory of the transaction, if any
+        unsigned char* t = unpack_row(table, table.m_arena_row, roi.m_width, row_start, cols, key);
+        row_arena.assign(table.m_arena_row, arena ? arena : std::pmr::get_default_resource());
+        return t;
+    }
+    }
+    return NULL;
+}
+
+unsigned char* unpack_writedelete_row(const slave::Table& table,
+                                      const Basic_event_info& bei,
+                                      const Row_event_info& roi,
+                                      unsigned char* row_start,
+                                      slave::RecordSet& _record_set,
+                                      std::pmr::memory_resource* arena,
+                                      KeyHash* key) {
+
+    unsigned char* t = unpack_image(table, roi, row_start, roi.m_cols,
+                                    _record_set.m_row, _record_set.m_row_vec, _record_set.m_row_flat,
+                                    _record_set.m_row_arena, arena, key);
 
     if (t == NULL) {
         return NULL;
@@ -540,37 +811,37 @@ unsigned char* do_writedelete_row(const slave::Table& table,
     _record_set.type_event = (bei.type == WRITE_ROWS_EVENT_V1 || bei.type == WRITE_ROWS_EVENT ? slave::RecordSet::Write : slave::RecordSet::Delete);
     _record_set.master_id = bei.server_id;
 
-    table.call_callback(_record_set, ext_state);
-
     return t;
 }
 
-unsigned char* do_update_row(const slave::Table& table,
-                             const Basic_event_info& bei,
-                             const Row_event_info& roi,
-                             unsigned char* row_start,
-                             ExtStateIface &ext_state) {
-
-    slave::RecordSet _record_set;
+unsigned char* unpack_update_row(const slave::Table& table,
+                                 const Basic_event_info& bei,
+                                 const Row_event_info& roi,
+                                 unsigned char* row_start,
+                                 slave::RecordSet& _record_set,
+                                 std::pmr::memory_resource* arena,
+                                 KeyHash* key) {
 
-    unsigned char* t = nullptr;
-    if (table.row_type == RowType::Map)
-        t = unpack_row(table, _record_set.m_old_row, roi.m_width, row_start, roi.m_cols);
-    else
-        t = unpack_row(table, _record_set.m_old_row_vec, roi.m_width, row_start, roi.m_cols);
+    _record_set.reuse_old_row();
+    // Row is routed by the key before update, and by the key after update if it is changed
+    unsigned char* t = unpack_image(table, roi, row_start, roi.m_cols,
+                                    _record_set.m_old_row, _record_set.m_old_row_vec, _record_set.m_old_row_flat,
+                                    _record_set.m_old_row_arena, arena, key);
 
     if (t == NULL) {
         return NULL;
     }
 
-    if (table.row_type == RowType::Map)
-        t = unpack_row(table, _record_set.m_row, roi.m_width, t, roi.m_cols_ai);
-    else
-        t = unpack_row(table, _record_set.m_row_vec, roi.m_width, t, roi.m_cols_ai);
+    KeyHash after;
+    t = unpack_image(table, roi, t, roi.m_cols_ai,
+                     _record_set.m_row, _record_set.m_row_vec, _record_set.m_row_flat,
+                     _record_set.m_row_arena, arena, key ? &after : nullptr);
 
     if (t == NULL) {
         return NULL;
     }
+    if (key)
+        key->set_after(after);
 
     _record_set.row_type = table.row_type;
     _record_set.when = bei.when;
@@ -579,11 +850,354 @@ unsigned char* do_update_row(const slave::Table& table,
     _record_set.type_event = slave::RecordSet::Update;
     _record_set.master_id = bei.server_id;
 
-    table.call_callback(_record_set, ext_state);
+    return t;
+}
+
+unsigned char* do_writedelete_row(const slave::Table& table,
+                                  const Basic_event_info& bei,
+                                  const Row_event_info& roi,
+                                  unsigned char* row_start,
+                                  ExtStateIface &ext_state,
+                                  slave::ParallelApply* parallel,
+                                  slave::Transaction* transaction) {
+
+    // Moved out in transaction and parallel modes, otherwise its storage is reused by the next row
+    slave::RecordSet& _record_set = table.m_record;
+    _record_set.clear_old_row();
+    KeyHash key;
+
+    unsigned char* t = unpack_writedelete_row(table, bei, roi, row_start, _record_set,
+                                              transaction ? transaction->arena : nullptr, parallel ? &key : nullptr);
+    if (t == NULL) {
+        return NULL;
+    }
+
+    call_callback(table, _record_set, ext_state, parallel, transaction, key);
 
     return t;
 }
 
+unsigned char* do_update_row(const slave::Table& table,
+                             const Basic_event_info& bei,
+                             const Row_event_info& roi,
+                             unsigned char* row_start,
+                             ExtStateIface &ext_state,
+                             slave::ParallelApply* parallel,
+                             slave::Transaction* transaction) {
+
+    // Moved out in transaction and parallel modes, otherwise its storage is reused by the next row
+    slave::RecordSet& _record_set = table.m_record;
+    KeyHash key;
+
+    unsigned char* t = unpack_update_row(table, bei, roi, row_start, _record_set,
+                                         transaction ? transaction->arena : nullptr, parallel ? &key : nullptr);
+    if (t == NULL) {
+        return NULL;
+    }
+
+    call_callback(table, _record_set, ext_state, parallel, transaction, key);
+
+    return t;
+}
+
+void truncated_image(const slave::Table& table) {
+    LOG_ERROR(log, "Row image of " << table.full_name << " does not end with the event");
+    throw std::runtime_error("skip_image failed");
+}
+
+// Returns the end of the row image at 'row' without unpacking it: only null bitmap and sizes of values are read.
+// Throws std::runtime_error if the image is not within 'end'.
+const unsigned char* skip_image(const slave::Table& table,
+                                const unsigned char* row,
+                                unsigned int colcnt,
+                                const std::vector<unsigned char>& cols,
+                                const unsigned char* end) {
+
+    const bool use_plan = table.plan.size() == colcnt;
+    const bool all_cols = all_bits_set(cols, colcnt);
+    const unsigned present_count = all_cols ? colcnt : n_set_bits(cols, colcnt);
+
+    const unsigned char* null_bits = row;
+    if (end - row < (present_count + 7) / 8)
+        truncated_image(table);
+    const char* ptr = (const char*)row + (present_count + 7) / 8;
+    // Columns of the row image before the current one
+    unsigned position = 0;
+
+    for (unsigned i = 0; i < colcnt; i++) {
+        if (!all_cols && !(cols[i / 8] & (1 << (i & 7))))
+            continue;
+        if (!(null_bits[position / 8] & (1 << (position & 7)))) {
+            // Fixed width value or length of variable one
+            const unsigned width = use_plan ? table.plan[i].width : table.fields[i]->decode_step().width;
+            if ((const char*)end - ptr < width)
+                truncated_image(table);
+            ptr = use_plan ? table.plan.skip(i, ptr) : table.fields[i]->skip(ptr);
+            if (ptr > (const char*)end)
+                truncated_image(table);
+        }
+        ++position;
+    }
+
+    return (const unsigned char*)ptr;
+}
+
+// Finds starts of all rows of the event without unpacking them, the last element of 'rows' is the end of the last row
+void scan_rows(const slave::Table& table,
+               const Row_event_info& roi,
+               bool update,
+               std::vector<const unsigned char*>& rows) {
+
+    if (roi.m_width != table.fields.size()) {
+        LOG_ERROR(log, "Field count mismatch in scanning rows for "
+                  << table.full_name << ": " << roi.m_width << " != " << table.fields.size());
+        throw std::runtime_error("scan_rows failed");
+    }
+
+    rows.clear();
+    const unsigned char* row = roi.m_rows_buf;
+    while (row < roi.m_rows_end) {
+        rows.push_back(row);
+        row = skip_image(table, row, roi.m_width, roi.m_cols, roi.m_rows_end);
+        if (update && row < roi.m_rows_end)
+            row = skip_image(table, row, roi.m_width, roi.m_cols_ai, roi.m_rows_end);
+    }
+
+    if (row != roi.m_rows_end) {
+        LOG_ERROR(log, "Rows of event for " << table.full_name << " do not end with the event");
+        throw std::runtime_error("scan_rows failed");
+    }
+    rows.push_back(row);
+}
+
+// Event is large enough to be decoded by threads of 'decode'.
+// Rows of RowType::Arena are decoded through FlatRow of the table, so they are not.
+bool decode_in_parallel(const slave::Table& table, const Row_event_info& roi, const slave::ParallelDecode* decode) {
+    return decode && decode->threads() && table.row_type != RowType::Arena
+        && size_t(roi.m_rows_end - roi.m_rows_buf) >= decode->min_event_size();
+}
+
+// Unpacks rows found by scan_rows() into 'records' (at least one per row) by threads of 'decode'
+void unpack_rows_parallel(const slave::Table& table,
+                          const Basic_event_info& bei,
+                          const Row_event_info& roi,
+                          bool update,
+                          slave::ParallelDecode& decode,
+                          const std::vector<const unsigned char*>& rows,
+                          std::vector<slave::RecordSet>& records,
+                          std::vector<KeyHash>* keys) {
+
+    const size_t count = rows.size() - 1;
+    if (keys)
+        keys->assign(count, KeyHash());
+    // Schema is built on first use, not by the threads
+    if (table.row_type == RowType::Flat)
+        table.row_schema();
+
+    // Each of the threads and the calling one decodes a range of rows
+    const size_t parts = std::min<size_t>(count, decode.threads() + 1);
+    decode.run(parts, [&](size_t part) {
+        for (size_t i = count * part / parts; i < count * (part + 1) / parts; ++i) {
+            unsigned char* const start = const_cast<unsigned char*>(rows[i]);
+            KeyHash* const key = keys ? &(*keys)[i] : nullptr;
+            if (!update)
+                records[i].clear_old_row();
+            const unsigned char* end = update ? unpack_update_row(table, bei, roi, start, records[i], nullptr, key)
+                                              : unpack_writedelete_row(table, bei, roi, start, records[i], nullptr, key);
+            if (end != rows[i + 1]) {
+                LOG_ERROR(log, "Row of " << table.full_name << " does not end where scanned");
+                throw std::runtime_error("unpack_rows_parallel failed");
+            }
+        }
+    });
+}
+
+// Decodes rows of a large event by threads of 'decode' and calls callbacks in the order of rows.
+// Returns the number of rows.
+size_t do_rows_parallel(const slave::Table& table,
+                        const Basic_event_info& bei,
+                        const Row_event_info& roi,
+                        bool update,
+                        ExtStateIface &ext_state,
+                        slave::ParallelApply* parallel,
+                        slave::Transaction* transaction,
+                        slave::ParallelDecode& decode) {
+
+    thread_local std::vector<const unsigned char*> rows;
+    thread_local std::vector<KeyHash> keys;
+    scan_rows(table, roi, update, rows);
+
+    // Moved out in transaction and parallel modes, otherwise reused by the next events
+    std::vector<slave::RecordSet>& records = table.m_decoded;
+    const size_t count = rows.size() - 1;
+    if (records.size() < count)
+        records.resize(count);
+
+    unpack_rows_parallel(table, bei, roi, update, decode, rows, records, parallel ? &keys : nullptr);
+
+    for (size_t i = 0; i < count; ++i)
+        call_callback(table, records[i], ext_state, parallel, transaction, parallel ? keys[i] : KeyHash());
+
+    return count;
+}
+
+// Unpacks all rows of the event into the batch of the table and calls its batch callback once.
+// Returns the number of rows.
+size_t do_rows_batch(const slave::Table& table,
+                     const Basic_event_info& bei,
+                     const Row_event_info& roi,
+                     bool update,
+                     ExtStateIface &ext_state,
+                     slave::ParallelDecode* decode) {
+
+    // RecordSets are reused from the previous events, extra ones are kept aside for the next events
+    std::vector<slave::RecordSet>& batch = table.m_batch;
+    std::vector<slave::RecordSet>& spare = table.m_batch_spare;
+    size_t count = 0;
+
+    auto reserve = [&](size_t size) {
+        while (batch.size() < size) {
+            if (spare.empty()) {
+                batch.emplace_back();
+            } else {
+                batch.push_back(std::move(spare.back()));
+                spare.pop_back();
+            }
+        }
+    };
+
+    if (decode_in_parallel(table, roi, decode)) {
+        thread_local std::vector<const unsigned char*> rows;
+        scan_rows(table, roi, update, rows);
+        count = rows.size() - 1;
+        reserve(count);
+        unpack_rows_parallel(table, bei, roi, update, *decode, rows, batch, nullptr);
+    }
+
+    unsigned char* row_start = count ? roi.m_rows_end : roi.m_rows_buf;
+    while (row_start < roi.m_rows_end &&
+           row_start != NULL) {
+
+        reserve(count + 1);
+
+        slave::RecordSet& _record_set = batch[count];
+        if (!update)
+            _record_set.clear_old_row();
+        row_start = update ? unpack_update_row(table, bei, roi, row_start, _record_set, nullptr, nullptr)
+                           : unpack_writedelete_row(table, bei, roi, row_start, _record_set, nullptr, nullptr);
+        if (row_start != NULL)
+            ++count;
+    }
+    while (batch.size() > count) {
+        spare.push_back(std::move(batch.back()));
+        batch.pop_back();
+    }
+
+    if (count) {
+        table.count_callback(ext_state, count);
+        table.m_batch_callback(batch);
+    }
+
+    return count;
+}
+
+// Calls view callback of the table for each row of the event. Returns the number of rows.
+size_t do_rows_view(const slave::Table& table,
+                    const Basic_event_info& bei,
+                    const Row_event_info& roi,
+                    bool update,
+                    ExtStateIface &ext_state) {
+
+    slave::RecordView& view = table.m_view;
+    view.tbl_name = table.table_name;
+    view.db_name = table.database_name;
+    view.when = bei.when;
+    view.master_id = bei.server_id;
+    if (update)
+        view.type_event = slave::RecordSet::Update;
+    else if (bei.type == WRITE_ROWS_EVENT_V1 || bei.type == WRITE_ROWS_EVENT)
+        view.type_event = slave::RecordSet::Write;
+    else
+        view.type_event = slave::RecordSet::Delete;
+    if (!update)
+        view.m_old_row.clear();
+
+    size_t count = 0;
+    const unsigned char* row_start = roi.m_rows_buf;
+    while (row_start < roi.m_rows_end) {
+        if (update) {
+            row_start = view.m_old_row.reset(table, row_start, roi.m_width, roi.m_cols);
+            row_start = view.m_row.reset(table, row_start, roi.m_width, roi.m_cols_ai);
+        } else {
+            row_start = view.m_row.reset(table, row_start, roi.m_width, roi.m_cols);
+        }
+        ++count;
+
+        table.m_view_callback(view);
+    }
+
+    if (count)
+        table.count_callback(ext_state, count);
+
+    return count;
+}
+
+// Unpacks all rows of the event by columns and calls columnar callback of the table once.
+// Returns the number of rows.
+size_t do_rows_columnar(const slave::Table& table,
+                        const Basic_event_info& bei,
+                        const Row_event_info& roi,
+                        bool update,
+                        ExtStateIface &ext_state) {
+
+    slave::ColumnarBatch& batch = table.m_columnar;
+    if (update)
+        batch.reset(table, slave::RecordSet::Update);
+    else if (bei.type == WRITE_ROWS_EVENT_V1 || bei.type == WRITE_ROWS_EVENT)
+        batch.reset(table, slave::RecordSet::Write);
+    else
+        batch.reset(table, slave::RecordSet::Delete);
+    batch.when = bei.when;
+    batch.master_id = bei.server_id;
+
+    const unsigned char* row_start = batch.append_fixed(table, roi) ? roi.m_rows_end : roi.m_rows_buf;
+    while (row_start < roi.m_rows_end) {
+        if (update) {
+            row_start = batch.append(table, batch.old_columns, row_start, roi.m_width, roi.m_cols);
+            row_start = batch.append(table, batch.columns, row_start, roi.m_width, roi.m_cols_ai);
+        } else {
+            row_start = batch.append(table, batch.columns, row_start, roi.m_width, roi.m_cols);
+        }
+        ++batch.rows;
+    }
+
+    if (batch.rows) {
+        table.count_callback(ext_state, batch.rows);
+        table.m_columnar_callback(batch);
+    }
+
+    return batch.rows;
+}
+
+// Decodes rows of the event into user struct of the table binding. Returns the number of rows.
+size_t do_rows_binding(const slave::Table& table,
+                       const Basic_event_info& bei,
+                       const Row_event_info& roi,
+                       ExtStateIface &ext_state) {
+
+    slave::RecordSet::TypeEvent type = slave::RecordSet::Delete;
+    if (roi.has_after_image)
+        type = slave::RecordSet::Update;
+    else if (bei.type == WRITE_ROWS_EVENT_V1 || bei.type == WRITE_ROWS_EVENT)
+        type = slave::RecordSet::Write;
+
+    const size_t count = table.m_binding->apply(table, bei, roi, type);
+    if (count)
+        table.count_callback(ext_state, count);
+
+    return count;
+}
+
 namespace // anonymous
 {
     inline EventKind eventKind(Log_event_type type)
@@ -612,13 +1226,26 @@ namespace // anonymous
 } // namespace anonymous
 
 
-void apply_row_event(slave::RelayLogInfo& rli, const Basic_event_info& bei, const Row_event_info& roi, ExtStateIface &ext_state, EventStatIface* event_stat) {
-    EventKind kind = eventKind(bei.type);
-    const TableKey key = rli.getTableNameById(roi.m_table_id);
+bool skip_row_event(const slave::RelayLogInfo& rli, const Basic_event_info& bei, EventStatIface* event_stat)
+{
+    // Broken event is left for Row_event_info to report
+    if (bei.event_len < LOG_EVENT_HEADER_LEN + RW_MAPID_OFFSET + 6)
+        return false;
+
+    const unsigned long table_id = uint6korr(bei.buf + LOG_EVENT_HEADER_LEN + RW_MAPID_OFFSET);
+    if (rli.hasTableId(table_id))
+        return false;
 
-    LOG_DEBUG(log, "applyRowEvent(): " << roi.m_table_id << " " << key.db_name << "." << key.table_name);
+    if (event_stat)
+        event_stat->tickModifyEventIgnored(table_id, eventKind(bei.type));
+    return true;
+}
 
-    const auto& table = rli.getTable(key);
+void apply_row_event(slave::RelayLogInfo& rli, const Basic_event_info& bei, const Row_event_info& roi, ExtStateIface &ext_state, EventStatIface* event_stat, ParallelApply* parallel, Transaction* transaction, ParallelDecode* decode) {
+    EventKind kind = eventKind(bei.type);
+    Table* const table = rli.getTableById(roi.m_table_id);
+
+    LOG_DEBUG(log, "applyRowEvent(): " << roi.m_table_id);
 
     if (table) {
 
@@ -627,6 +1254,56 @@ void apply_row_event(slave::RelayLogInfo& rli, const Basic_event_info& bei, cons
 
         unsigned char* row_start = roi.m_rows_buf;
 
+        if (should_process(table->m_filter, kind) && (table->m_batch_callback || table->m_view_callback || table->m_columnar_callback || table->m_binding)
+            && !transaction) {
+            time_stamp start = now();
+            size_t count = 0;
+            try
+            {
+                if (table->m_binding)
+                    count = do_rows_binding(*table, bei, roi, ext_state);
+                else if (table->m_columnar_callback)
+                    count = do_rows_columnar(*table, bei, roi, kind == eUpdate, ext_state);
+                else if (table->m_view_callback)
+                    count = do_rows_view(*table, bei, roi, kind == eUpdate, ext_state);
+                else
+                    count = do_rows_batch(*table, bei, roi, kind == eUpdate, ext_state, decode);
+            }
+            catch (...)
+            {
+                if (event_stat)
+                    event_stat->tickModifyEventFailed(roi.m_table_id, kind);
+                throw;
+            }
+            if (event_stat) {
+                if (count)
+                    event_stat->tickModifyRowsDone(roi.m_table_id, kind, count, now() - start);
+                event_stat->tickModifyEventDone(roi.m_table_id, kind);
+            }
+            return;
+        }
+
+        if (should_process(table->m_filter, kind) && decode_in_parallel(*table, roi, decode)) {
+            time_stamp start = now();
+            size_t count = 0;
+            try
+            {
+                count = do_rows_parallel(*table, bei, roi, kind == eUpdate, ext_state, parallel, transaction, *decode);
+            }
+            catch (...)
+            {
+                if (event_stat)
+                    event_stat->tickModifyEventFailed(roi.m_table_id, kind);
+                throw;
+            }
+            if (event_stat) {
+                if (count)
+                    event_stat->tickModifyRowsDone(roi.m_table_id, kind, count, now() - start);
+                event_stat->tickModifyEventDone(roi.m_table_id, kind);
+            }
+            return;
+        }
+
         if (should_process(table->m_filter, kind)) {
             while (row_start < roi.m_rows_end &&
                    row_start != NULL) {
@@ -635,10 +1312,10 @@ void apply_row_event(slave::RelayLogInfo& rli, const Basic_event_info& bei, cons
                 {
                     if (kind == eUpdate) {
 
-                        row_start = do_update_row(*table, bei, roi, row_start, ext_state);
+                        row_start = do_update_row(*table, bei, roi, row_start, ext_state, parallel, transaction);
 
                     } else {
-                        row_start = do_writedelete_row(*table, bei, roi, row_start, ext_state);
+                        row_start = do_writedelete_row(*table, bei, roi, row_start, ext_state, parallel, transaction);
                     }
                 }
                 catch (...)
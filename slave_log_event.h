@@ -100,6 +100,36 @@ enum Temporal_type
     MYSQL_TYPE_TIME2      = 19
 };
 
+// Other column types of TABLE_MAP_EVENT
+enum Column_type
+{
+    MYSQL_TYPE_DECIMAL     = 0,
+    MYSQL_TYPE_TINY        = 1,
+    MYSQL_TYPE_SHORT       = 2,
+    MYSQL_TYPE_LONG        = 3,
+    MYSQL_TYPE_FLOAT       = 4,
+    MYSQL_TYPE_DOUBLE      = 5,
+    MYSQL_TYPE_NULL        = 6,
+    MYSQL_TYPE_LONGLONG    = 8,
+    MYSQL_TYPE_INT24       = 9,
+    MYSQL_TYPE_DATE        = 10,
+    MYSQL_TYPE_YEAR        = 13,
+    MYSQL_TYPE_NEWDATE     = 14,
+    MYSQL_TYPE_VARCHAR     = 15,
+    MYSQL_TYPE_BIT         = 16,
+    MYSQL_TYPE_JSON        = 245,
+    MYSQL_TYPE_NEWDECIMAL  = 246,
+    MYSQL_TYPE_ENUM        = 247,
+    MYSQL_TYPE_SET         = 248,
+    MYSQL_TYPE_TINY_BLOB   = 249,
+    MYSQL_TYPE_MEDIUM_BLOB = 250,
+    MYSQL_TYPE_LONG_BLOB   = 251,
+    MYSQL_TYPE_BLOB        = 252,
+    MYSQL_TYPE_VAR_STRING  = 253,
+    MYSQL_TYPE_STRING      = 254,
+    MYSQL_TYPE_GEOMETRY    = 255
+};
+
 #define LOG_EVENT_TYPES (ENUM_END_EVENT-1)
 
 
@@ -172,52 +202,101 @@ struct Rotate_event_info {
     Rotate_event_info(const char* buf, unsigned int event_len);
 };
 
+// Event infos below may be default constructed and filled by parse() for each event,
+// then storage of strings and vectors of the previous event is reused.
+
 struct Query_event_info {
 
     std::string db_name;
     std::string query;
 
-    Query_event_info(const char* buf, unsigned int event_len);
+    Query_event_info() {}
+    Query_event_info(const char* buf, unsigned int event_len) { parse(buf, event_len); }
+
+    void parse(const char* buf, unsigned int event_len);
 };
 
 struct Table_map_event_info {
 
-    unsigned long m_table_id;
-    std::string m_tblnam;
-    std::string m_dbnam;
-    std::vector<unsigned char> m_cols_types;
-
-    Table_map_event_info(const char* buf, unsigned int event_len);
+    unsigned long m_table_id = 0;
+    // The event after the common header and its hash, equal for repeated map events of a table.
+    // The body points into the event buffer.
+    size_t m_hash = 0;
+    std::string_view m_body;
+    // Names and column types point into the event buffer
+    std::string_view m_tblnam;
+    std::string_view m_dbnam;
+    const unsigned char* m_cols_types = nullptr;
+    unsigned long m_width = 0;
+    // End of the event without checksum, metadata of columns follows their types, see TableMapSchema
+    const unsigned char* m_end = nullptr;
+
+    Table_map_event_info() {}
+    Table_map_event_info(const char* buf, unsigned int event_len) { parse(buf, event_len); }
+
+    void parse(const char* buf, unsigned int event_len) { parse_header(buf, event_len); parse_body(buf, event_len); }
+    // Only m_table_id, m_hash and m_body
+    void parse_header(const char* buf, unsigned int event_len);
+    void parse_body(const char* buf, unsigned int event_len);
 };
 
 struct Row_event_info {
 
-    unsigned long m_width;
-    unsigned long m_table_id;
+    unsigned long m_width = 0;
+    unsigned long m_table_id = 0;
 
     std::vector<unsigned char> m_cols;
     std::vector<unsigned char> m_cols_ai;
 
-    unsigned char* m_rows_buf;
-    unsigned char* m_rows_end;
+    unsigned char* m_rows_buf = nullptr;
+    unsigned char* m_rows_end = nullptr;
 
-    bool has_after_image;
+    bool has_after_image = false;
 
-    Row_event_info(const char* buf, unsigned int event_len, bool do_update, bool master_ge_56);
+    Row_event_info() {}
+    Row_event_info(const char* buf, unsigned int event_len, bool do_update, bool master_ge_56)
+        { parse(buf, event_len, do_update, master_ge_56); }
+
+    void parse(const char* buf, unsigned int event_len, bool do_update, bool master_ge_56);
 };
 
 struct Gtid_event_info
 {
     std::string m_sid;
-    int64_t     m_gno;
+    int64_t     m_gno = 0;
+
+    Gtid_event_info() {}
+    Gtid_event_info(const char* buf, unsigned int event_len) { parse(buf, event_len); }
 
-    Gtid_event_info(const char* buf, unsigned int event_len);
+    void parse(const char* buf, unsigned int event_len);
 };
 
 
-bool read_log_event(const char* buf, unsigned int event_len, Basic_event_info& info, EventStatIface* event_stat, bool master_ge_56, MasterInfo& master_info);
+// If 'verify_checksum' is false, event checksum is considered verified already (see verify_event_checksum).
+bool read_log_event(const char* buf, unsigned int event_len, Basic_event_info& info, EventStatIface* event_stat, bool master_ge_56, MasterInfo& master_info, bool verify_checksum = true);
+
+// Verifies CRC32 of the event before read_log_event(), i.e. in the network reading thread of pipelined mode.
+// Tracks checksum algorithm in 'alg' like read_log_event() does in MasterInfo.
+// Returns true only if the event has checksum and it is correct.
+bool verify_event_checksum(const char* buf, unsigned int event_len, bool master_ge_56, enum_binlog_checksum_alg& alg);
+
+// Checks only table id of the row event, without parsing it. Returns true (and counts the event
+// as ignored) if the table is not replicated, so the event must be skipped.
+bool skip_row_event(const slave::RelayLogInfo& rli, const Basic_event_info& bei, EventStatIface* event_stat);
+
+// Number of set bits among the first 'count' bits of bitmap
+size_t n_set_bits(const std::vector<unsigned char>& b, unsigned int count);
+// All 'count' bits are set, empty bitmap means all columns
+bool all_bits_set(const std::vector<unsigned char>& b, unsigned int count);
+
+class ParallelApply;
+class ParallelDecode;
 
-void apply_row_event(slave::RelayLogInfo& rli, const Basic_event_info& bei, const Row_event_info& roi, ExtStateIface &ext_state, EventStatIface* event_stat);
+// If 'parallel' is set, callbacks are called by its workers, see MasterInfo::apply_threads.
+// If 'transaction' is set, rows are collected into it instead of calling table callbacks.
+// If 'decode' is set, rows of large events are decoded by its threads, see MasterInfo::decode_threads.
+void apply_row_event(slave::RelayLogInfo& rli, const Basic_event_info& bei, const Row_event_info& roi, ExtStateIface &ext_state, EventStatIface* event_stat,
+                     ParallelApply* parallel = nullptr, Transaction* transaction = nullptr, ParallelDecode* decode = nullptr);
 
 
 //------------------------------------------------------------------------------------------
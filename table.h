@@ -22,8 +22,11 @@
 #include <map>
 #include <memory>
 
+#include "ColumnarBatch.h"
+#include "DecodePlan.h"
 #include "field.h"
 #include "recordset.h"
+#include "RowView.h"
 #include "SlaveStats.h"
 
 
@@ -32,10 +35,19 @@ namespace slave
 
 typedef std::unique_ptr<Field> PtrField;
 typedef std::function<void (RecordSet&)> callback;
+typedef std::function<void (Transaction&)> transaction_callback;
+// All rows of one rows event, see Slave::setBatchCallback
+typedef std::function<void (std::vector<RecordSet>&)> batch_callback;
+// Row decoded lazily, see Slave::setViewCallback
+typedef std::function<void (const RecordView&)> view_callback;
+// All rows of one rows event by columns, see Slave::setColumnarCallback
+typedef std::function<void (ColumnarBatch&)> columnar_callback;
 typedef std::function<void (const std::string&, const std::string&, const std::vector<PtrField>&)> ddl_callback;
 typedef EventKind filter;
 
 
+class RowBinding;
+
 inline bool should_process(EventKind filter, EventKind kind) { return (filter & kind) == kind; }
 
 class Table {
@@ -48,19 +60,102 @@ public:
     unsigned column_filter_count;
     RowType  row_type;
 
+    // Indexes of primary key fields in ascending order, empty if there is no primary key
+    std::vector<unsigned> primary_key;
+
+    // TableMapSchema::hash() of TABLE_MAP_EVENT the fields are created from, 0 if they are created
+    // from SHOW FULL COLUMNS, see MasterInfo::schema_from_table_map
+    size_t map_schema = 0;
+
+    // Compiled fields, used for unpacking rows if it matches the fields, see build_plan()
+    DecodePlan plan;
+
     callback m_callback;
+    batch_callback m_batch_callback;
+    view_callback m_view_callback;
+    columnar_callback m_columnar_callback;
+    // Decoding into user struct, see Slave::bind
+    std::shared_ptr<RowBinding> m_binding;
     EventKind m_filter;
 
+    // Row for m_callback, reused between rows
+    mutable RecordSet m_record;
+    // Storage of rows for m_batch_callback, reused between events
+    mutable std::vector<RecordSet> m_batch;
+    // Rows of m_batch beyond the size of the last event
+    mutable std::vector<RecordSet> m_batch_spare;
+    // Rows of large events for m_callback decoded in parallel, see ParallelDecode
+    mutable std::vector<RecordSet> m_decoded;
+    // Storage of columns for m_columnar_callback, reused between events
+    mutable ColumnarBatch m_columnar;
+    // Row views for m_view_callback, reused between events
+    mutable RecordView m_view;
+    // Row of RowType::Arena before it is copied into ArenaRow, reused between rows
+    mutable FlatRow m_arena_row;
+
     void call_callback(slave::RecordSet& _rs, ExtStateIface &ext_state) const
+    {
+        count_callback(ext_state);
+
+        m_callback(_rs);
+    }
+
+    void count_callback(ExtStateIface &ext_state) const
     {
         // Some stats
         ext_state.incTableCount(full_name);
         ext_state.setLastFilteredUpdateTime();
+    }
 
-        m_callback(_rs);
+    void count_callback(ExtStateIface &ext_state, unsigned long rows) const
+    {
+        ext_state.incTableCount(full_name, rows);
+        ext_state.setLastFilteredUpdateTime();
+    }
+
+    // Field is not excluded by column filter
+    bool is_selected(unsigned index) const {
+        return column_filter.empty() || column_filter[index >> 3] & (1 << (index & 7));
+    }
+
+    // Has to be called after fields are added or changed
+    void build_plan() {
+        plan.build(fields);
+    }
+
+    // Schema of rows of RowType::Flat, built on first use
+    const PtrRowSchema& row_schema() const {
+        if (!m_row_schema) {
+            std::vector<std::string> names;
+            std::vector<std::string> types;
+            if (column_filter.empty()) {
+                for (const auto& field : fields) {
+                    names.push_back(field->field_name);
+                    types.push_back(field->field_type);
+                }
+            } else {
+                names.resize(column_filter_count);
+                types.resize(column_filter_count);
+                for (unsigned i = 0; i < fields.size(); ++i) {
+                    if (is_selected(i)) {
+                        names[column_filter_fields[i]] = fields[i]->field_name;
+                        types[column_filter_fields[i]] = fields[i]->field_type;
+                    }
+                }
+            }
+            m_row_schema = std::make_shared<const RowSchema>(std::move(names), std::move(types));
+        }
+        return m_row_schema;
     }
 
     void set_column_filter(const std::vector<std::string> &_column_filter) {
+        m_row_schema.reset();
+        // Rows of the previous columns are not reused
+        m_record = RecordSet();
+        m_batch.clear();
+        m_batch_spare.clear();
+        m_decoded.clear();
+
         if (_column_filter.empty()) {
             column_filter.clear();
             column_filter_fields.clear();
@@ -104,6 +199,8 @@ public:
 
     Table() {}
 
+private:
+    mutable PtrRowSchema m_row_schema;
 };
 
 }
@@ -0,0 +1,386 @@
+#include <boost/test/included/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Slave.h"
+
+// Checks that replication does not allocate memory in steady state: after the first events
+// all storage of parsed events and rows is reused. Global operator new is replaced by a counting one,
+// so these tests are a separate binary.
+
+namespace // anonymous
+{
+    std::atomic<size_t> allocations{0};
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+// Not inlined into callers, where GCC would see free() of the pointer returned by operator new
+__attribute__((noinline)) static void release(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, std::size_t) noexcept { release(p); }
+void operator delete[](void* p, std::size_t) noexcept { release(p); }
+
+namespace // anonymous
+{
+    const unsigned long TableId = 5;
+    // Longer than buffer of short std::string
+    const std::string DbName = "replicated_database";
+    const std::string TableName = "replicated_table_name";
+    const std::string Sid(16, '\x3e');
+
+    void appendInt(std::string& s, uint64_t value, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; ++i)
+            s.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    std::string event(slave::Log_event_type type, const std::string& body, size_t log_pos = 0)
+    {
+        std::string result;
+        appendInt(result, 1500000000, 4);       // timestamp
+        result.push_back(static_cast<char>(type));
+        appendInt(result, 1, 4);                // server_id
+        appendInt(result, LOG_EVENT_HEADER_LEN + body.size(), 4);
+        appendInt(result, log_pos, 4);
+        appendInt(result, 0, 2);                // flags
+        return result + body;
+    }
+
+    std::string formatDescriptionEvent()
+    {
+        std::string body;
+        appendInt(body, 4, 2);
+        std::string version = "5.7.30-log";
+        version.resize(ST_SERVER_VER_LEN, '\0');
+        body += version;
+        appendInt(body, 0, 4);
+        body.push_back(LOG_EVENT_HEADER_LEN);
+        const size_t event_types = slave::ENUM_END_EVENT - 1;
+        std::string postlen(event_types, '\0');
+        postlen[slave::QUERY_EVENT - 1] = QUERY_HEADER_LEN;
+        postlen[slave::ROTATE_EVENT - 1] = ROTATE_HEADER_LEN;
+        postlen[slave::FORMAT_DESCRIPTION_EVENT - 1] = START_V3_HEADER_LEN + 1 + event_types;
+        postlen[slave::TABLE_MAP_EVENT - 1] = TABLE_MAP_HEADER_LEN;
+        for (auto type : {slave::WRITE_ROWS_EVENT_V1, slave::UPDATE_ROWS_EVENT_V1, slave::DELETE_ROWS_EVENT_V1})
+            postlen[type - 1] = ROWS_HEADER_LEN_V1;
+        for (auto type : {slave::WRITE_ROWS_EVENT, slave::UPDATE_ROWS_EVENT, slave::DELETE_ROWS_EVENT})
+            postlen[type - 1] = ROWS_HEADER_LEN;
+        body += postlen;
+        body.push_back(slave::BINLOG_CHECKSUM_ALG_OFF);
+        appendInt(body, 0, BINLOG_CHECKSUM_LEN);
+        return event(slave::FORMAT_DESCRIPTION_EVENT, body);
+    }
+
+    std::string queryEvent(const std::string& query)
+    {
+        std::string body;
+        appendInt(body, 1, 4);                  // thread_id
+        appendInt(body, 0, 4);                  // exec_time
+        body.push_back(static_cast<char>(DbName.size()));
+        appendInt(body, 0, 2);                  // error_code
+        appendInt(body, 0, 2);                  // status_vars_len
+        body += DbName;
+        body.push_back('\0');
+        body += query;
+        return event(slave::QUERY_EVENT, body);
+    }
+
+    std::string gtidEvent(int64_t gno)
+    {
+        std::string body(1, '\0');
+        body += Sid;
+        appendInt(body, gno, 8);
+        return event(slave::GTID_LOG_EVENT, body);
+    }
+
+    std::string xidEvent(uint64_t xid)
+    {
+        std::string body;
+        appendInt(body, xid, 8);
+        return event(slave::XID_EVENT, body);
+    }
+
+    // Table of columns: id int, amount bigint, name varchar(64), price double, note blob, missing int (always NULL)
+    std::string tableMapEvent()
+    {
+        std::string body;
+        appendInt(body, TableId, 6);
+        appendInt(body, 0, 2);                  // flags
+        body.push_back(static_cast<char>(DbName.size()));
+        body += DbName;
+        body.push_back('\0');
+        body.push_back(static_cast<char>(TableName.size()));
+        body += TableName;
+        body.push_back('\0');
+        body.push_back(6);
+        body += std::string("\x03\x08\x0f\x05\xfc\x03", 6);
+        return event(slave::TABLE_MAP_EVENT, body);
+    }
+
+    std::string rowImage(uint32_t id)
+    {
+        const std::string name = "name of the row " + std::to_string(id % 10);
+        const std::string note(100, 'n');
+        std::string row(1, '\x20');             // NULL bitmap: 'missing' is NULL
+        appendInt(row, id, 4);
+        appendInt(row, uint64_t(id) << 32, 8);
+        appendInt(row, name.size(), 1);
+        row += name;
+        const double price = id / 4.0;
+        row.append(reinterpret_cast<const char*>(&price), sizeof(price));
+        appendInt(row, note.size(), 2);
+        row += note;
+        return row;
+    }
+
+    // Rows event (version 1) with all columns present
+    std::string rowsEvent(slave::Log_event_type type, uint32_t first_id, unsigned rows)
+    {
+        std::string body;
+        appendInt(body, TableId, 6);
+        appendInt(body, 0, 2);                  // flags
+        body.push_back(6);                      // width
+        body.push_back('\x3f');
+        if (type == slave::UPDATE_ROWS_EVENT_V1)
+            body.push_back('\x3f');
+        for (unsigned i = 0; i < rows; ++i)
+        {
+            body += rowImage(first_id + i);
+            if (type == slave::UPDATE_ROWS_EVENT_V1)
+                body += rowImage(first_id + i + 1);
+        }
+        return event(type, body);
+    }
+
+    slave::PtrTable makeTable()
+    {
+        slave::collate_info collate;
+        collate.maxlen = 1;
+        slave::PtrTable table(new slave::Table(DbName, TableName));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_longlong("amount", "bigint(20) unsigned"));
+        table->fields.emplace_back(new slave::Field_varstring("name", "varchar(64)", collate));
+        table->fields.emplace_back(new slave::Field_double("price", "double"));
+        table->fields.emplace_back(new slave::Field_blob("note", "blob"));
+        table->fields.emplace_back(new slave::Field_long("missing", "int(11)"));
+        table->m_filter = slave::eAll;
+        table->build_plan();
+        return table;
+    }
+
+    struct BoundRow
+    {
+        int32_t id = 0;
+        std::string name;
+        double price = 0;
+        std::optional<int32_t> missing;
+    };
+
+    // Events of the table are applied as Slave::process_event() does, with reused event infos.
+    // Returns the number of allocations of 'rounds' rounds after 'warmup' ones.
+    size_t countAllocations(slave::RelayLogInfo& rli, unsigned warmup, unsigned rounds)
+    {
+        const std::vector<std::string> events = {
+            tableMapEvent(),
+            rowsEvent(slave::WRITE_ROWS_EVENT_V1, 1, 20),
+            tableMapEvent(),
+            rowsEvent(slave::UPDATE_ROWS_EVENT_V1, 1, 10),
+            tableMapEvent(),
+            rowsEvent(slave::DELETE_ROWS_EVENT_V1, 1, 5)
+        };
+
+        slave::EmptyExtState ext_state;
+        slave::Table_map_event_info tmi;
+        slave::Row_event_info roi;
+
+        size_t before = 0;
+        for (unsigned round = 0; round < warmup + rounds; ++round)
+        {
+            if (round == warmup)
+                before = allocations.load();
+
+            for (const auto& x : events)
+            {
+                slave::Basic_event_info bei;
+                bei.parse(x.data(), x.size());
+                if (bei.type == slave::TABLE_MAP_EVENT)
+                {
+                    slave::Table* table = nullptr;
+                    tmi.parse_header(bei.buf, bei.event_len);
+                    if (!rli.isTableMapProcessed(tmi.m_table_id, tmi.m_hash, tmi.m_body, table))
+                    {
+                        tmi.parse_body(bei.buf, bei.event_len);
+                        rli.setTableName(tmi.m_table_id, tmi.m_tblnam, tmi.m_dbnam, tmi.m_hash, tmi.m_body);
+                    }
+                    continue;
+                }
+                if (slave::skip_row_event(rli, bei, nullptr))
+                    continue;
+                roi.parse(bei.buf, bei.event_len, bei.type == slave::UPDATE_ROWS_EVENT_V1, false);
+                slave::apply_row_event(rli, bei, roi, ext_state, nullptr);
+            }
+        }
+        return allocations.load() - before;
+    }
+
+    void testRowType(slave::RowType row_type, bool column_filter)
+    {
+        slave::RelayLogInfo rli;
+        slave::PtrTable table = makeTable();
+        table->row_type = row_type;
+        if (column_filter)
+            table->set_column_filter({"price", "name", "id"});
+
+        size_t rows = 0;
+        uint64_t sum = 0;
+        table->m_callback = [&](slave::RecordSet& rs)
+        {
+            ++rows;
+            switch (rs.row_type)
+            {
+            case slave::RowType::Map:
+                sum += slave::get<uint32_t>(rs.m_row.find("id")->second.second);
+                break;
+            case slave::RowType::Vector:
+                sum += rs.m_row_vec.size();
+                break;
+            case slave::RowType::Flat:
+                sum += slave::get<uint32_t>(*rs.m_row_flat.find("id"));
+                break;
+            case slave::RowType::Arena:
+                sum += std::get<uint32_t>(*rs.m_row_arena.find("id"));
+                break;
+            }
+        };
+        rli.setTable(TableName, DbName, std::move(table));
+
+        BOOST_CHECK_EQUAL(countAllocations(rli, 3, 50), 0);
+        BOOST_CHECK_EQUAL(rows, 53 * 35);
+        BOOST_CHECK(sum > 0);
+    }
+
+    void test_RowCallback()
+    {
+        testRowType(slave::RowType::Map, false);
+        testRowType(slave::RowType::Vector, false);
+        testRowType(slave::RowType::Flat, false);
+        testRowType(slave::RowType::Map, true);
+        testRowType(slave::RowType::Vector, true);
+        testRowType(slave::RowType::Flat, true);
+        testRowType(slave::RowType::Arena, false);
+        testRowType(slave::RowType::Arena, true);
+    }
+
+    void test_SpecialCallbacks()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTable(TableName, DbName, makeTable());
+        slave::Table& table = *rli.getTable({DbName, TableName});
+
+        size_t rows = 0;
+        table.m_batch_callback = [&](std::vector<slave::RecordSet>& batch) { rows += batch.size(); };
+        BOOST_CHECK_EQUAL(countAllocations(rli, 3, 50), 0);
+        table.m_batch_callback = nullptr;
+
+        table.m_view_callback = [&](const slave::RecordView& view) { rows += view.m_row.str(2).size() > 0; };
+        BOOST_CHECK_EQUAL(countAllocations(rli, 3, 50), 0);
+        table.m_view_callback = nullptr;
+
+        table.m_columnar_callback = [&](slave::ColumnarBatch& batch) { rows += batch.rows; };
+        BOOST_CHECK_EQUAL(countAllocations(rli, 3, 50), 0);
+        table.m_columnar_callback = nullptr;
+
+        table.m_binding = slave::make_binding<BoundRow>([&](slave::TypedRecordSet<BoundRow>& rs) { rows += rs.m_row.id > 0; },
+                                                        &BoundRow::id, "id", &BoundRow::name, "name",
+                                                        &BoundRow::price, "price", &BoundRow::missing, "missing");
+        table.m_binding->resolve(table);
+        BOOST_CHECK_EQUAL(countAllocations(rli, 3, 50), 0);
+
+        BOOST_CHECK_EQUAL(rows, 4 * 53 * 35);
+    }
+
+    // Transactions of a not replicated table are read by Slave from binlog file
+    void test_SlaveEvents()
+    {
+        const unsigned transactions = 100;
+        const unsigned warmup = 3;
+
+        std::string binlog("\xfe" "bin", 4);
+        auto add = [&binlog](std::string event)
+        {
+            // Position of the end of the event
+            const size_t end = binlog.size() + event.size();
+            for (size_t i = 0; i < 4; ++i)
+                event[LOG_POS_OFFSET + i] = static_cast<char>(end >> (8 * i));
+            binlog += event;
+        };
+
+        add(formatDescriptionEvent());
+        for (unsigned i = 0; i < transactions; ++i)
+        {
+            add(gtidEvent(i + 1));
+            add(queryEvent("BEGIN"));
+            add(tableMapEvent());
+            add(rowsEvent(slave::WRITE_ROWS_EVENT_V1, i, 10));
+            add(xidEvent(i + 1));
+        }
+
+        char dir_template[] = "/tmp/libslave_alloc_test_XXXXXX";
+        const std::string dir = ::mkdtemp(dir_template);
+        const std::string file = dir + "/binlog.000001";
+        std::ofstream(file.c_str(), std::ios::binary).write(binlog.data(), binlog.size());
+
+        std::vector<size_t> counts;
+        counts.reserve(transactions);
+        {
+            slave::BinlogFileSource source(std::vector<std::string>{file});
+            slave::Slave slave;
+            slave.setXidCallback([&counts](unsigned int) { counts.push_back(allocations.load()); });
+            slave.get_local_binlog(source);
+            BOOST_CHECK_EQUAL(slave.masterInfo().position.log_pos, binlog.size());
+        }
+
+        ::unlink(file.c_str());
+        ::rmdir(dir.c_str());
+
+        BOOST_REQUIRE_EQUAL(counts.size(), transactions);
+        BOOST_CHECK_EQUAL(counts.back() - counts[warmup], 0);
+    }
+}// anonymous-namespace
+
+test_suite* init_unit_test_suite(int argc, char* argv[])
+{
+#define ADD_FIXTURE_TEST(testFunction) \
+    framework::master_test_suite().add(BOOST_TEST_CASE([&]() { testFunction(); }))
+
+    ADD_FIXTURE_TEST(test_RowCallback);
+    ADD_FIXTURE_TEST(test_SpecialCallbacks);
+    ADD_FIXTURE_TEST(test_SlaveEvents);
+
+#undef ADD_FIXTURE_TEST
+
+    return 0;
+}
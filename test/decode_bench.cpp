@@ -0,0 +1,303 @@
+#include <getopt.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Slave.h"
+
+// Benchmark of decoding rows events without MySQL server:
+// builds rows event of a table of integer columns in memory and applies it
+// with virtual Field::unpack() and with the decode plan of the table.
+// With -t the table has also a TEXT column excluded by column filter.
+// With -R rows are of given RowType.
+// With -L rows are decoded by columns for columnar callback: with the decode plan
+// rows of tables without strings are gathered by ColumnarBatch::append_fixed().
+// With -D columns are DATETIME (new storage, big endian) instead of INT.
+// With -P events are also decoded with the plan by given number of threads of ParallelDecode.
+// With -v decodes a row of typical columns into FieldValue and stores values with setFieldValue():
+// compare builds with each FieldValue mode (see types.h).
+
+void usage(const char* name)
+{
+    std::cout << "Usage: " << name << " [-c <columns>] [-r <rows per event>] [-e <events>] -n [-t <text size>] [-R map|vector|flat] -L -D [-P <threads>] -v\n"
+              << " -n means every row has NULL value in the last column\n"
+              << " -t adds the first TEXT column of given size, not selected by column filter\n"
+              << " -R sets type of rows, vector by default\n"
+              << " -L means columnar callback instead of rows\n"
+              << " -D means DATETIME columns instead of INT\n"
+              << " -P sets number of threads decoding each event in addition to the main one\n"
+              << " -v means benchmark of FieldValue of this build, -r sets number of rows" << std::endl;
+}
+
+std::string packInt(uint64_t x, size_t bytes)
+{
+    std::string result;
+    for (size_t i = 0; i < bytes; ++i)
+        result.push_back(static_cast<char>(x >> (8 * i)));
+    return result;
+}
+
+// WRITE_ROWS_EVENT_V1 of the table with id 1 with all columns present
+std::string makeEvent(unsigned columns, unsigned rows, bool with_null, size_t text_size, bool datetime)
+{
+    const std::string text(text_size, 'x');
+    const unsigned ints = columns;
+    if (text_size)
+        ++columns;
+
+    std::string event(LOG_EVENT_HEADER_LEN, '\0');
+    event[EVENT_TYPE_OFFSET] = slave::WRITE_ROWS_EVENT_V1;
+    event += packInt(1, 6); // table id
+    event += std::string(2, '\0'); // flags
+    event += static_cast<char>(columns);
+    event += std::string((columns + 7) / 8, '\xff');
+
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        std::string nulls((columns + 7) / 8, '\0');
+        const unsigned values = with_null ? ints - 1 : ints;
+        if (with_null)
+            nulls[(columns - 1) / 8] |= 1 << ((columns - 1) & 7);
+        event += nulls;
+        if (text_size)
+            event += packInt(text.size(), 4) + text;
+        for (unsigned j = 0; j < values; ++j)
+        {
+            if (datetime)
+                // 2011-03-13 09:49:09 with j seconds in big endian
+                event += std::string("\x99\x89\x9a\x6c", 4) + static_cast<char>(0x40 + j % 20);
+            else
+                event += packInt(i * ints + j, 4);
+        }
+    }
+    return event;
+}
+
+double run(slave::RelayLogInfo& rli, const std::string& event, unsigned events, slave::ParallelDecode* decode = nullptr)
+{
+    slave::EmptyExtState ext_state;
+    slave::Basic_event_info bei;
+    bei.parse(event.data(), event.size());
+    slave::Row_event_info roi(bei.buf, bei.event_len, false, false);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < events; ++i)
+        slave::apply_row_event(rli, bei, roi, ext_state, nullptr, nullptr, nullptr, decode);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#if defined(SLAVE_USE_STD_VARIANT_FOR_FIELD_VALUE)
+const char* const field_value_mode = "std::variant";
+#elif defined(SLAVE_USE_VARIANT_FOR_FIELD_VALUE)
+const char* const field_value_mode = "boost::variant";
+#else
+const char* const field_value_mode = "boost::any";
+#endif
+
+// Packed row of typical columns and its fields
+struct TypicalRow
+{
+    std::vector<slave::PtrField> fields;
+    std::string packed;
+
+    TypicalRow()
+    {
+        slave::collate_info ci;
+        ci.maxlen = 1;
+        const std::string text = "short name and a long description of the row";
+
+        fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        packed += packInt(123456, 4);
+        fields.emplace_back(new slave::Field_longlong("total", "bigint(20)"));
+        packed += packInt(1ULL << 40, 8);
+        fields.emplace_back(new slave::Field_tiny("flag", "tinyint(1)"));
+        packed += packInt(1, 1);
+        fields.emplace_back(new slave::Field_short("count", "smallint(5) unsigned"));
+        packed += packInt(1000, 2);
+        fields.emplace_back(new slave::Field_enum("state", "enum('a','b')", 2));
+        packed += packInt(2, 1);
+        fields.emplace_back(new slave::Field_double("price", "double"));
+        const double price = 123.45;
+        packed.append(reinterpret_cast<const char*>(&price), sizeof(price));
+        fields.emplace_back(new slave::Field_bit("mask", "bit(64)"));
+        packed += std::string(8, '\x5a');
+        fields.emplace_back(new slave::Field_varstring("name", "varchar(64)", ci));
+        packed += packInt(10, 1) + text.substr(0, 10);
+        fields.emplace_back(new slave::Field_varstring("description", "varchar(200)", ci));
+        packed += packInt(text.size(), 1) + text;
+    }
+};
+
+// Returns ns per value of decoding the row 'rows' times into the reused row by 'unpack'
+template <typename Unpack>
+double bench_decode(const TypicalRow& typical, unsigned rows, std::vector<slave::FieldValue>& row, Unpack unpack)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        const char* from = typical.packed.data();
+        for (size_t j = 0; j < row.size(); ++j)
+            from = unpack(j, from, row[j]);
+    }
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return time * 1e9 / (double(rows) * row.size());
+}
+
+// Decodes the same packed row with Field::unpack() and the decode plan, and stores decoded
+// values with setFieldValue(), into FieldValue of the mode the library is built with.
+// Builds with each mode give the comparison (see types.h).
+void bench_field_values(unsigned rows)
+{
+    const TypicalRow typical;
+    slave::DecodePlan plan;
+    plan.build(typical.fields);
+    std::vector<slave::FieldValue> row(typical.fields.size());
+
+    std::cout << "FieldValue is " << field_value_mode << std::endl;
+    std::cout << "Field::unpack(): " << bench_decode(typical, rows, row, [&](size_t i, const char* from, slave::FieldValue& value)
+    {
+        return typical.fields[i]->unpack(from, value);
+    }) << " ns per value" << std::endl;
+    std::cout << "Decode plan:     " << bench_decode(typical, rows, row, [&](size_t i, const char* from, slave::FieldValue& value)
+    {
+        return plan.unpack(i, from, value);
+    }) << " ns per value" << std::endl;
+
+    // Values of other types are stored in turn, as in columns of other tables
+    const std::vector<slave::FieldValue> decoded = row;
+    size_t total = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < row.size(); ++j)
+        {
+            slave::FieldValue& value = row[(i + j) % row.size()];
+            slave::visit([&](const auto& x)
+            {
+                if constexpr (std::is_same<std::decay_t<decltype(x)>, std::string>::value)
+                    slave::setFieldValue(value, x.data(), x.size());
+                else if constexpr (!std::is_same<std::decay_t<decltype(x)>, std::nullptr_t>::value)
+                    slave::setFieldValue(value, x);
+                return 0;
+            }, decoded[j]);
+        }
+        total += row.size();
+    }
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "setFieldValue(): " << time * 1e9 / total << " ns per value, stored " << total << " values" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned columns = 8;
+    unsigned rows = 100;
+    unsigned events = 100000;
+    bool with_null = false;
+    size_t text_size = 0;
+    slave::RowType row_type = slave::RowType::Vector;
+    bool values = false;
+    bool columnar = false;
+    bool datetime = false;
+    unsigned threads = 0;
+
+    int c;
+    while (-1 != (c = ::getopt(argc, argv, "c:r:e:nt:R:vLDP:")))
+    {
+        switch (c)
+        {
+        case 'c': columns = std::stoul(optarg); break;
+        case 'r': rows = std::stoul(optarg); break;
+        case 'e': events = std::stoul(optarg); break;
+        case 'n': with_null = true; break;
+        case 't': text_size = std::stoul(optarg); break;
+        case 'R':
+            if (std::string(optarg) == "map")
+                row_type = slave::RowType::Map;
+            else if (std::string(optarg) == "flat")
+                row_type = slave::RowType::Flat;
+            else if (std::string(optarg) != "vector")
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'v': values = true; break;
+        case 'L': columnar = true; break;
+        case 'D': datetime = true; break;
+        case 'P': threads = std::stoul(optarg); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!columns || columns > 240 || !rows || !events)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (values)
+    {
+        bench_field_values(rows * 10000);
+        return 0;
+    }
+
+    slave::RelayLogInfo rli;
+    rli.setTableName(1, "test", "db");
+    slave::PtrTable table(new slave::Table("db", "test"));
+    std::vector<std::string> column_filter;
+    if (text_size)
+        table->fields.emplace_back(new slave::Field_longblob("text", "longtext"));
+    for (unsigned i = 0; i < columns; ++i)
+    {
+        column_filter.push_back("c" + std::to_string(i));
+        if (datetime)
+            table->fields.emplace_back(new slave::Field_datetime(column_filter.back(), "datetime", false));
+        else
+            table->fields.emplace_back(new slave::Field_long(column_filter.back(), "int(11)"));
+    }
+    table->m_filter = slave::eAll;
+    table->row_type = row_type;
+    if (text_size)
+        table->set_column_filter(column_filter);
+
+    size_t total = 0;
+    if (columnar)
+        table->m_columnar_callback = [&](slave::ColumnarBatch& batch)
+        {
+            total += batch.rows * batch.columns.size();
+        };
+    else
+        table->m_callback = [&](slave::RecordSet& rs)
+        {
+            total += rs.m_row.size() + rs.m_row_vec.size() + rs.m_row_flat.size();
+        };
+    slave::Table& t = *table;
+    rli.setTable("test", "db", std::move(table));
+
+    const std::string event = makeEvent(columns, rows, with_null, text_size, datetime);
+    const double count = double(rows) * events;
+
+    const double virtual_time = run(rli, event, events);
+    std::cout << "Field::unpack(): " << virtual_time * 1e9 / count << " ns per row" << std::endl;
+
+    t.build_plan();
+    const double plan_time = run(rli, event, events);
+    std::cout << "Decode plan:     " << plan_time * 1e9 / count << " ns per row" << std::endl;
+
+    std::cout << "Speedup: " << virtual_time / plan_time << ", decoded " << total << " values" << std::endl;
+
+    if (threads)
+    {
+        slave::ParallelDecode decode(threads, 0);
+        const double parallel_time = run(rli, event, events, &decode);
+        std::cout << "Parallel decode: " << parallel_time * 1e9 / count << " ns per row, "
+                  << threads << " threads, speedup over plan " << plan_time / parallel_time << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <getopt.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "aux/parse_list.h"
+#include "QueryClassifier.h"
+
+// Benchmark of finding tables changed by statements of QUERY_EVENT:
+// QueryClassifier against regular expressions used before it. The corpus is
+// statements of a row based binlog, mostly BEGIN, or the lines of the file given by -f.
+// Tables found by both ways are compared for the statements the regular expressions know.
+
+void usage(const char* name)
+{
+    std::cout << "Usage: " << name << " [-n <rounds>] [-f <file of statements>]\n"
+              << " -n sets number of passes over the statements\n"
+              << " -f reads statements from the file, one per line, databases with subscriptions are 'db' and 'test'" << std::endl;
+}
+
+const std::vector<std::string> corpus = {
+    "BEGIN",
+    "BEGIN",
+    "BEGIN",
+    "BEGIN",
+    "BEGIN",
+    "BEGIN",
+    "BEGIN",
+    "BEGIN",
+    "COMMIT",
+    "SAVEPOINT `sp1`",
+    "FLUSH PRIVILEGES",
+    "GRANT SELECT ON `db`.* TO 'reader'@'%'",
+    "CREATE DATABASE IF NOT EXISTS `archive`",
+    "CREATE TABLE `orders` (\n  `id` int(11) NOT NULL AUTO_INCREMENT,\n  `user_id` int(11) NOT NULL,\n"
+    "  `created` datetime NOT NULL,\n  PRIMARY KEY (`id`),\n  KEY `user_id` (`user_id`)\n) ENGINE=InnoDB DEFAULT CHARSET=utf8",
+    "CREATE TABLE IF NOT EXISTS test.stat (value varchar(50))",
+    "ALTER TABLE `orders` ADD COLUMN `comment` varchar(255) DEFAULT NULL AFTER `created`",
+    "ALTER TABLE test.stat DROP COLUMN value, ADD COLUMN value int",
+    "/* pt-online-schema-change */ ALTER TABLE `db`.`_orders_new` ADD INDEX `created` (`created`)",
+    "RENAME TABLE `db`.`orders` TO `db`.`_orders_old`, `db`.`_orders_new` TO `db`.`orders`",
+    "ALTER TABLE test_temp \nRENAME TO test",
+    "DROP TABLE IF EXISTS `db`.`_orders_old` /* generated by server */",
+    "DROP TABLE IF EXISTS `log_2015_01` /* generated by server */",
+    "TRUNCATE TABLE `sessions`",
+    "CREATE DEFINER=`root`@`localhost` TRIGGER orders_ai AFTER INSERT ON orders FOR EACH ROW SET @x = 1",
+};
+
+// Tables found by the regular expressions replaced by QueryClassifier
+std::vector<slave::TableKey> regexQuery(const std::string& query, const std::string& db_name)
+{
+    static const std::regex replace_regex(R"(/\*.*?\*/)", std::regex_constants::optimize);
+    static const std::regex alter_rename_regex(R"((?:alter\s+table\s+.*rename\s+)(?:to\s+|as\s+)?(?:`?(\w+)`?\.)?`?(\w+)`?)",
+                                               std::regex_constants::optimize | std::regex_constants::icase);
+    static const std::regex rename_regex(R"((?:rename\s+table\s+)(?:`?\w+`?\.)?`?(?:\w+)`?(?:\s+to\s+)(?:`?(\w+)`?\.)?`?(\w+)`?)",
+                                         std::regex_constants::optimize | std::regex_constants::icase);
+    static const std::regex rename_sub_regex(R"((?:`?\w+`?\.)?`?(?:\w+)`?(?:\s+to\s+)(?:`?(\w+)`?\.)?`?(\w+)`?)",
+                                             std::regex_constants::optimize | std::regex_constants::icase);
+    static const std::regex common_regex(R"((?:alter\s+table|create\s+table(?:\s+if\s+not\s+exists)?)\s+(?:`?(\w+)`?\.)?`?(\w+)`?)",
+                                         std::regex_constants::optimize | std::regex_constants::icase);
+
+    static const std::string table = "table";
+    const auto it = std::search(query.begin(), query.end(), table.begin(), table.end(),
+                                [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+    if (it == query.end())
+        return {};
+
+    std::string s;
+    std::replace_copy(query.begin(), query.end(), std::back_inserter(s), '\n', ' ');
+    s = std::regex_replace(s, replace_regex, " ");
+
+    std::vector<slave::TableKey> tableKeys;
+    std::smatch sm;
+    if (std::regex_search(s, sm, alter_rename_regex))
+    {
+        tableKeys.emplace_back(sm[1], sm[2]);
+    }
+    else if (std::regex_search(s, sm, rename_regex))
+    {
+        tableKeys.emplace_back(sm[1], sm[2]);
+        bool first = true;
+        aux::parse_list(s.c_str(), [&first, &tableKeys](std::string_view sub)
+        {
+            if (first)
+            {
+                first = false;
+                return;
+            }
+
+            std::match_results<std::string_view::const_iterator> sm;
+            if (std::regex_search(sub.begin(), sub.end(), sm, rename_sub_regex))
+                tableKeys.emplace_back(sm[1], sm[2]);
+        });
+    }
+    else if (std::regex_search(s, sm, common_regex))
+    {
+        tableKeys.emplace_back(sm[1], sm[2]);
+    }
+
+    for (auto& tableKey : tableKeys)
+        if (tableKey.db_name.empty())
+            tableKey.db_name = db_name;
+    return tableKeys;
+}
+
+std::string names(const std::vector<slave::TableKey>& tables)
+{
+    std::string result;
+    for (const auto& key : tables)
+        result += (result.empty() ? "" : " ") + key.db_name + "." + key.table_name;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned rounds = 10000;
+    std::string file;
+
+    int c;
+    while (-1 != (c = ::getopt(argc, argv, "n:f:")))
+    {
+        switch (c)
+        {
+        case 'n': rounds = std::stoul(optarg); break;
+        case 'f': file = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> queries = corpus;
+    if (!file.empty())
+    {
+        std::ifstream in(file);
+        if (!in)
+        {
+            std::cerr << "Can not open " << file << std::endl;
+            return 1;
+        }
+        queries.clear();
+        for (std::string line; std::getline(in, line);)
+            if (!line.empty())
+                queries.push_back(line);
+    }
+    if (!rounds || queries.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const std::string default_db = "db";
+    slave::QueryClassifier classifier;
+    classifier.addDatabase("db");
+    classifier.addDatabase("test");
+
+    // Results of both ways for the DDL the regular expressions know
+    std::vector<slave::TableKey> tables;
+    for (const auto& query : queries)
+    {
+        tables.clear();
+        const slave::QueryKind kind = classifier.classify(query, default_db, tables);
+        if (kind == slave::QueryKind::DropTable)
+            continue;
+
+        std::vector<slave::TableKey> expected;
+        for (auto& key : regexQuery(query, default_db))
+            if (classifier.hasDatabase(key.db_name))
+                expected.push_back(std::move(key));
+        if (names(tables) != names(expected))
+            std::cout << "Mismatch: " << query << "\n  classifier: " << names(tables)
+                      << "\n  regex:      " << names(expected) << std::endl;
+    }
+
+    const double count = double(rounds) * queries.size();
+    size_t total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < rounds; ++i)
+        for (const auto& query : queries)
+            total += regexQuery(query, default_db).size();
+    const double regex_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "std::regex:      " << regex_time * 1e9 / count << " ns per statement" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < rounds; ++i)
+        for (const auto& query : queries)
+        {
+            tables.clear();
+            classifier.classify(query, default_db, tables);
+            total += tables.size();
+        }
+    const double classifier_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "QueryClassifier: " << classifier_time * 1e9 / count << " ns per statement" << std::endl;
+
+    std::cout << "Speedup: " << regex_time / classifier_time << ", found " << total << " tables" << std::endl;
+    return 0;
+}
@@ -4,7 +4,9 @@
 #include <sstream>
 #include <signal.h>
 #include <cstddef>  // for std::nullptr_t
+#include <mutex>
 
+#include "crc32.h"
 #include "Slave.h"
 #include "DefaultExtState.h"
 
@@ -12,50 +14,23 @@
 volatile sig_atomic_t stop = 0;
 slave::Slave* sl = NULL;
 
-std::string print(const slave::FieldValue& v) {
-
-    if (v.type() == typeid(std::string)) {
-
-        return "'" +  slave::get<std::string>(v) + "'";
+struct ValuePrinter
+{
+    std::string operator()(std::nullptr_t) const { return "NULL"; }
+    std::string operator()(const std::string& v) const { return "'" + v + "'"; }
 
-    } else {
+    template <typename T>
+    std::string operator()(const T& v) const
+    {
         std::ostringstream s;
-
-        if (slave::isNullFieldValue(v))
-            s << "NULL";
-
-        else if (v.type() == typeid(int))
-            s << slave::get<int>(v);
-
-        else if (v.type() == typeid(char))
-            s << slave::get<char>(v);
-
-        else if (v.type() == typeid(uint16_t))
-            s << slave::get<uint16_t>(v);
-
-        else if (v.type() == typeid(int32_t))
-            s << slave::get<int32_t>(v);
-
-        else if (v.type() == typeid(uint32_t))
-            s << slave::get<uint32_t>(v);
-
-        else if (v.type() == typeid(unsigned long long))
-            s << slave::get<unsigned long long>(v);
-
-        else if (v.type() == typeid(float))
-            s << slave::get<float>(v);
-
-        else if (v.type() == typeid(double))
-            s << slave::get<double>(v);
-
-        else if (v.type() == typeid(void))
-            s << "void";
-
-        else
-            s << "unknown type";
-
+        s << v;
         return s.str();
     }
+};
+
+std::string print(const slave::FieldValue& v) {
+
+    return slave::visit(ValuePrinter(), v);
 }
 
 
@@ -91,6 +66,26 @@ void callback(const slave::RecordSet& event) {
             std::cout << "\n";
         }
     }
+    else if (event.row_type == slave::RowType::Flat)
+    {
+        const slave::FlatRow& row = event.m_row_flat;
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            if (!row.has(i))
+                continue;
+            const auto value = print(row[i]);
+            std::cout << "  " << row.name(i) << " : " << row.type(i) << " -> " << value;
+            if (event.type_event == slave::RecordSet::Update)
+            {
+                std::string old_value("NULL");
+                if (event.m_old_row_flat.has(i))
+                    old_value = print(event.m_old_row_flat[i]);
+                if (value != old_value)
+                    std::cout << "    (was: " << old_value << ")";
+            }
+            std::cout << "\n";
+        }
+    }
     else
     {
         for (auto it = event.m_row_vec.begin(); it != event.m_row_vec.end(); ++it)
@@ -134,10 +129,16 @@ std::map<time_t, size_t> commits_in_time;
 size_t ci_counter;
 time_t last_output_time;
 double total_work_time;
+double total_cpu_time;
+uint64_t total_bytes;
 
-void bench_callback(const slave::RecordSet& event) {
-    ++total_events;
-    ++ev_counter;
+// Callbacks may be called by several threads, see -T
+std::mutex bench_mutex;
+
+void bench_count(size_t rows) {
+    std::lock_guard<std::mutex> l(bench_mutex);
+    total_events += rows;
+    ev_counter += rows;
     if (ev_counter >= 100)
     {
         const time_t ct = ::time(NULL);
@@ -151,6 +152,22 @@ void bench_callback(const slave::RecordSet& event) {
     }
 }
 
+void bench_callback(const slave::RecordSet& event) {
+    bench_count(1);
+}
+
+void bench_batch_callback(const std::vector<slave::RecordSet>& rows) {
+    bench_count(rows.size());
+}
+
+void bench_view_callback(const slave::RecordView& event) {
+    bench_count(1);
+}
+
+void bench_columnar_callback(const slave::ColumnarBatch& batch) {
+    bench_count(batch.rows);
+}
+
 void bench_xid_callback(unsigned int server_id) {
     ++total_commits;
     ++ci_counter;
@@ -176,10 +193,19 @@ void usage(const char* name)
 {
     std::cout << "Usage: " << name << " -h <mysql host> -u <mysql user> -p <mysql password> -d <mysql database>"
               << " -P <mysql port> [-b <binlog_name> -o <binlog_pos> -B <to_binlog_name> -O <to_binlog_pos|-g <gtid_pos>"
-              << " -G <to_gtid_pos>] -C -m"
+              << " -G <to_gtid_pos>] -C -m [-Q <queue size>] -K -N [-R <rcvbuf>] -z [-T <threads>] -S -V -L"
               << " <table name> <table name> ...\n"
               << " -C means use empty callbacks\n"
               << " -m means benchmark\n"
+              << " -Q means pipelined mode: network reading in a separate thread with a queue of given size\n"
+              << " -K means verifying event checksums in network reading thread (with -Q)\n"
+              << " -N means built-in binlog protocol reader instead of libmysqlclient\n"
+              << " -R sets SO_RCVBUF of the connection socket\n"
+              << " -T sets number of threads calling callbacks\n"
+              << " -S means batch callbacks, one call per rows event (with -m)\n"
+              << " -V means callbacks with lazily decoded rows (with -m)\n"
+              << " -L means columnar callbacks, one call per rows event (with -m)\n"
+              << " -z means compressed protocol (use with -N to count compressed traffic)\n"
               << " If -C and -m both specified, then empty callbacks will be used, but logging will be switched off"
               << std::endl;
 }
@@ -201,9 +227,18 @@ int main(int argc, char** argv)
 
     bool use_empty_callback = false;
     bool benchmark = false;
+    size_t pipeline_size = 0;
+    bool checksum_in_reader = false;
+    bool native_reader = false;
+    int socket_rcvbuf = 0;
+    bool compress = false;
+    unsigned int apply_threads = 0;
+    bool batch = false;
+    bool view = false;
+    bool columnar = false;
 
     int c;
-    while (-1 != (c = ::getopt(argc, argv, "h:u:p:P:d:b:o:B:O:g:G:Cm")))
+    while (-1 != (c = ::getopt(argc, argv, "h:u:p:P:d:b:o:B:O:g:G:CmQ:KNR:zT:SVL")))
     {
         switch (c)
         {
@@ -220,6 +255,15 @@ int main(int argc, char** argv)
         case 'G': to_gtid_pos = optarg; break;
         case 'C': use_empty_callback = true; break;
         case 'm': benchmark = true; break;
+        case 'Q': pipeline_size = std::stoul(optarg); break;
+        case 'K': checksum_in_reader = true; break;
+        case 'N': native_reader = true; break;
+        case 'R': socket_rcvbuf = std::stoi(optarg); break;
+        case 'z': compress = true; break;
+        case 'T': apply_threads = std::stoul(optarg); break;
+        case 'S': batch = true; break;
+        case 'V': view = true; break;
+        case 'L': columnar = true; break;
         default:
             usage(argv[0]);
             return 1;
@@ -247,10 +291,17 @@ int main(int argc, char** argv)
     masterinfo.conn_options.mysql_port = port;
     masterinfo.conn_options.mysql_user = user;
     masterinfo.conn_options.mysql_pass = password;
+    masterinfo.conn_options.mysql_compress = compress;
+    masterinfo.pipeline_size = pipeline_size;
+    masterinfo.checksum_in_reader = checksum_in_reader;
+    masterinfo.native_reader = native_reader;
+    masterinfo.apply_threads = apply_threads;
+    masterinfo.socket_rcvbuf = socket_rcvbuf;
     signal(SIGINT, sighandler);
     signal(SIGTERM, sighandler);
 
     bool error = false;
+    slave::EventRingStats pipeline_stats;
 
     try {
 
@@ -268,6 +319,12 @@ int main(int argc, char** argv)
         for (std::vector<std::string>::const_iterator i = tables.begin(); i != tables.end(); ++i) {
             if (use_empty_callback)
                 slave.setCallback(database, *i, empty_callback);
+            else if (benchmark && columnar)
+                slave.setColumnarCallback(database, *i, bench_columnar_callback);
+            else if (benchmark && view)
+                slave.setViewCallback(database, *i, bench_view_callback);
+            else if (benchmark && batch)
+                slave.setBatchCallback(database, *i, bench_batch_callback);
             else if (benchmark)
                 slave.setCallback(database, *i, bench_callback);
             else
@@ -294,14 +351,19 @@ int main(int argc, char** argv)
             std::cout << "Reading binlogs..." << std::endl;
             if (!to_binlog_name.empty() || 0 != to_binlog_pos || !to_gtid_pos.empty())
             {
-                struct timespec start, finish;
+                struct timespec start, finish, cpu_start, cpu_finish;
                 clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+                clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+                const uint64_t start_bytes = slave.bytesReceived();
                 slave.get_remote_binlog([&] ()
                         {
                             const slave::MasterInfo& sMasterInfo = slave.masterInfo();
                             return (isStopping() || sMasterInfo.position.reachedOtherPos(to_pos));
                         });
                 clock_gettime(CLOCK_MONOTONIC_RAW, &finish);
+                clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_finish);
+                total_bytes = slave.bytesReceived() - start_bytes;
+                total_cpu_time = (cpu_finish.tv_sec - cpu_start.tv_sec) + (cpu_finish.tv_nsec - cpu_start.tv_nsec) / 1e9;
                 finish.tv_sec  -= start.tv_sec;
                 finish.tv_nsec -= start.tv_nsec;
                 if (0 > finish.tv_nsec)
@@ -310,6 +372,7 @@ int main(int argc, char** argv)
                     finish.tv_nsec += 1000000000;
                 }
                 total_work_time = finish.tv_sec + finish.tv_nsec / 1e9;
+                pipeline_stats = slave.pipelineStats();
             }
             else
             {
@@ -337,6 +400,19 @@ int main(int argc, char** argv)
         std::cout << "Total work time: " << total_work_time << " seconds" << std::endl;
         std::cout << "Total read events: " << total_events << std::endl;
         std::cout << "Total read commits: " << total_commits << std::endl;
+        std::cout << "CRC32 implementation: " << slave::checksum_crc32_impl() << std::endl;
+        std::cout << "Total CPU time: " << total_cpu_time << " seconds";
+        if (total_events)
+            std::cout << ", " << total_cpu_time * 1e6 / total_events << " us per event";
+        std::cout << std::endl;
+        std::cout << "Total received bytes: " << total_bytes;
+        if (total_events)
+            std::cout << ", " << double(total_bytes) / total_events << " per event";
+        std::cout << (compress ? " (compressed protocol)" : "") << std::endl;
+        if (pipeline_size)
+            std::cout << "Pipeline queue size: " << pipeline_stats.capacity
+                      << ", reader stalls: " << pipeline_stats.producer_stalls
+                      << ", processing stalls: " << pipeline_stats.consumer_stalls << std::endl;
 
         std::cout << "\nEvents bench\n";
         for (const auto& x : events_in_time)
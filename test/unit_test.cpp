@@ -7,16 +7,31 @@ using namespace boost::unit_test;
 #include <boost/mpl/list.hpp>
 #include <boost/optional.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cfloat>
+#include <chrono>
 #include <cmath>
 #include <condition_variable>
 #include <cstddef>  // for std::nullptr_t
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
 #include <thread>
+#include <tuple>
 
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "crc32.h"
 #include "decimal_internal.h"
 #include "decimal_supp.h"
 #include "Slave.h"
@@ -733,6 +748,63 @@ namespace // anonymous
             BOOST_ERROR("Unwanted calls before this case: " << f.m_Callback.m_UnwantedCalls);
     }
 
+    // Check that rows of one transaction are delivered at once by transaction callback.
+    void test_TransactionCallback()
+    {
+        Fixture f;
+        f.conn->query("DROP TABLE IF EXISTS test");
+        f.conn->query("CREATE TABLE IF NOT EXISTS test (value int) ENGINE=InnoDB");
+
+        f.stopSlave();
+
+        std::mutex sMutex;
+        std::vector<slave::Transaction> sTransactions;
+        f.m_Slave.setTransactionCallback([&sMutex, &sTransactions] (slave::Transaction& t)
+        {
+            std::lock_guard<std::mutex> l(sMutex);
+            sTransactions.push_back(t);
+        });
+
+        f.conn->query("BEGIN");
+        f.conn->query("INSERT INTO test VALUES (1), (2)");
+        f.conn->query("UPDATE test SET value = 3 WHERE value = 2");
+        f.conn->query("DELETE FROM test WHERE value = 1");
+        f.conn->query("COMMIT");
+        const auto sCommitPos = f.m_Slave.getLastBinlogPos();
+
+        f.startSlave();
+
+        // Wait callback triggering no more than 1 second.
+        const timespec ts = {0 , 1000000};
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            ::nanosleep(&ts, NULL);
+            std::lock_guard<std::mutex> l(sMutex);
+            if (!sTransactions.empty())
+                break;
+        }
+        f.stopSlave();
+        f.m_Slave.setTransactionCallback(nullptr);
+
+        if (sTransactions.size() != 1)
+        {
+            BOOST_ERROR("Have " << sTransactions.size() << " calls to transaction callback instead of 1");
+            return;
+        }
+        const auto& t = sTransactions.front();
+        BOOST_CHECK_EQUAL(t.log_name, sCommitPos.log_name);
+        BOOST_CHECK_EQUAL(t.log_pos, sCommitPos.log_pos);
+        BOOST_REQUIRE_EQUAL(t.records.size(), 4);
+        BOOST_CHECK_EQUAL(t.records[0].type_event, slave::RecordSet::Write);
+        BOOST_CHECK_EQUAL(t.records[1].type_event, slave::RecordSet::Write);
+        BOOST_CHECK_EQUAL(t.records[2].type_event, slave::RecordSet::Update);
+        BOOST_CHECK_EQUAL(t.records[3].type_event, slave::RecordSet::Delete);
+        BOOST_CHECK_EQUAL(slave::get<uint32_t>(t.records[2].m_row.at("value").second), 3u);
+
+        // Table callbacks are not called in this mode
+        BOOST_CHECK_EQUAL(f.m_Callback.m_UnwantedCalls, 0);
+    }
+
     struct CheckBinlogPos
     {
         const slave::Slave& m_Slave;
@@ -1920,6 +1992,1776 @@ namespace // anonymous
                 BOOST_TEST((slave::decimal::digit_and_count_t(123456789, 9) == *++rit));
         }
     }
+
+    // Builds binlog file contents event by event, positions are filled like mysqld does
+    class BinlogBuilder
+    {
+        std::string m_data = std::string("\xfe" "bin", 4);
+
+        static void appendInt(std::string& s, uint64_t value, size_t bytes)
+        {
+            for (size_t i = 0; i < bytes; ++i)
+                s.push_back(static_cast<char>(value >> (8 * i)));
+        }
+
+    public:
+        void add(slave::Log_event_type type, const std::string& body)
+        {
+            const size_t len = LOG_EVENT_HEADER_LEN + body.size();
+            const size_t end = m_data.size() + len;
+            appendInt(m_data, 1500000000, 4);       // timestamp
+            m_data.push_back(static_cast<char>(type));
+            appendInt(m_data, 1, 4);                // server_id
+            appendInt(m_data, len, 4);              // event_len
+            appendInt(m_data, end, 4);              // log_pos
+            appendInt(m_data, 0, 2);                // flags
+            m_data += body;
+        }
+
+        // MySQL 5.7 format description with binlog_checksum=NONE
+        void addFormatDescription()
+        {
+            std::string body;
+            appendInt(body, 4, 2);
+            std::string version = "5.7.30-log";
+            version.resize(ST_SERVER_VER_LEN, '\0');
+            body += version;
+            appendInt(body, 0, 4);
+            body.push_back(LOG_EVENT_HEADER_LEN);
+            const size_t event_types = slave::ENUM_END_EVENT - 1;
+            std::string postlen(event_types, '\0');
+            postlen[slave::QUERY_EVENT - 1] = QUERY_HEADER_LEN;
+            postlen[slave::ROTATE_EVENT - 1] = ROTATE_HEADER_LEN;
+            postlen[slave::FORMAT_DESCRIPTION_EVENT - 1] = START_V3_HEADER_LEN + 1 + event_types;
+            postlen[slave::TABLE_MAP_EVENT - 1] = TABLE_MAP_HEADER_LEN;
+            for (auto type : {slave::WRITE_ROWS_EVENT_V1, slave::UPDATE_ROWS_EVENT_V1, slave::DELETE_ROWS_EVENT_V1})
+                postlen[type - 1] = ROWS_HEADER_LEN_V1;
+            for (auto type : {slave::WRITE_ROWS_EVENT, slave::UPDATE_ROWS_EVENT, slave::DELETE_ROWS_EVENT})
+                postlen[type - 1] = ROWS_HEADER_LEN;
+            body += postlen;
+            body.push_back(slave::BINLOG_CHECKSUM_ALG_OFF);
+            appendInt(body, 0, BINLOG_CHECKSUM_LEN);
+            add(slave::FORMAT_DESCRIPTION_EVENT, body);
+        }
+
+        void addQuery(const std::string& db, const std::string& query)
+        {
+            std::string body;
+            appendInt(body, 1, 4);                  // thread_id
+            appendInt(body, 0, 4);                  // exec_time
+            body.push_back(static_cast<char>(db.size()));
+            appendInt(body, 0, 2);                  // error_code
+            appendInt(body, 0, 2);                  // status_vars_len
+            body += db;
+            body.push_back('\0');
+            body += query;
+            add(slave::QUERY_EVENT, body);
+        }
+
+        void addXid(uint64_t xid)
+        {
+            std::string body;
+            appendInt(body, xid, 8);
+            add(slave::XID_EVENT, body);
+        }
+
+        void addRotate(const std::string& next_log)
+        {
+            std::string body;
+            appendInt(body, 4, 8);
+            body += next_log;
+            add(slave::ROTATE_EVENT, body);
+        }
+
+        size_t size() const { return m_data.size(); }
+
+        void write(const std::string& file) const
+        {
+            std::ofstream f(file.c_str(), std::ios::binary);
+            f.write(m_data.data(), m_data.size());
+        }
+    };
+
+    void test_BinlogFileSource()
+    {
+        char dir_template[] = "/tmp/libslave_test_XXXXXX";
+        const std::string dir = ::mkdtemp(dir_template);
+
+        BinlogBuilder first;
+        first.addFormatDescription();
+        first.addQuery("test", "BEGIN");
+        first.addXid(1);
+        const size_t first_xid_pos = first.size();
+        first.addRotate("binlog.000002");
+        first.write(dir + "/binlog.000001");
+
+        BinlogBuilder second;
+        second.addFormatDescription();
+        second.addQuery("test", "BEGIN");
+        second.addXid(2);
+        second.write(dir + "/binlog.000002");
+
+        {
+            std::ofstream index((dir + "/binlog.index").c_str());
+            index << "./binlog.000001\n./binlog.000002\n";
+        }
+
+        {
+            slave::BinlogFileSource source(dir + "/binlog.index");
+            BOOST_REQUIRE_EQUAL(source.files().size(), 2);
+
+            std::vector<int> types;
+            const char* buf = nullptr;
+            unsigned int len = 0;
+            while (source.next(buf, len))
+            {
+                BOOST_CHECK(len >= LOG_EVENT_HEADER_LEN);
+                types.push_back(buf[EVENT_TYPE_OFFSET]);
+            }
+            const std::vector<int> expected = {slave::FORMAT_DESCRIPTION_EVENT, slave::QUERY_EVENT, slave::XID_EVENT, slave::ROTATE_EVENT,
+                                               slave::FORMAT_DESCRIPTION_EVENT, slave::QUERY_EVENT, slave::XID_EVENT};
+            BOOST_CHECK(types == expected);
+            BOOST_CHECK_EQUAL(source.logName(), "binlog.000002");
+            BOOST_CHECK_EQUAL(source.serverVersion(), 50730);
+            BOOST_CHECK(!source.next(buf, len));
+        }
+
+        // Whole stream, crossing the binlog boundary
+        {
+            slave::BinlogFileSource source(dir + "/binlog.index");
+            slave::Slave slave;
+            unsigned xids = 0;
+            slave.setXidCallback([&xids](unsigned int) { ++xids; });
+            slave.get_local_binlog(source);
+            BOOST_CHECK_EQUAL(xids, 2);
+            BOOST_CHECK_EQUAL(slave.masterVersion(), 50730);
+            BOOST_CHECK_EQUAL(slave.masterInfo().position.log_name, "binlog.000002");
+            BOOST_CHECK_EQUAL(slave.masterInfo().position.log_pos, second.size());
+        }
+
+        // Starting from the saved position
+        {
+            slave::BinlogFileSource source(std::vector<std::string>{dir + "/binlog.000001", dir + "/binlog.000002"});
+            slave::MasterInfo master_info;
+            master_info.position.log_name = "binlog.000001";
+            master_info.position.log_pos = first_xid_pos;
+            slave::Slave slave(master_info);
+            slave.setMasterInfo(master_info);
+            unsigned xids = 0;
+            slave.setXidCallback([&xids](unsigned int) { ++xids; });
+            slave.get_local_binlog(source);
+            BOOST_CHECK_EQUAL(xids, 1);
+            BOOST_CHECK_EQUAL(slave.masterInfo().position.log_name, "binlog.000002");
+            BOOST_CHECK_EQUAL(slave.masterInfo().position.log_pos, second.size());
+        }
+
+        // Missing binlog stops reading instead of being retried
+        {
+            slave::BinlogFileSource source(std::vector<std::string>{dir + "/binlog.000001", dir + "/binlog.000003"});
+            slave::Slave slave;
+            unsigned xids = 0;
+            slave.setXidCallback([&xids](unsigned int) { ++xids; });
+            BOOST_CHECK_THROW(slave.get_local_binlog(source), std::runtime_error);
+            BOOST_CHECK_EQUAL(xids, 1);
+        }
+
+        for (const char* name : {"/binlog.000001", "/binlog.000002", "/binlog.index"})
+            ::unlink((dir + name).c_str());
+        ::rmdir(dir.c_str());
+    }
+
+    void test_EventRing()
+    {
+        slave::EventRing ring(4);
+        BOOST_CHECK_EQUAL(ring.capacity(), 4);
+        BOOST_CHECK(ring.front(std::chrono::milliseconds(1)) == nullptr);
+
+        const unsigned long count = 100000;
+        std::atomic<bool> stop{false};
+        std::thread producer([&ring, &stop, count]()
+        {
+            for (unsigned long i = 0; i < count; ++i)
+            {
+                slave::EventRing::Slot* slot = ring.acquire(stop);
+                if (!slot)
+                    return;
+                slot->data.resize(sizeof(i));
+                std::memcpy(slot->data.data(), &i, sizeof(i));
+                slot->len = sizeof(i);
+                slot->error = false;
+                ring.publish();
+            }
+            slave::EventRing::Slot* slot = ring.acquire(stop);
+            if (!slot)
+                return;
+            slot->len = 0;
+            slot->error = true;
+            ring.publish();
+        });
+
+        unsigned long expected = 0;
+        bool ordered = true;
+        while (true)
+        {
+            slave::EventRing::Slot* slot = ring.front(std::chrono::milliseconds(1000));
+            BOOST_REQUIRE(slot != nullptr);
+            BOOST_CHECK_LE(ring.depth(), ring.capacity());
+            if (slot->error)
+            {
+                ring.pop();
+                break;
+            }
+            unsigned long value;
+            std::memcpy(&value, slot->data.data(), sizeof(value));
+            ordered = ordered && slot->len == sizeof(value) && value == expected;
+            ++expected;
+            ring.pop();
+        }
+        producer.join();
+
+        BOOST_CHECK(ordered);
+        BOOST_CHECK_EQUAL(expected, count);
+        BOOST_CHECK_EQUAL(ring.depth(), 0);
+
+        // Stopping the producer which waits for a free slot
+        for (size_t i = 0; i < ring.capacity(); ++i)
+        {
+            BOOST_REQUIRE(ring.acquire(stop) != nullptr);
+            ring.publish();
+        }
+        const uint64_t stalls = ring.stats().producer_stalls;
+        std::thread blocked([&ring, &stop]() { BOOST_CHECK(ring.acquire(stop) == nullptr); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stop = true;
+        ring.wakeup();
+        blocked.join();
+        BOOST_CHECK_EQUAL(ring.stats().producer_stalls, stalls + 1);
+
+        ring.clear();
+        BOOST_CHECK_EQUAL(ring.depth(), 0);
+    }
+
+    void test_PacketReader()
+    {
+        int fds[2];
+        BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+        std::string stream;
+        unsigned char seq = 1;
+        auto add_packet = [&stream, &seq](const std::string& payload)
+        {
+            const size_t len = payload.size();
+            stream += char(len & 0xff);
+            stream += char((len >> 8) & 0xff);
+            stream += char((len >> 16) & 0xff);
+            stream += char(seq++);
+            stream += payload;
+        };
+
+        const std::string small = std::string(1, '\0') + "event";
+        // Larger than reader buffer
+        const std::string large = std::string(1, '\0') + std::string(1000, 'x');
+        // Payload of 0xffffff and more is split into several packets
+        const std::string huge = std::string(1, '\0') + std::string(0xffffff + 10, 'y');
+
+        add_packet(small);
+        add_packet(large);
+        add_packet(huge.substr(0, 0xffffff));
+        add_packet(huge.substr(0xffffff));
+        add_packet(small);
+        add_packet(std::string("\xff\x36\x04#HY000Fatal error", 20));
+
+        std::thread writer([&stream, fd = fds[1]]()
+        {
+            size_t pos = 0;
+            while (pos < stream.size())
+            {
+                const ssize_t n = ::write(fd, stream.data() + pos, std::min<size_t>(stream.size() - pos, 7777));
+                if (n <= 0)
+                    break;
+                pos += n;
+            }
+            ::close(fd);
+        });
+
+        slave::PacketReader reader(64);
+        reader.reset(fds[0], 10);
+
+        const unsigned char* packet = nullptr;
+        BOOST_CHECK_EQUAL(reader.next(packet), small.size());
+        BOOST_CHECK(std::string((const char*)packet, small.size()) == small);
+        BOOST_CHECK_EQUAL(reader.next(packet), large.size());
+        BOOST_CHECK(std::string((const char*)packet, large.size()) == large);
+        BOOST_CHECK_EQUAL(reader.next(packet), huge.size());
+        BOOST_CHECK(std::string((const char*)packet, huge.size()) == huge);
+        BOOST_CHECK_EQUAL(reader.next(packet), small.size());
+        BOOST_CHECK(std::string((const char*)packet, small.size()) == small);
+
+        BOOST_CHECK_EQUAL(reader.next(packet), packet_error);
+        BOOST_CHECK_EQUAL(reader.errorNumber(), 1078);
+        BOOST_CHECK_EQUAL(reader.error(), "Fatal error");
+
+        BOOST_CHECK_EQUAL(reader.next(packet), packet_error);
+        BOOST_CHECK_EQUAL(reader.errorNumber(), 2013);
+
+        writer.join();
+        BOOST_CHECK_EQUAL(reader.bytesRead(), stream.size());
+        ::close(fds[0]);
+
+        // Packets out of order
+        BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        const char wrong_seq[] = { 1, 0, 0, 5, 0 };
+        BOOST_REQUIRE_EQUAL(::write(fds[1], wrong_seq, sizeof(wrong_seq)), sizeof(wrong_seq));
+        reader.reset(fds[0], 10);
+        BOOST_CHECK_EQUAL(reader.next(packet), packet_error);
+        BOOST_CHECK_EQUAL(reader.errorNumber(), 1156);
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    void test_PacketReaderCompressed()
+    {
+        int fds[2];
+        BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+        std::string packets;
+        unsigned char seq = 1;
+        auto add_packet = [&packets, &seq](const std::string& payload)
+        {
+            const size_t len = payload.size();
+            packets += char(len & 0xff);
+            packets += char((len >> 8) & 0xff);
+            packets += char((len >> 16) & 0xff);
+            packets += char(seq++);
+            packets += payload;
+        };
+
+        const std::string first = std::string(1, '\0') + std::string(5000, 'a');
+        const std::string second = std::string(1, '\0') + "small";
+        add_packet(first);
+        add_packet(second);
+
+        // Compressed frame with the first packet and a part of the second one,
+        // then the rest of the second packet as is
+        std::string stream;
+        auto add_frame = [&stream](const std::string& data, bool compress)
+        {
+            std::string payload = data;
+            size_t len = 0;
+            if (compress)
+            {
+                uLongf compressed_len = ::compressBound(data.size());
+                payload.resize(compressed_len);
+                BOOST_REQUIRE_EQUAL(::compress((Bytef*)&payload[0], &compressed_len, (const Bytef*)data.data(), data.size()), Z_OK);
+                payload.resize(compressed_len);
+                len = data.size();
+            }
+            stream += char(payload.size() & 0xff);
+            stream += char((payload.size() >> 8) & 0xff);
+            stream += char((payload.size() >> 16) & 0xff);
+            stream += char(0);
+            stream += char(len & 0xff);
+            stream += char((len >> 8) & 0xff);
+            stream += char((len >> 16) & 0xff);
+            stream += payload;
+        };
+        const size_t split = first.size() + 4 + 3;
+        add_frame(packets.substr(0, split), true);
+        add_frame(packets.substr(split), false);
+
+        BOOST_REQUIRE_EQUAL(::write(fds[1], stream.data(), stream.size()), (ssize_t)stream.size());
+        ::close(fds[1]);
+
+        slave::PacketReader reader(64);
+        reader.reset(fds[0], 10, true);
+
+        const unsigned char* packet = nullptr;
+        BOOST_CHECK_EQUAL(reader.next(packet), first.size());
+        BOOST_CHECK(std::string((const char*)packet, first.size()) == first);
+        BOOST_CHECK_EQUAL(reader.next(packet), second.size());
+        BOOST_CHECK(std::string((const char*)packet, second.size()) == second);
+        BOOST_CHECK_EQUAL(reader.bytesRead(), stream.size());
+        BOOST_CHECK_LT(reader.bytesRead(), packets.size());
+
+        BOOST_CHECK_EQUAL(reader.next(packet), packet_error);
+        BOOST_CHECK_EQUAL(reader.errorNumber(), 2013);
+        ::close(fds[0]);
+    }
+
+    void test_Crc32()
+    {
+        std::mt19937 gen(12345);
+        std::vector<unsigned char> data(5000);
+        for (auto& c : data)
+            c = static_cast<unsigned char>(gen());
+
+        // Different lengths and alignments, short ones go to fallback
+        for (size_t offset : {0, 1, 7})
+        {
+            for (size_t len : {0, 1, 15, 16, 63, 64, 65, 127, 128, 1000, 4096, 4993})
+            {
+                const unsigned char* pos = data.data() + offset;
+                const uint32_t expected = ::crc32(0, pos, len);
+                BOOST_CHECK_EQUAL(slave::checksum_crc32(0, pos, len), expected);
+
+                // By parts, as zlib allows
+                const size_t half = len / 2;
+                const uint32_t first = slave::checksum_crc32(0, pos, half);
+                BOOST_CHECK_EQUAL(slave::checksum_crc32(first, pos + half, len - half), expected);
+            }
+        }
+        const std::string impl = slave::checksum_crc32_impl();
+        BOOST_CHECK(impl == "pclmul" || impl == "zlib");
+
+        // Event with checksum
+        std::string event(LOG_EVENT_HEADER_LEN, '\0');
+        event[EVENT_TYPE_OFFSET] = slave::XID_EVENT;
+        event += std::string(8, '\x01');
+        const uint32_t event_len = event.size() + BINLOG_CHECKSUM_LEN;
+        for (size_t i = 0; i < 4; ++i)
+            event[EVENT_LEN_OFFSET + i] = static_cast<char>(event_len >> (8 * i));
+        const uint32_t crc = ::crc32(0, (const unsigned char*)event.data(), event.size());
+        for (size_t i = 0; i < 4; ++i)
+            event.push_back(static_cast<char>(crc >> (8 * i)));
+
+        slave::enum_binlog_checksum_alg alg = slave::BINLOG_CHECKSUM_ALG_CRC32;
+        BOOST_CHECK(slave::verify_event_checksum(event.data(), event.size(), true, alg));
+        alg = slave::BINLOG_CHECKSUM_ALG_OFF;
+        BOOST_CHECK(!slave::verify_event_checksum(event.data(), event.size(), true, alg));
+        event[LOG_EVENT_HEADER_LEN] = '\x02';
+        alg = slave::BINLOG_CHECKSUM_ALG_CRC32;
+        BOOST_CHECK(!slave::verify_event_checksum(event.data(), event.size(), true, alg));
+    }
+
+    void test_SkipRowEvent()
+    {
+        struct IgnoredStat : public slave::EventStatIface
+        {
+            std::vector<unsigned long> ids;
+            void tickModifyEventIgnored(const unsigned long id, slave::EventKind kind) override { ids.push_back(id); }
+        } stat;
+
+        slave::RelayLogInfo rli;
+        rli.setTableName(0x123456789aUL, "test", "db");
+        rli.setTableName(5, "test2", "db");
+        rli.setTableName(5, "test2", "db");
+        BOOST_CHECK_EQUAL(rli.m_table_ids.size(), 2);
+        BOOST_CHECK(rli.hasTableId(5));
+        BOOST_CHECK(!rli.hasTableId(6));
+        BOOST_CHECK_EQUAL(rli.getTableNameById(5).table_name, "test2");
+        BOOST_CHECK(rli.getTableNameById(6).table_name.empty());
+
+        auto make_event = [](unsigned long table_id)
+        {
+            std::string event(LOG_EVENT_HEADER_LEN, '\0');
+            event[EVENT_TYPE_OFFSET] = slave::WRITE_ROWS_EVENT;
+            for (size_t i = 0; i < 6; ++i)
+                event.push_back(static_cast<char>(table_id >> (8 * i)));
+            event += std::string(6, '\0');
+            return event;
+        };
+
+        for (unsigned long table_id : {0x123456789aUL, 5UL, 7UL})
+        {
+            const std::string event = make_event(table_id);
+            slave::Basic_event_info bei;
+            bei.parse(event.data(), event.size());
+            BOOST_CHECK_EQUAL(slave::skip_row_event(rli, bei, &stat), table_id == 7);
+        }
+        BOOST_REQUIRE_EQUAL(stat.ids.size(), 1);
+        BOOST_CHECK_EQUAL(stat.ids[0], 7);
+
+        rli.clear();
+        BOOST_CHECK(!rli.hasTableId(5));
+    }
+
+    void test_TableIdCache()
+    {
+        slave::TableIdCache cache;
+        BOOST_CHECK(!cache.find(1));
+
+        slave::Table a("db", "a");
+        slave::Table b("db", "b");
+        cache.set(0x123456789aUL, &b, 42, "body");
+        for (unsigned long id = 0; id < 1000; ++id)
+            cache.set(id * 64, id % 2 ? &a : nullptr);
+        BOOST_CHECK_EQUAL(cache.size(), 1001);
+        for (unsigned long id = 0; id < 1000; ++id) {
+            const slave::TableIdCache::Entry* entry = cache.find(id * 64);
+            BOOST_REQUIRE(entry);
+            BOOST_CHECK_EQUAL(entry->table, id % 2 ? &a : nullptr);
+            BOOST_CHECK(!cache.find(id * 64 + 1));
+        }
+        // Map event of the entry is kept on rehash
+        BOOST_CHECK_EQUAL(cache.find(0x123456789aUL)->table, &b);
+        BOOST_CHECK_EQUAL(cache.find(0x123456789aUL)->map_hash, 42);
+        BOOST_CHECK_EQUAL(cache.find(0x123456789aUL)->map_body, "body");
+        cache.set(0x123456789aUL, &a);
+        BOOST_CHECK(cache.find(0x123456789aUL)->map_body.empty());
+        BOOST_CHECK_EQUAL(cache.size(), 1001);
+        BOOST_CHECK_EQUAL(cache.find(0x123456789aUL)->table, &a);
+        cache.clear();
+        BOOST_CHECK(!cache.find(0x123456789aUL));
+
+        slave::RelayLogInfo rli;
+        rli.setTable("a", "db", slave::PtrTable(new slave::Table("db", "a")));
+        slave::Table* const table = rli.getTable({"db", "a"}).get();
+        rli.setTableName(5, "a", "db");
+        rli.setTableName(6, "b", "db");
+        BOOST_CHECK_EQUAL(rli.m_table_cache.size(), 1);
+        BOOST_CHECK_EQUAL(rli.getTableById(5), table);
+        BOOST_CHECK(!rli.getTableById(6));
+        BOOST_CHECK(!rli.getTableById(7));
+        BOOST_CHECK(rli.hasTableId(6));
+
+        // Rebuilt table drops the cached pointers, they are resolved by name again
+        rli.setTable("a", "db", slave::PtrTable(new slave::Table("db", "a")));
+        BOOST_CHECK_EQUAL(rli.m_table_cache.size(), 0);
+        BOOST_CHECK_EQUAL(rli.getTableById(5), rli.getTable({"db", "a"}).get());
+        BOOST_CHECK_EQUAL(rli.m_table_cache.size(), 1);
+
+        // Id of replicated table reused for not replicated one
+        rli.setIgnoredTableId(5);
+        BOOST_CHECK(!rli.hasTableId(5));
+        BOOST_CHECK(!rli.getTableById(5));
+        BOOST_CHECK(rli.getTableNameById(5).table_name.empty());
+        rli.setIgnoredTableId(8);
+        BOOST_CHECK(!rli.hasTableId(8));
+        BOOST_CHECK_EQUAL(rli.m_table_cache.size(), 2);
+        rli.setTableName(8, "a", "db");
+        BOOST_CHECK(rli.hasTableId(8));
+        BOOST_CHECK_EQUAL(rli.getTableById(8), rli.getTable({"db", "a"}).get());
+    }
+
+    void test_TableMapEvent()
+    {
+        auto make_event = [](uint32_t when, unsigned long table_id, char type)
+        {
+            std::string event(LOG_EVENT_HEADER_LEN, '\0');
+            event[EVENT_TYPE_OFFSET] = slave::TABLE_MAP_EVENT;
+            for (size_t i = 0; i < 4; ++i)
+                event[i] = static_cast<char>(when >> (8 * i));
+            for (size_t i = 0; i < 6; ++i)
+                event.push_back(static_cast<char>(table_id >> (8 * i)));
+            event += std::string(2, '\0');
+            event += std::string("\x02" "db" "\0" "\x04" "test" "\0" "\x02" "\x03", 12);
+            event.push_back(type);
+            return event;
+        };
+
+        const std::string event = make_event(1, 5, slave::MYSQL_TYPE_DATETIME2);
+        slave::Table_map_event_info tmi(event.data(), event.size());
+        BOOST_CHECK_EQUAL(tmi.m_table_id, 5);
+        BOOST_CHECK_EQUAL(tmi.m_dbnam, "db");
+        BOOST_CHECK_EQUAL(tmi.m_tblnam, "test");
+        BOOST_REQUIRE_EQUAL(tmi.m_width, 2);
+        BOOST_CHECK_EQUAL(tmi.m_cols_types[0], 3);
+        BOOST_CHECK_EQUAL(tmi.m_cols_types[1], slave::MYSQL_TYPE_DATETIME2);
+        BOOST_CHECK_THROW(slave::Table_map_event_info(event.data(), event.size() - 1), std::runtime_error);
+
+        // Repeated map event differs only in the common header
+        slave::Table_map_event_info repeated;
+        repeated.parse_header(event.data(), event.size());
+        BOOST_CHECK_EQUAL(repeated.m_hash, tmi.m_hash);
+        const std::string later = make_event(2, 5, slave::MYSQL_TYPE_DATETIME2);
+        repeated.parse_header(later.data(), later.size());
+        BOOST_CHECK_EQUAL(repeated.m_hash, tmi.m_hash);
+        const std::string changed = make_event(2, 5, slave::MYSQL_TYPE_DATETIME);
+        repeated.parse_header(changed.data(), changed.size());
+        BOOST_CHECK_NE(repeated.m_hash, tmi.m_hash);
+
+        slave::RelayLogInfo rli;
+        slave::Table* table = nullptr;
+        BOOST_CHECK(!rli.isTableMapProcessed(5, tmi.m_hash, tmi.m_body, table));
+        rli.setTable("test", "db", slave::PtrTable(new slave::Table("db", "test")));
+        rli.setTableName(tmi.m_table_id, tmi.m_tblnam, tmi.m_dbnam, tmi.m_hash, tmi.m_body);
+        BOOST_CHECK(rli.isTableMapProcessed(5, tmi.m_hash, tmi.m_body, table));
+        BOOST_CHECK_EQUAL(table, rli.getTable({"db", "test"}).get());
+        BOOST_CHECK(!rli.isTableMapProcessed(5, repeated.m_hash, repeated.m_body, table));
+        // Bodies are compared when hashes collide
+        BOOST_CHECK(!rli.isTableMapProcessed(5, tmi.m_hash, repeated.m_body, table));
+        BOOST_CHECK(!rli.isTableMapProcessed(5, tmi.m_hash, tmi.m_body.substr(1), table));
+
+        // Resolved row event does not make the map event known again after a rebuild
+        rli.setTable("test", "db", slave::PtrTable(new slave::Table("db", "test")));
+        BOOST_CHECK(rli.getTableById(5));
+        BOOST_CHECK(!rli.isTableMapProcessed(5, tmi.m_hash, tmi.m_body, table));
+
+        rli.setIgnoredTableId(6, tmi.m_hash, tmi.m_body);
+        table = rli.getTable({"db", "test"}).get();
+        BOOST_CHECK(rli.isTableMapProcessed(6, tmi.m_hash, tmi.m_body, table));
+        BOOST_CHECK(!table);
+    }
+
+    void test_QueryClassifier()
+    {
+        using slave::QueryKind;
+
+        slave::QueryClassifier classifier;
+        std::vector<slave::TableKey> tables;
+        auto classify = [&](const std::string& query)
+        {
+            tables.clear();
+            const QueryKind kind = classifier.classify(query, "db", tables);
+            std::string result;
+            for (const auto& key : tables)
+                result += (result.empty() ? "" : " ") + key.db_name + "." + key.table_name;
+            return std::make_pair(kind, result);
+        };
+
+        // Names are not extracted without subscriptions
+        BOOST_CHECK(classify("ALTER TABLE test ADD x INT") == std::make_pair(QueryKind::AlterTable, std::string()));
+
+        classifier.addDatabase("db");
+        classifier.addDatabase("other");
+        classifier.addDatabase("db");
+        BOOST_CHECK(classifier.hasDatabase("other"));
+        BOOST_CHECK(!classifier.hasDatabase("test"));
+
+        const std::vector<std::tuple<std::string, QueryKind, std::string>> cases = {
+            {"BEGIN",                                                           QueryKind::Begin,       ""},
+            {"  commit",                                                        QueryKind::Commit,      ""},
+            {"BEGINNING",                                                       QueryKind::Other,       ""},
+            {"INSERT INTO log VALUES ('alter table test add x int')",           QueryKind::Other,       ""},
+            {"alter table test add column x int",                               QueryKind::AlterTable,  "db.test"},
+            {"ALTER TABLE `other`.`test` ADD x INT",                            QueryKind::AlterTable,  "other.test"},
+            {"ALTER IGNORE TABLE other . test ADD x INT",                       QueryKind::AlterTable,  "other.test"},
+            {"ALTER TABLE test3.test ADD x INT",                                QueryKind::AlterTable,  ""},
+            {"/* comment */ ALTER /* TABLE x */\nTABLE -- line\n test # x\n ADD x INT", QueryKind::AlterTable, "db.test"},
+            {"ALTER TABLE test RENAME TO test2",                                QueryKind::AlterTable,  "db.test2"},
+            {"ALTER TABLE test ADD x INT, RENAME AS other.`test 2`",            QueryKind::AlterTable,  "other.test 2"},
+            {"/**/ ALTER /* x\n */ TABLE test_temp RENAME /**/ test",           QueryKind::AlterTable,  "db.test"},
+            {"ALTER TABLE test RENAME COLUMN a TO b",                           QueryKind::AlterTable,  "db.test"},
+            {"ALTER TABLE test ADD x INT COMMENT 'rename to test2'",            QueryKind::AlterTable,  "db.test"},
+            {"ALTER TABLE `te``st` ADD x INT",                                  QueryKind::AlterTable,  "db.te`st"},
+            {"CREATE TABLE test (x INT)",                                       QueryKind::CreateTable, "db.test"},
+            {"CREATE TABLE IF NOT EXISTS `db`.`test`(x INT)",                   QueryKind::CreateTable, "db.test"},
+            {"CREATE TABLE /*!32312 IF NOT EXISTS*/ test LIKE test2",           QueryKind::CreateTable, "db.test"},
+            {"CREATE OR REPLACE TABLE test (x INT)",                            QueryKind::CreateTable, "db.test"},
+            {"CREATE TEMPORARY TABLE test (x INT)",                             QueryKind::Other,       ""},
+            {"CREATE VIEW test AS SELECT 1",                                    QueryKind::Other,       ""},
+            {"RENAME TABLE test TO test2, other.a TO other.b, c TO test3.d",    QueryKind::RenameTable, "db.test2 other.b"},
+            {"DROP TABLE IF EXISTS `test`,other.test2 /* generated by server */", QueryKind::DropTable, "db.test other.test2"},
+            {"DROP TEMPORARY TABLE test",                                       QueryKind::Other,       ""},
+            {"DROP DATABASE db",                                                QueryKind::Other,       ""},
+            {"TRUNCATE TABLE test",                                             QueryKind::Other,       ""},
+        };
+        for (const auto& x : cases)
+        {
+            const auto result = classify(std::get<0>(x));
+            BOOST_CHECK_MESSAGE(result.first == std::get<1>(x) && result.second == std::get<2>(x),
+                                std::get<0>(x) << ": " << static_cast<int>(result.first) << " " << result.second);
+        }
+
+        tables.clear();
+        BOOST_CHECK(classifier.classify("ALTER TABLE test ADD x INT", "test3", tables) == QueryKind::AlterTable);
+        BOOST_CHECK(tables.empty());
+    }
+
+    void test_TableMapSchema()
+    {
+        // Event of MySQL 8.0 with binlog_row_metadata=FULL
+        auto make_event = [](const std::string& varchar_meta, const std::string& names)
+        {
+            std::string event(LOG_EVENT_HEADER_LEN, '\0');
+            event[EVENT_TYPE_OFFSET] = slave::TABLE_MAP_EVENT;
+            event += std::string("\x05\0\0\0\0\0" "\0\0", 8);
+            event += std::string("\x02" "db" "\0" "\x04" "test" "\0", 10);
+            event.push_back(6);
+            event.push_back(3);
+            event.push_back(slave::MYSQL_TYPE_VARCHAR);
+            event.push_back(slave::MYSQL_TYPE_NEWDECIMAL);
+            event.push_back(slave::MYSQL_TYPE_DATETIME2);
+            event.push_back(slave::MYSQL_TYPE_STRING);
+            event.push_back(slave::MYSQL_TYPE_BLOB);
+            event.push_back(8);
+            event += varchar_meta;
+            event += std::string("\x0a\x02" "\x03" "\xf7\x01" "\x02", 6);
+            // Null bits
+            event.push_back('\x3e');
+            if (!names.empty())
+            {
+                event.push_back(4);
+                event.push_back(names.size());
+                event += names;
+            }
+            event += std::string("\x08\x01\x00", 3);
+            return event;
+        };
+        const std::string names("\x02" "id" "\x04" "name" "\x05" "price" "\x07" "created" "\x05" "state" "\x04" "body", 33);
+
+        const std::string event = make_event(std::string("\x96\x00", 2), names);
+        slave::Table_map_event_info tmi(event.data(), event.size());
+        slave::TableMapSchema schema;
+        schema.parse(tmi);
+
+        BOOST_REQUIRE_EQUAL(schema.columns().size(), 6);
+        BOOST_CHECK_EQUAL(schema.type(0), "int");
+        BOOST_CHECK_EQUAL(schema.type(1), "varchar(150)");
+        BOOST_CHECK_EQUAL(schema.type(2), "decimal(10,2)");
+        BOOST_CHECK_EQUAL(schema.type(3), "datetime(3)");
+        BOOST_CHECK_EQUAL(schema.type(4), "enum");
+        BOOST_CHECK_EQUAL(schema.type(5), "blob");
+        BOOST_REQUIRE_EQUAL(schema.names().size(), 6);
+        BOOST_CHECK_EQUAL(schema.names()[0], "id");
+        BOOST_CHECK_EQUAL(schema.names()[5], "body");
+        BOOST_CHECK(schema.has_primary_key());
+        BOOST_CHECK(schema.primary_key() == std::vector<unsigned>{0});
+
+        // Fields skip packed values as fields read from master do
+        const std::vector<std::pair<std::string, size_t>> packed = {
+            {"\x01\x02\x03\x04", 4}, {"\x03" "abc", 4}, {std::string(5, '\x80'), 5},
+            {std::string(7, '\x80'), 7}, {"\x01", 1}, {std::string("\x03\x00" "abc", 5), 5}};
+        for (size_t i = 0; i < packed.size(); ++i)
+        {
+            const slave::PtrField field = schema.create_field(i, schema.names()[i]);
+            BOOST_CHECK_EQUAL(field->field_name, schema.names()[i]);
+            const char* from = packed[i].first.data();
+            BOOST_CHECK_MESSAGE(field->skip(from) == from + packed[i].second, schema.type(i));
+        }
+
+        // Names do not change the hash, metadata does
+        const size_t hash = schema.hash();
+        const std::string unnamed = make_event(std::string("\x96\x00", 2), "");
+        schema.parse(slave::Table_map_event_info(unnamed.data(), unnamed.size()));
+        BOOST_CHECK_EQUAL(schema.hash(), hash);
+        BOOST_CHECK(schema.names().empty());
+        const std::string longer = make_event(std::string("\x2c\x01", 2), "");
+        schema.parse(slave::Table_map_event_info(longer.data(), longer.size()));
+        BOOST_CHECK_NE(schema.hash(), hash);
+        BOOST_CHECK_EQUAL(schema.type(1), "varchar(300)");
+
+        // Names not of every column are ignored
+        const std::string partial = make_event(std::string("\x96\x00", 2), std::string("\x02" "id", 3));
+        schema.parse(slave::Table_map_event_info(partial.data(), partial.size()));
+        BOOST_CHECK(schema.names().empty());
+
+        const slave::Table_map_event_info broken(event.data(), LOG_EVENT_HEADER_LEN + 8 + 10 + 7 + 4);
+        BOOST_CHECK_THROW(schema.parse(broken), std::runtime_error);
+
+        // JSON and GEOMETRY are values of the pack length in metadata, as blobs
+        std::string blobs(LOG_EVENT_HEADER_LEN, '\0');
+        blobs[EVENT_TYPE_OFFSET] = slave::TABLE_MAP_EVENT;
+        blobs += std::string("\x05\0\0\0\0\0" "\0\0", 8);
+        blobs += std::string("\x02" "db" "\0" "\x04" "test" "\0", 10);
+        blobs.push_back(2);
+        blobs.push_back(slave::MYSQL_TYPE_JSON);
+        blobs.push_back(slave::MYSQL_TYPE_GEOMETRY);
+        blobs += std::string("\x02" "\x04" "\x02", 3);
+        blobs.push_back('\x03');
+        schema.parse(slave::Table_map_event_info(blobs.data(), blobs.size()));
+
+        BOOST_REQUIRE_EQUAL(schema.columns().size(), 2);
+        BOOST_CHECK_EQUAL(schema.type(0), "json");
+        BOOST_CHECK_EQUAL(schema.type(1), "geometry");
+        const std::string json("\x02\x00\x00\x00" "{}", 6);
+        const slave::PtrField field = schema.create_field(0, "doc");
+        BOOST_CHECK(field->skip(json.data()) == json.data() + json.size());
+        slave::FieldValue value;
+        field->unpack(json.data(), value);
+        BOOST_CHECK_EQUAL(slave::get<std::string>(value), "{}");
+        const std::string shape("\x03\x00" "abc", 5);
+        BOOST_CHECK(schema.create_field(1, "shape")->skip(shape.data()) == shape.data() + shape.size());
+    }
+
+    void test_ParallelApply()
+    {
+        const unsigned keys = 16;
+        std::mutex mutex;
+        std::vector<std::vector<time_t>> delivered(keys);
+        std::set<std::thread::id> threads;
+
+        slave::Table table("db", "test");
+        table.m_callback = [&](slave::RecordSet& rs)
+        {
+            if (rs.when < 0)
+                throw std::runtime_error("callback failed");
+            std::lock_guard<std::mutex> l(mutex);
+            delivered[std::stoul(rs.tbl_name)].push_back(rs.when);
+            threads.insert(std::this_thread::get_id());
+        };
+
+        slave::ParallelApply apply(4, 8);
+        BOOST_CHECK_EQUAL(apply.threads(), 4);
+
+        const time_t rows = 10000;
+        for (time_t i = 0; i < rows; ++i)
+        {
+            slave::RecordSet rs;
+            const unsigned key = i % keys;
+            rs.tbl_name = std::to_string(key);
+            rs.when = i;
+            apply.push(key, table, std::move(rs));
+        }
+        apply.wait();
+
+        size_t total = 0;
+        bool ordered = true;
+        for (const auto& x : delivered)
+        {
+            total += x.size();
+            ordered = ordered && std::is_sorted(x.begin(), x.end());
+        }
+        BOOST_CHECK_EQUAL(total, rows);
+        BOOST_CHECK(ordered);
+        BOOST_CHECK_EQUAL(threads.size(), 4);
+
+        // Exception of callback is thrown by wait() once
+        slave::RecordSet rs;
+        rs.when = -1;
+        apply.push(0, table, std::move(rs));
+        BOOST_CHECK_THROW(apply.wait(), std::runtime_error);
+        BOOST_CHECK_NO_THROW(apply.wait());
+    }
+
+    // Table (id int, value int) with table id 5, the value may be NULL
+    slave::PtrTable makeIntTable(slave::RelayLogInfo& rli)
+    {
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_long("value", "int(11)"));
+        table->m_filter = slave::eAll;
+        table->row_type = slave::RowType::Vector;
+        rli.setTableName(5, "test", "db");
+        return table;
+    }
+
+    // Little-endian integer of 'bytes' bytes
+    std::string packInt(uint64_t x, size_t bytes)
+    {
+        std::string result;
+        for (size_t i = 0; i < bytes; ++i)
+            result.push_back(static_cast<char>(x >> (8 * i)));
+        return result;
+    }
+
+    // Rows event (version 1) of the table with id 5, 'cols_ai' is used only for update
+    std::string makeRowsEvent(slave::Log_event_type type, unsigned char width, unsigned char cols,
+                              unsigned char cols_ai, const std::string& rows)
+    {
+        std::string event(LOG_EVENT_HEADER_LEN, '\0');
+        event[EVENT_TYPE_OFFSET] = type;
+        event[0] = 100; // timestamp
+        event += packInt(5, 6); // table id
+        event += std::string(2, '\0'); // flags
+        event += static_cast<char>(width);
+        event += static_cast<char>(cols);
+        if (type == slave::UPDATE_ROWS_EVENT_V1)
+            event += static_cast<char>(cols_ai);
+        return event + rows;
+    }
+
+    // WRITE_ROWS_EVENT_V1 of the table from makeIntTable(), value < 0 means NULL
+    std::string makeIntRowsEvent(const std::vector<std::pair<uint32_t, int64_t>>& rows)
+    {
+        std::string body;
+        for (const auto& row : rows)
+        {
+            body += row.second < 0 ? '\x02' : '\0';
+            body += packInt(row.first, 4);
+            if (row.second >= 0)
+                body += packInt(row.second, 4);
+        }
+        return makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 2, 0x03, 0, body);
+    }
+
+    // Applies the rows event to the tables of rli as Slave::process_event() does
+    void applyRowsEvent(slave::RelayLogInfo& rli, const std::string& event, slave::EventStatIface* stat = nullptr,
+                        slave::ParallelDecode* decode = nullptr)
+    {
+        slave::Basic_event_info bei;
+        bei.parse(event.data(), event.size());
+        slave::Row_event_info roi(bei.buf, bei.event_len, bei.type == slave::UPDATE_ROWS_EVENT_V1, false);
+        slave::EmptyExtState ext_state;
+        slave::apply_row_event(rli, bei, roi, ext_state, stat, nullptr, nullptr, decode);
+    }
+
+    void test_ParallelKeyUpdate()
+    {
+        slave::RelayLogInfo rli;
+        slave::PtrTable table = makeIntTable(rli);
+        table->primary_key = {0};
+
+        std::mutex mutex;
+        std::vector<std::pair<uint32_t, uint32_t>> delivered;
+        table->m_callback = [&](slave::RecordSet& rs)
+        {
+            const uint32_t old_id = slave::get<uint32_t>(rs.m_old_row_vec.at(0).second);
+            const uint32_t id = slave::get<uint32_t>(rs.m_row_vec.at(0).second);
+            // Update of the key is slow, so the next update of the new key would overtake it
+            if (old_id != id)
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::lock_guard<std::mutex> l(mutex);
+            delivered.emplace_back(old_id, id);
+        };
+        rli.setTable("test", "db", std::move(table));
+
+        slave::ParallelApply parallel(4, 8);
+        slave::EmptyExtState ext_state;
+        auto update = [&](uint32_t old_id, uint32_t id, uint32_t value)
+        {
+            const std::string event = makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 2, 0x03, 0x03,
+                                                    std::string(1, '\0') + packInt(old_id, 4) + packInt(value, 4)
+                                                    + std::string(1, '\0') + packInt(id, 4) + packInt(value + 1, 4));
+            slave::Basic_event_info bei;
+            bei.parse(event.data(), event.size());
+            slave::Row_event_info roi(bei.buf, bei.event_len, true, false);
+            slave::apply_row_event(rli, bei, roi, ext_state, nullptr, &parallel);
+        };
+
+        // Keys of some of the pairs are of different workers
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            delivered.clear();
+            update(100 + i, 200 + i, 1);
+            update(200 + i, 200 + i, 2);
+            parallel.wait();
+            const std::vector<std::pair<uint32_t, uint32_t>> expected = {{100 + i, 200 + i}, {200 + i, 200 + i}};
+            BOOST_CHECK_MESSAGE(delivered == expected, "update of key " << 100 + i);
+        }
+    }
+
+    void test_BatchCallback()
+    {
+        struct RowsStat : public slave::EventStatIface
+        {
+            unsigned long rows = 0;
+            unsigned long events = 0;
+            void tickModifyRowDone(const unsigned long id, slave::EventKind kind, uint64_t time) override { ++rows; }
+            void tickModifyEventDone(const unsigned long id, slave::EventKind kind) override { ++events; }
+        } stat;
+
+        slave::RelayLogInfo rli;
+        slave::PtrTable table = makeIntTable(rli);
+
+        size_t calls = 0;
+        std::vector<slave::RecordSet>* batch = nullptr;
+        std::vector<uint32_t> ids;
+        std::vector<bool> nulls;
+        table->m_batch_callback = [&](std::vector<slave::RecordSet>& rows)
+        {
+            ++calls;
+            batch = &rows;
+            ids.clear();
+            nulls.clear();
+            for (const auto& rs : rows)
+            {
+                BOOST_CHECK_EQUAL(rs.type_event, slave::RecordSet::Write);
+                BOOST_CHECK_EQUAL(rs.when, 100);
+                BOOST_REQUIRE_EQUAL(rs.m_row_vec.size(), 2);
+                ids.push_back(slave::get<uint32_t>(rs.m_row_vec[0].second));
+                nulls.push_back(slave::isNullFieldValue(rs.m_row_vec[1].second));
+            }
+        };
+        rli.setTable("test", "db", std::move(table));
+
+        applyRowsEvent(rli, makeIntRowsEvent({{1, 10}, {2, -1}, {3, 30}}), &stat);
+        BOOST_CHECK_EQUAL(calls, 1);
+        BOOST_CHECK(ids == std::vector<uint32_t>({1, 2, 3}));
+        BOOST_CHECK(nulls == std::vector<bool>({false, true, false}));
+        BOOST_CHECK_EQUAL(stat.rows, 3);
+        BOOST_CHECK_EQUAL(stat.events, 1);
+
+        // Storage of the previous event is reused
+        const auto* const first = batch->data();
+        applyRowsEvent(rli, makeIntRowsEvent({{4, 40}, {5, 50}}), &stat);
+        BOOST_CHECK_EQUAL(calls, 2);
+        BOOST_CHECK(ids == std::vector<uint32_t>({4, 5}));
+        BOOST_CHECK_EQUAL(batch->data(), first);
+        BOOST_CHECK_EQUAL(stat.rows, 5);
+        BOOST_CHECK_EQUAL(stat.events, 2);
+    }
+
+    void test_RowView()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::collate_info collate;
+        collate.maxlen = 3;
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_varstring("name", "varchar(100)", collate));
+        table->fields.emplace_back(new slave::Field_blob("data", "blob"));
+        table->m_filter = slave::eAll;
+
+        std::vector<std::string> names;
+        std::vector<slave::RecordSet::TypeEvent> types;
+        table->m_view_callback = [&](const slave::RecordView& rv)
+        {
+            types.push_back(rv.type_event);
+            BOOST_CHECK_EQUAL(rv.tbl_name, "test");
+            BOOST_CHECK_EQUAL(rv.m_row.size(), 3);
+            BOOST_CHECK_EQUAL(rv.m_row.index("data"), 2);
+            BOOST_CHECK_EQUAL(rv.m_row.index("nothing"), -1);
+            BOOST_CHECK(rv.m_row.has(1));
+            names.push_back(std::string(rv.m_row.str(1)));
+            BOOST_CHECK_THROW(rv.m_row.str(0), std::runtime_error);
+
+            if (rv.type_event == slave::RecordSet::Write)
+            {
+                BOOST_CHECK_EQUAL(slave::get<uint32_t>(rv.m_row.value(0)), 7);
+                BOOST_CHECK(rv.m_row.isNull(2));
+                BOOST_CHECK(slave::isNullFieldValue(rv.m_row.value(2)));
+                BOOST_CHECK(rv.m_row.str(2).empty());
+                // There is no image before update
+                BOOST_CHECK_EQUAL(rv.m_old_row.size(), 0);
+                BOOST_CHECK_EQUAL(rv.m_old_row.index("id"), -1);
+                BOOST_CHECK_THROW(rv.m_old_row.value(0), std::runtime_error);
+                BOOST_CHECK_THROW(rv.m_old_row.str(1), std::runtime_error);
+            }
+            else
+            {
+                // Minimal after image: only changed columns
+                BOOST_CHECK(!rv.m_row.has(0));
+                BOOST_CHECK_THROW(rv.m_row.value(0), std::runtime_error);
+                BOOST_CHECK_EQUAL(rv.m_row.str(2), "blob");
+                BOOST_CHECK_EQUAL(slave::get<uint32_t>(rv.m_old_row.value(0)), 7);
+                BOOST_CHECK_EQUAL(rv.m_old_row.str(1), "first");
+                BOOST_CHECK_EQUAL(slave::get<std::string>(rv.m_old_row.value(1)), "first");
+            }
+        };
+        rli.setTable("test", "db", std::move(table));
+
+        // varchar(100) of 3-byte charset has 2 bytes of length
+        applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0,
+                                          std::string("\x04", 1) + packInt(7, 4) + packInt(5, 2) + "first"));
+        applyRowsEvent(rli, makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 3, 0x07, 0x06,
+                                          std::string("\x04", 1) + packInt(7, 4) + packInt(5, 2) + "first"
+                                          + std::string("\0", 1) + packInt(6, 2) + "second" + packInt(4, 2) + "blob"));
+
+        BOOST_CHECK(names == std::vector<std::string>({"first", "second"}));
+        BOOST_CHECK(types == std::vector<slave::RecordSet::TypeEvent>({slave::RecordSet::Write, slave::RecordSet::Update}));
+    }
+
+    void test_ColumnarBatch()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::collate_info collate;
+        collate.maxlen = 1;
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_double("price", "double"));
+        table->fields.emplace_back(new slave::Field_varstring("name", "varchar(100)", collate));
+        table->m_filter = slave::eAll;
+
+        size_t calls = 0;
+        table->m_columnar_callback = [&](slave::ColumnarBatch& batch)
+        {
+            ++calls;
+            BOOST_CHECK_EQUAL(batch.tbl_name, "test");
+            BOOST_REQUIRE_EQUAL(batch.columns.size(), 3);
+            BOOST_REQUIRE_EQUAL(batch.rows, 3);
+
+            const auto& ids = batch.columns[0];
+            BOOST_CHECK_EQUAL(ids.name, "id");
+            BOOST_CHECK(ids.type == slave::ColumnType::Integer);
+            BOOST_CHECK(ids.ints == std::vector<int64_t>({1, 2, 3}));
+            BOOST_CHECK(ids.valid(0) && ids.valid(1) && ids.valid(2));
+
+            const auto& prices = batch.columns[1];
+            BOOST_CHECK(prices.type == slave::ColumnType::Real);
+            BOOST_CHECK(prices.reals == std::vector<double>({1.5, 0, 3.5}));
+            BOOST_CHECK(prices.valid(0) && !prices.valid(1) && prices.valid(2));
+
+            const auto& names = batch.columns[2];
+            BOOST_CHECK(names.type == slave::ColumnType::String);
+            BOOST_CHECK_EQUAL(names.str(0), "one");
+            BOOST_CHECK_EQUAL(names.str(1), "two");
+            BOOST_CHECK(!names.valid(2));
+            BOOST_CHECK(names.str(2).empty());
+        };
+        rli.setTable("test", "db", std::move(table));
+
+        auto row = [](uint32_t id, double price, const char* name)
+        {
+            std::string result(1, static_cast<char>((price < 0 ? 2 : 0) | (name ? 0 : 4)));
+            result += packInt(id, 4);
+            if (price >= 0)
+                result += std::string(reinterpret_cast<const char*>(&price), sizeof(price));
+            if (name)
+                result += static_cast<char>(::strlen(name)) + std::string(name);
+            return result;
+        };
+        const std::string rows = row(1, 1.5, "one") + row(2, -1, "two") + row(3, 3.5, nullptr);
+
+        // Storage is reused, so the second event gives the same columns
+        applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0, rows));
+        applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0, rows));
+        BOOST_CHECK_EQUAL(calls, 2);
+
+        // Column filter selects and orders the columns
+        auto& filtered = rli.m_table_map.begin()->second;
+        filtered->set_column_filter({"name", "id"});
+        filtered->m_columnar_callback = [&](slave::ColumnarBatch& batch)
+        {
+            ++calls;
+            BOOST_CHECK(batch.type_event == slave::RecordSet::Update);
+            BOOST_REQUIRE_EQUAL(batch.columns.size(), 2);
+            BOOST_REQUIRE_EQUAL(batch.old_columns.size(), 2);
+            BOOST_CHECK_EQUAL(batch.old_columns[0].str(0), "one");
+            BOOST_CHECK_EQUAL(batch.columns[0].str(0), "two");
+            BOOST_CHECK(batch.old_columns[1].ints == std::vector<int64_t>({1}));
+            BOOST_CHECK(batch.columns[1].ints == std::vector<int64_t>({1}));
+        };
+        applyRowsEvent(rli, makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 3, 0x07, 0x07, row(1, 1.5, "one") + row(1, 1.5, "two")));
+        BOOST_CHECK_EQUAL(calls, 3);
+    }
+
+    void test_ColumnarFixedWidth()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_tiny("tiny", "tinyint(4)"));
+        table->fields.emplace_back(new slave::Field_long("long", "int(11)"));
+        table->fields.emplace_back(new slave::Field_longlong("longlong", "bigint(20)"));
+        table->fields.emplace_back(new slave::Field_double("double", "double"));
+        table->fields.emplace_back(new slave::Field_timestamp("timestamp2", "timestamp", false));
+        table->fields.emplace_back(new slave::Field_datetime("datetime2", "datetime", false));
+        table->fields.emplace_back(new slave::Field_time("time", "time", true));
+        table->fields.emplace_back(new slave::Field_decimal("decimal", "decimal(10,2)"));
+        table->m_filter = slave::eAll;
+        table->build_plan();
+        BOOST_CHECK_EQUAL(table->plan.fixed_width(), 38);
+
+        std::vector<slave::ColumnarBatch> batches;
+        table->m_columnar_callback = [&](slave::ColumnarBatch& batch) { batches.push_back(batch); };
+        slave::Table* const plain = table.get();
+        rli.setTable("test", "db", std::move(table));
+
+        auto row = [](unsigned i)
+        {
+            const double d = 2.25 * i;
+            return std::string(1, '\0') + static_cast<char>(0xfe + i) + packInt(100 + i, 4)
+                + packInt(0x0123456789abcdefULL + i, 8) + std::string(reinterpret_cast<const char*>(&d), sizeof(d))
+                + std::string("\x53\x72\x6f", 3) + static_cast<char>(i)
+                + std::string("\x99\x8f\x25\x20", 4) + static_cast<char>(i)
+                + packInt(0xfedcba - i, 3) + std::string("\x80\x00\x00\x7b", 4) + static_cast<char>(i);
+        };
+        std::string rows;
+        for (unsigned i = 0; i < 70; ++i)
+            rows += row(i);
+        const std::string write = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 8, 0xff, 0, rows);
+        const std::string update = makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 8, 0xff, 0xff, row(1) + row(2) + row(3) + row(4));
+        // NULL in tiny of the second row
+        const std::string with_null = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 8, 0xff, 0,
+                                                    row(1) + "\x01" + row(2).substr(2) + row(3));
+
+        // Rows of the same size are gathered by columns
+        slave::Basic_event_info bei;
+        bei.parse(write.data(), write.size());
+        slave::Row_event_info roi(bei.buf, bei.event_len, false, false);
+        slave::ColumnarBatch batch;
+        batch.reset(*plain, slave::RecordSet::Write);
+        BOOST_CHECK(batch.append_fixed(*plain, roi));
+        BOOST_CHECK_EQUAL(batch.rows, 70);
+        bei.parse(with_null.data(), with_null.size());
+        roi.parse(bei.buf, bei.event_len, false, false);
+        batch.reset(*plain, slave::RecordSet::Write);
+        BOOST_CHECK(!batch.append_fixed(*plain, roi));
+        BOOST_CHECK_EQUAL(batch.rows, 0);
+
+        // Decoded by the plan, then by Field::unpack_int() and others
+        for (int i = 0; i < 2; ++i)
+        {
+            applyRowsEvent(rli, write);
+            applyRowsEvent(rli, update);
+            applyRowsEvent(rli, with_null);
+            plain->plan.clear();
+        }
+
+        BOOST_REQUIRE_EQUAL(batches.size(), 6);
+        BOOST_CHECK_EQUAL(batches[0].columns[0].ints[3], 1);
+        BOOST_CHECK_EQUAL(batches[0].columns[4].ints[0], 0x53726f00);
+        BOOST_CHECK_EQUAL(batches[0].columns[5].ints[0], 20130318180000ULL);
+        BOOST_CHECK_EQUAL(batches[1].old_columns[1].ints[1], 103);
+        BOOST_CHECK_EQUAL(batches[1].columns[1].ints[1], 104);
+        BOOST_CHECK(!batches[2].columns[0].valid(1));
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const slave::ColumnarBatch& fixed = batches[i];
+            const slave::ColumnarBatch& plain = batches[i + 3];
+            BOOST_CHECK_EQUAL(fixed.rows, plain.rows);
+            BOOST_REQUIRE_EQUAL(fixed.columns.size(), plain.columns.size());
+            BOOST_REQUIRE_EQUAL(fixed.old_columns.size(), plain.old_columns.size());
+            auto same = [](const slave::Column& l, const slave::Column& r)
+            {
+                return l.ints == r.ints && l.reals == r.reals && l.decimals == r.decimals && l.validity == r.validity;
+            };
+            for (size_t j = 0; j < fixed.columns.size(); ++j)
+                BOOST_CHECK_MESSAGE(same(fixed.columns[j], plain.columns[j]), "batch " << i << ", column " << j);
+            for (size_t j = 0; j < fixed.old_columns.size(); ++j)
+                BOOST_CHECK_MESSAGE(same(fixed.old_columns[j], plain.old_columns[j]), "batch " << i << ", old column " << j);
+        }
+    }
+
+    struct BoundRow
+    {
+        int32_t id = 0;
+        std::optional<double> price;
+        std::string name;
+        int unbound = 42;
+    };
+
+    void test_TypedBinding()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::collate_info collate;
+        collate.maxlen = 1;
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_double("price", "double"));
+        table->fields.emplace_back(new slave::Field_varstring("name", "varchar(100)", collate));
+        table->m_filter = slave::eAll;
+
+        // Type mismatch and absent column are found on resolving
+        auto noop = [](slave::TypedRecordSet<BoundRow>&) {};
+        BOOST_CHECK_THROW(slave::make_binding<BoundRow>(noop, &BoundRow::name, "id")->resolve(*table), std::runtime_error);
+        BOOST_CHECK_THROW(slave::make_binding<BoundRow>(noop, &BoundRow::id, "nothing")->resolve(*table), std::runtime_error);
+
+        slave::Slave slave;
+        slave.bind<BoundRow>("db", "test", noop, &BoundRow::id, "id", &BoundRow::name, std::string("name"));
+        BOOST_CHECK_EQUAL(slave.getTableOrder().count({"db", "test"}), 1);
+
+        std::vector<BoundRow> rows;
+        std::vector<slave::RecordSet::TypeEvent> types;
+        table->m_binding = slave::make_binding<BoundRow>(
+            [&](slave::TypedRecordSet<BoundRow>& rs)
+            {
+                types.push_back(rs.type_event);
+                if (rs.type_event == slave::RecordSet::Update)
+                    rows.push_back(rs.m_old_row);
+                rows.push_back(rs.m_row);
+            },
+            &BoundRow::name, "name", &BoundRow::id, "id", &BoundRow::price, "price");
+        table->m_binding->resolve(*table);
+        rli.setTable("test", "db", std::move(table));
+
+        auto row = [](uint32_t id, double price, const char* name)
+        {
+            std::string result(1, static_cast<char>(price < 0 ? 2 : 0));
+            result += packInt(id, 4);
+            if (price >= 0)
+                result += std::string(reinterpret_cast<const char*>(&price), sizeof(price));
+            result += static_cast<char>(::strlen(name)) + std::string(name);
+            return result;
+        };
+
+        applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0, row(1, 1.5, "one") + row(2, -1, "two")));
+        // Minimal after image without price
+        applyRowsEvent(rli, makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 3, 0x07, 0x05,
+                                          row(1, 1.5, "one") + std::string(1, '\0') + packInt(1, 4) + "\x05three"));
+
+        BOOST_REQUIRE_EQUAL(rows.size(), 4);
+        BOOST_CHECK_EQUAL(rows[0].id, 1);
+        BOOST_CHECK(rows[0].price == 1.5);
+        BOOST_CHECK_EQUAL(rows[0].name, "one");
+        BOOST_CHECK_EQUAL(rows[0].unbound, 42);
+        BOOST_CHECK_EQUAL(rows[1].id, 2);
+        BOOST_CHECK(!rows[1].price);
+        BOOST_CHECK_EQUAL(rows[1].name, "two");
+        BOOST_CHECK_EQUAL(rows[2].name, "one");
+        BOOST_CHECK(rows[2].price == 1.5);
+        BOOST_CHECK_EQUAL(rows[3].id, 1);
+        BOOST_CHECK(!rows[3].price);
+        BOOST_CHECK_EQUAL(rows[3].name, "three");
+        BOOST_CHECK(types == std::vector<slave::RecordSet::TypeEvent>({slave::RecordSet::Write, slave::RecordSet::Write, slave::RecordSet::Update}));
+    }
+
+    struct IntRow
+    {
+        int16_t small = 0;
+        uint16_t usmall = 0;
+        int32_t medium = 0;
+        uint32_t uint = 0;
+        int64_t wide = 0;
+        std::optional<int64_t> optional;
+        bool flag = false;
+        float ratio = 0;
+    };
+
+    void test_TypedBindingTypes()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_short("count", "smallint(5) unsigned"));
+        table->fields.emplace_back(new slave::Field_medium("delta", "mediumint(9)"));
+        table->fields.emplace_back(new slave::Field_tiny("flag", "tinyint(1)"));
+        table->fields.emplace_back(new slave::Field_tiny("level", "tinyint(3) unsigned"));
+        table->fields.emplace_back(new slave::Field_year("born", "year(4)"));
+        table->fields.emplace_back(new slave::Field_double("price", "double"));
+        table->m_filter = slave::eAll;
+
+        // Members which do not hold every value of the column and columns bound twice are rejected
+        auto noop = [](slave::TypedRecordSet<IntRow>&) {};
+        auto resolve = [&](auto binding) { binding->resolve(*table); };
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::small, "id")), std::runtime_error);
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::uint, "id")), std::runtime_error);
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::small, "count")), std::runtime_error);
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::uint, "delta")), std::runtime_error);
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::flag, "id")), std::runtime_error);
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::medium, "id", &IntRow::wide, "id")), std::runtime_error);
+        BOOST_CHECK_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::ratio, "price")), std::runtime_error);
+        BOOST_CHECK_NO_THROW(resolve(slave::make_binding<IntRow>(noop, &IntRow::usmall, "count", &IntRow::medium, "delta",
+                                                                 &IntRow::flag, "flag")));
+
+        // Values are extended to wider members with sign for signed columns, with zeros for unsigned ones
+        std::vector<IntRow> rows;
+        table->m_binding = slave::make_binding<IntRow>([&](slave::TypedRecordSet<IntRow>& rs) { rows.push_back(rs.m_row); },
+                                                       &IntRow::wide, "id", &IntRow::uint, "count",
+                                                       &IntRow::optional, "delta", &IntRow::small, "flag",
+                                                       &IntRow::usmall, "level", &IntRow::medium, "born");
+        table->m_binding->resolve(*table);
+        rli.setTable("test", "db", std::move(table));
+
+        // YEAR 2028 is stored as 128
+        const std::string event = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 7, 0x7F, 0,
+                                                std::string(1, '\0') + packInt(-2, 4) + packInt(65535, 2) + packInt(-3, 3) + packInt(-1, 1)
+                                                + packInt(200, 1) + packInt(128, 1) + packInt(0, 8)
+                                                + std::string(1, '\0') + packInt(7, 4) + packInt(1, 2) + packInt(8, 3) + packInt(1, 1)
+                                                + packInt(1, 1) + packInt(1, 1) + packInt(0, 8));
+        applyRowsEvent(rli, event);
+
+        BOOST_REQUIRE_EQUAL(rows.size(), 2);
+        BOOST_CHECK_EQUAL(rows[0].wide, -2);
+        BOOST_CHECK_EQUAL(rows[0].uint, 65535);
+        BOOST_CHECK(rows[0].optional == int64_t(-3));
+        BOOST_CHECK_EQUAL(rows[0].small, -1);
+        BOOST_CHECK_EQUAL(rows[0].usmall, 200);
+        BOOST_CHECK_EQUAL(rows[0].medium, 128);
+        BOOST_CHECK_EQUAL(rows[1].wide, 7);
+        BOOST_CHECK_EQUAL(rows[1].uint, 1);
+        BOOST_CHECK(rows[1].optional == int64_t(8));
+        BOOST_CHECK_EQUAL(rows[1].small, 1);
+    }
+
+    // Type and value of FieldValue as string, for comparing values of any types
+    struct DumpVisitor
+    {
+        std::string operator()(std::nullptr_t) const { return "NULL"; }
+
+        template <typename T>
+        std::string operator()(const T& v) const
+        {
+            std::ostringstream s;
+            s << typeid(T).name() << ':';
+            if constexpr (std::is_same<T, char>::value)
+                s << int(v);
+            else
+                s << v;
+            return s.str();
+        }
+    };
+
+    std::string dumpFieldValue(const slave::FieldValue& v)
+    {
+        return slave::visit(DumpVisitor(), v);
+    }
+
+    void test_FieldValueVisit()
+    {
+        BOOST_CHECK_EQUAL(dumpFieldValue(slave::nullFieldValue()), "NULL");
+        BOOST_CHECK_EQUAL(dumpFieldValue(slave::FieldValue(char(-2))), std::string(typeid(char).name()) + ":-2");
+        BOOST_CHECK_EQUAL(dumpFieldValue(slave::FieldValue(uint32_t(7))), std::string(typeid(uint32_t).name()) + ":7");
+        BOOST_CHECK_EQUAL(dumpFieldValue(slave::FieldValue(int32_t(-7))), std::string(typeid(int32_t).name()) + ":-7");
+        BOOST_CHECK_EQUAL(dumpFieldValue(slave::FieldValue(std::string("abc"))), std::string(typeid(std::string).name()) + ":abc");
+
+        // Signed and unsigned values are distinct
+        size_t visited = 0;
+        auto check = [&](const auto& v) -> bool
+        {
+            ++visited;
+            typedef typename std::decay<decltype(v)>::type T;
+            return std::is_same<T, unsigned long long>::value;
+        };
+        BOOST_CHECK(slave::visit(check, slave::FieldValue(static_cast<unsigned long long>(1))));
+        BOOST_CHECK(!slave::visit(check, slave::FieldValue(int32_t(1))));
+        BOOST_CHECK_EQUAL(visited, 2);
+    }
+
+    void test_DecodePlan()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::collate_info collate;
+        collate.maxlen = 1;
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_tiny("tiny", "tinyint(4)"));
+        table->fields.emplace_back(new slave::Field_short("short", "smallint(6)"));
+        table->fields.emplace_back(new slave::Field_medium("medium", "mediumint(9)"));
+        table->fields.emplace_back(new slave::Field_long("long", "int(11)"));
+        table->fields.emplace_back(new slave::Field_longlong("longlong", "bigint(20)"));
+        table->fields.emplace_back(new slave::Field_float("float", "float"));
+        table->fields.emplace_back(new slave::Field_double("double", "double"));
+        table->fields.emplace_back(new slave::Field_date("date", "date"));
+        table->fields.emplace_back(new slave::Field_timestamp("timestamp", "timestamp", true));
+        table->fields.emplace_back(new slave::Field_timestamp("timestamp2", "timestamp(3)", false));
+        table->fields.emplace_back(new slave::Field_datetime("datetime", "datetime", true));
+        table->fields.emplace_back(new slave::Field_datetime("datetime2", "datetime", false));
+        table->fields.emplace_back(new slave::Field_time("time", "time", true));
+        table->fields.emplace_back(new slave::Field_enum("enum", "enum('a','b')"));
+        table->fields.emplace_back(new slave::Field_set("set", "set('a','b','c')"));
+        table->fields.emplace_back(new slave::Field_bit("bit", "bit(12)"));
+        table->fields.emplace_back(new slave::Field_decimal("decimal", "decimal(10,2)"));
+        table->fields.emplace_back(new slave::Field_varstring("varchar", "varchar(10)", collate));
+        table->fields.emplace_back(new slave::Field_blob("blob", "blob"));
+        table->m_filter = slave::eAll;
+        table->row_type = slave::RowType::Vector;
+        table->build_plan();
+        BOOST_CHECK_EQUAL(table->plan.size(), table->fields.size());
+        BOOST_CHECK(table->plan[0].op == slave::DecodeOp::Tiny);
+        BOOST_CHECK(table->plan[9].op == slave::DecodeOp::Timestamp2);
+        BOOST_CHECK(table->plan[11].op == slave::DecodeOp::Datetime2);
+        BOOST_CHECK_EQUAL(table->plan.fixed_width(), 0);
+
+        std::vector<std::string> rows;
+        table->m_callback = [&](slave::RecordSet& rs)
+        {
+            std::string row;
+            for (const auto& x : rs.m_row_vec)
+                row += dumpFieldValue(x.second) + ";";
+            rows.push_back(row);
+        };
+        slave::Table* const plain = table.get();
+        rli.setTable("test", "db", std::move(table));
+
+        const float f = -1.5;
+        const double d = 2.25;
+        const std::string values = "\xfe" + packInt(0xfff0, 2) + packInt(0x123456, 3) + packInt(0x89abcdef, 4)
+            + packInt(0x0123456789abcdefULL, 8) + std::string(reinterpret_cast<const char*>(&f), sizeof(f))
+            + std::string(reinterpret_cast<const char*>(&d), sizeof(d)) + packInt(1031754, 3)
+            + packInt(1400000000, 4) + std::string("\x53\x72\x6f\x00\x01\x02", 6)
+            + packInt(20110313094909ULL, 8) + std::string("\x99\x8f\x25\x20\x00", 5)
+            + packInt(0xfedcba, 3) + "\x02" + "\x05" + std::string("\x0a\xbc", 2)
+            + std::string("\x80\x00\x00\x7b\x2d", 5) + "\x03" "abc" + packInt(2, 2) + "xy";
+        // Null bitmap of 19 columns
+        const std::string no_nulls(3, '\0');
+        // NULL in longlong and blob
+        const std::string nulls = std::string("\x10\x00\x04", 3);
+        const std::string with_nulls = values.substr(0, 10) + values.substr(18, values.size() - 18 - 4);
+
+        // Rest of bitmap of 19 columns goes after its first byte
+        const std::string full = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 19, 0xff, 0,
+                                               std::string("\xff\x07", 2) + no_nulls + values + nulls + with_nulls);
+
+        // Decoded by the plan
+        applyRowsEvent(rli, full);
+        // Decoded by virtual Field::unpack()
+        plain->plan.clear();
+        applyRowsEvent(rli, full);
+
+        BOOST_REQUIRE_EQUAL(rows.size(), 4);
+        BOOST_CHECK_EQUAL(rows[0], rows[2]);
+        BOOST_CHECK_EQUAL(rows[1], rows[3]);
+        BOOST_CHECK(rows[1].find("NULL") != std::string::npos);
+        BOOST_CHECK_EQUAL(rows[0].find("NULL"), std::string::npos);
+        BOOST_CHECK(rows[0].find("abc;") != std::string::npos);
+        BOOST_CHECK(rows[0].find("xy;") != std::string::npos);
+        BOOST_CHECK(rows[0].find(":123.45;") != std::string::npos);
+    }
+
+    void test_ColumnFilterSkip()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_mediumblob("text", "mediumblob"));
+        table->fields.emplace_back(new slave::Field_long("value", "int(11)"));
+        table->m_filter = slave::eAll;
+        table->row_type = slave::RowType::Vector;
+        table->set_column_filter({"value", "id"});
+        BOOST_CHECK(table->is_selected(0));
+        BOOST_CHECK(!table->is_selected(1));
+        BOOST_CHECK(table->is_selected(2));
+
+        std::vector<std::pair<uint32_t, uint32_t>> rows;
+        table->m_callback = [&](slave::RecordSet& rs)
+        {
+            BOOST_REQUIRE_EQUAL(rs.m_row_vec.size(), 2);
+            rows.emplace_back(slave::get<uint32_t>(rs.m_row_vec[0].second), slave::get<uint32_t>(rs.m_row_vec[1].second));
+        };
+        slave::Table* const plain = table.get();
+        rli.setTable("test", "db", std::move(table));
+
+        const std::string text(5000, 'x');
+        const std::string event = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0,
+            std::string(1, '\0') + packInt(1, 4) + packInt(text.size(), 3) + text + packInt(10, 4)
+            + std::string(1, '\x02') + packInt(2, 4) + packInt(20, 4));
+
+        // Without plan filtered out value is skipped by Field::skip()
+        applyRowsEvent(rli, event);
+        plain->build_plan();
+        applyRowsEvent(rli, event);
+
+        BOOST_CHECK(rows == (std::vector<std::pair<uint32_t, uint32_t>>({{10, 1}, {20, 2}, {10, 1}, {20, 2}})));
+    }
+
+    void test_FlatRow()
+    {
+        // Perfect hash finds every name of a wide schema
+        std::vector<std::string> names;
+        for (int i = 0; i < 300; ++i)
+            names.push_back("column_" + std::to_string(i));
+        const slave::RowSchema wide(names, std::vector<std::string>(names.size(), "int(11)"));
+        bool found = true;
+        for (size_t i = 0; i < names.size(); ++i)
+            found = found && wide.index(names[i]) == i;
+        BOOST_CHECK(found);
+        BOOST_CHECK_EQUAL(wide.index("column_300"), slave::RowSchema::npos);
+        BOOST_CHECK_EQUAL(wide.index(""), slave::RowSchema::npos);
+        BOOST_CHECK_THROW(slave::RowSchema({"a", "a"}, {"int", "int"}), std::runtime_error);
+
+        slave::RelayLogInfo rli;
+        slave::PtrTable table = makeIntTable(rli);
+        table->fields.emplace_back(new slave::Field_long("other", "int(11)"));
+        table->row_type = slave::RowType::Flat;
+        table->set_column_filter({"value", "id"});
+
+        std::vector<slave::RecordSet> records;
+        table->m_callback = [&](slave::RecordSet& rs) { records.push_back(rs); };
+        const slave::Table* const plain = table.get();
+        rli.setTable("test", "db", std::move(table));
+
+        applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0,
+                                          std::string(1, '\x02') + packInt(1, 4) + packInt(7, 4)));
+        // After image without id
+        applyRowsEvent(rli, makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 3, 0x07, 0x06,
+                                          std::string(1, '\0') + packInt(1, 4) + packInt(10, 4) + packInt(7, 4)
+                                          + std::string(1, '\0') + packInt(20, 4) + packInt(7, 4)));
+
+        BOOST_REQUIRE_EQUAL(records.size(), 2);
+        const slave::FlatRow& row = records[0].m_row_flat;
+        BOOST_CHECK(records[0].row_type == slave::RowType::Flat);
+        BOOST_CHECK(records[0].m_row.empty());
+        BOOST_CHECK(records[0].m_row_vec.empty());
+        BOOST_REQUIRE_EQUAL(row.size(), 2);
+        BOOST_CHECK_EQUAL(row.name(0), "value");
+        BOOST_CHECK_EQUAL(row.type(1), "int(11)");
+        BOOST_CHECK(row.has(0));
+        BOOST_CHECK(slave::isNullFieldValue(row[0]));
+        BOOST_CHECK_EQUAL(slave::get<uint32_t>(row.at("id")), 1);
+        BOOST_CHECK(!row.find("other"));
+        BOOST_CHECK_THROW(row.at("other"), std::out_of_range);
+
+        // Schema is shared by all rows of the table
+        const slave::RecordSet& update = records[1];
+        BOOST_CHECK_EQUAL(update.m_row_flat.schema(), row.schema());
+        BOOST_CHECK_EQUAL(update.m_old_row_flat.schema(), plain->row_schema());
+        const size_t id = row.schema()->index("id");
+        BOOST_CHECK_EQUAL(slave::get<uint32_t>(update.m_old_row_flat[id]), 1);
+        BOOST_CHECK(!update.m_row_flat.has(id));
+        BOOST_CHECK_EQUAL(slave::get<uint32_t>(*update.m_row_flat.find("value")), 20);
+    }
+
+    void test_ArenaRow()
+    {
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::collate_info collate;
+        collate.maxlen = 3;
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_varstring("name", "varchar(100)", collate));
+        table->m_filter = slave::eAll;
+        table->row_type = slave::RowType::Arena;
+        rli.setTable("test", "db", std::move(table));
+
+        const std::string name(100, 'n');
+        const std::string event = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 2, 0x03, 0,
+                                                std::string(1, '\0') + packInt(1, 4) + packInt(name.size(), 2) + name
+                                                + std::string(1, '\x02') + packInt(2, 4));
+
+        std::pmr::monotonic_buffer_resource arena;
+        slave::Transaction transaction;
+        transaction.arena = &arena;
+        slave::EmptyExtState ext_state;
+        slave::Basic_event_info bei;
+        bei.parse(event.data(), event.size());
+        slave::Row_event_info roi(bei.buf, bei.event_len, false, false);
+        slave::apply_row_event(rli, bei, roi, ext_state, nullptr, nullptr, &transaction);
+
+        BOOST_REQUIRE_EQUAL(transaction.records.size(), 2);
+        const slave::ArenaRow& row = transaction.records[0].m_row_arena;
+        BOOST_CHECK(transaction.records[0].row_type == slave::RowType::Arena);
+        BOOST_CHECK(transaction.records[0].m_row_flat.schema() == nullptr);
+        BOOST_CHECK_EQUAL(row.resource(), &arena);
+        BOOST_REQUIRE_EQUAL(row.size(), 2);
+        BOOST_CHECK_EQUAL(row.name(1), "name");
+        BOOST_CHECK_EQUAL(std::get<uint32_t>(row.at("id")), 1);
+        const std::pmr::string& value = std::get<std::pmr::string>(row[1]);
+        BOOST_CHECK_EQUAL(std::string(value), name);
+        BOOST_CHECK_EQUAL(value.get_allocator().resource(), &arena);
+
+        const slave::ArenaRow& null_row = transaction.records[1].m_row_arena;
+        BOOST_CHECK_EQUAL(null_row.resource(), &arena);
+        BOOST_CHECK_EQUAL(null_row.schema(), row.schema());
+        BOOST_CHECK(std::holds_alternative<std::nullptr_t>(null_row[1]));
+
+        // Copies do not depend on the arena
+        const slave::ArenaRow copy = row;
+        BOOST_CHECK_EQUAL(copy.resource(), std::pmr::get_default_resource());
+        BOOST_CHECK_EQUAL(std::get<std::pmr::string>(copy[1]).get_allocator().resource(), std::pmr::get_default_resource());
+        transaction.records.clear();
+        arena.release();
+        BOOST_CHECK_EQUAL(std::string(std::get<std::pmr::string>(copy[1])), name);
+    }
+
+    void test_OldRowAfterUpdate()
+    {
+        for (const auto row_type : {slave::RowType::Map, slave::RowType::Vector, slave::RowType::Flat, slave::RowType::Arena})
+        {
+            slave::RelayLogInfo rli;
+            slave::PtrTable table = makeIntTable(rli);
+            table->row_type = row_type;
+
+            std::vector<std::pair<slave::RecordSet::TypeEvent, bool>> calls;
+            table->m_callback = [&](slave::RecordSet& rs)
+            {
+                const bool old_row = !rs.m_old_row.empty() || !rs.m_old_row_vec.empty()
+                    || rs.m_old_row_flat.size() || rs.m_old_row_arena.size();
+                calls.emplace_back(rs.type_event, old_row);
+            };
+            rli.setTable("test", "db", std::move(table));
+
+            // Reused RecordSet of the table does not keep the row before update
+            const std::string update = makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 2, 0x03, 0x03,
+                                                     std::string(1, '\0') + packInt(1, 4) + packInt(10, 4)
+                                                     + std::string(1, '\0') + packInt(1, 4) + packInt(20, 4));
+            applyRowsEvent(rli, update);
+            applyRowsEvent(rli, makeIntRowsEvent({{2, 30}}));
+            const std::vector<std::pair<slave::RecordSet::TypeEvent, bool>> expected = {
+                {slave::RecordSet::Update, true}, {slave::RecordSet::Write, false}};
+            BOOST_CHECK_MESSAGE(calls == expected, "row type " << static_cast<int>(row_type));
+
+            // Batches of RecordSets are reused too
+            slave::Table& plain = *rli.getTable({"db", "test"});
+            plain.m_batch_callback = [&](std::vector<slave::RecordSet>& batch)
+            {
+                for (auto& rs : batch)
+                    plain.m_callback(rs);
+            };
+            calls.clear();
+            applyRowsEvent(rli, update);
+            applyRowsEvent(rli, makeIntRowsEvent({{2, 30}}));
+            BOOST_CHECK_MESSAGE(calls == expected, "batch of row type " << static_cast<int>(row_type));
+
+            // And RecordSets of rows decoded in parallel, with or without batch callback
+            slave::ParallelDecode pool(2, 0);
+            for (int batch = 0; batch < 2; ++batch)
+            {
+                if (!batch)
+                    plain.m_batch_callback = nullptr;
+                calls.clear();
+                applyRowsEvent(rli, update, nullptr, &pool);
+                applyRowsEvent(rli, makeIntRowsEvent({{2, 30}}), nullptr, &pool);
+                BOOST_CHECK_MESSAGE(calls == expected, "parallel decode " << batch << " of row type " << static_cast<int>(row_type));
+            }
+        }
+    }
+
+    void test_ParallelDecode()
+    {
+        // Pool calls every task once and rethrows the exception of a task
+        slave::ParallelDecode pool(3, 0);
+        std::vector<std::atomic<int>> calls(100);
+        pool.run(calls.size(), [&](size_t i) { ++calls[i]; });
+        BOOST_CHECK(std::all_of(calls.begin(), calls.end(), [](const std::atomic<int>& x) { return x == 1; }));
+        BOOST_CHECK_THROW(pool.run(10, [](size_t i) { if (i == 7) throw std::runtime_error("task failed"); }), std::runtime_error);
+        BOOST_CHECK_NO_THROW(pool.run(10, [](size_t) {}));
+
+        slave::RelayLogInfo rli;
+        rli.setTableName(5, "test", "db");
+        slave::collate_info collate;
+        collate.maxlen = 1;
+        slave::PtrTable table(new slave::Table("db", "test"));
+        table->fields.emplace_back(new slave::Field_long("id", "int(11)"));
+        table->fields.emplace_back(new slave::Field_varstring("name", "varchar(100)", collate));
+        table->fields.emplace_back(new slave::Field_long("value", "int(11)"));
+        table->m_filter = slave::eAll;
+        table->row_type = slave::RowType::Vector;
+        table->build_plan();
+
+        std::vector<std::string> rows;
+        std::vector<size_t> batches;
+        table->m_callback = [&](slave::RecordSet& rs)
+        {
+            std::string row;
+            for (const auto& x : rs.m_old_row_vec)
+                row += dumpFieldValue(x.second) + ";";
+            for (const auto& x : rs.m_row_vec)
+                row += dumpFieldValue(x.second) + ";";
+            rows.push_back(row);
+        };
+        slave::Table* const plain = table.get();
+        rli.setTable("test", "db", std::move(table));
+
+        auto row = [](unsigned i)
+        {
+            const std::string name = "name " + std::to_string(i);
+            std::string result(1, i % 7 ? '\0' : '\x04');
+            result += packInt(i, 4) + static_cast<char>(name.size()) + name;
+            if (i % 7)
+                result += packInt(i * 10, 4);
+            return result;
+        };
+        std::string write_rows;
+        std::string update_rows;
+        for (unsigned i = 0; i < 1000; ++i)
+        {
+            write_rows += row(i);
+            if (i < 300)
+                update_rows += row(i) + row(i + 1);
+        }
+        const std::string write = makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0, write_rows);
+        const std::string update = makeRowsEvent(slave::UPDATE_ROWS_EVENT_V1, 3, 0x07, 0x07, update_rows);
+
+        applyRowsEvent(rli, write);
+        applyRowsEvent(rli, update);
+        const std::vector<std::string> expected = rows;
+        BOOST_REQUIRE_EQUAL(expected.size(), 1300);
+        BOOST_CHECK(expected[7].find("NULL") != std::string::npos);
+
+        // Callbacks get rows in the same order
+        rows.clear();
+        applyRowsEvent(rli, write, nullptr, &pool);
+        applyRowsEvent(rli, update, nullptr, &pool);
+        BOOST_CHECK(rows == expected);
+
+        // Batch callback too
+        rows.clear();
+        plain->m_batch_callback = [&](std::vector<slave::RecordSet>& batch)
+        {
+            batches.push_back(batch.size());
+            for (auto& rs : batch)
+                plain->m_callback(rs);
+        };
+        applyRowsEvent(rli, write, nullptr, &pool);
+        applyRowsEvent(rli, update, nullptr, &pool);
+        BOOST_CHECK(rows == expected);
+        BOOST_CHECK(batches == std::vector<size_t>({1000, 300}));
+
+        // Events below the size are decoded by the calling thread
+        slave::ParallelDecode large(3, write.size());
+        rows.clear();
+        applyRowsEvent(rli, update, nullptr, &large);
+        BOOST_CHECK(rows == std::vector<std::string>(expected.begin() + 1000, expected.end()));
+
+        // Row which does not end with the event is not decoded
+        plain->m_batch_callback = nullptr;
+        BOOST_CHECK_THROW(applyRowsEvent(rli, write.substr(0, write.size() - 1), nullptr, &pool), std::runtime_error);
+        // Nor the one with value or length of value out of the event
+        BOOST_CHECK_THROW(applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0,
+                                                            std::string(1, '\0') + packInt(1, 4) + "\x50" "ab"), nullptr, &pool),
+                          std::runtime_error);
+        BOOST_CHECK_THROW(applyRowsEvent(rli, makeRowsEvent(slave::WRITE_ROWS_EVENT_V1, 3, 0x07, 0,
+                                                            std::string(1, '\0') + packInt(1, 4)), nullptr, &pool),
+                          std::runtime_error);
+    }
 }// anonymous-namespace
 
 test_suite* init_unit_test_suite(int argc, char* argv[])
@@ -1929,6 +3771,7 @@ test_suite* init_unit_test_suite(int argc, char* argv[])
 
     ADD_FIXTURE_TEST(test_HelloWorld);
     ADD_FIXTURE_TEST(test_StartStopPosition);
+    ADD_FIXTURE_TEST(test_TransactionCallback);
     ADD_FIXTURE_TEST(test_SetBinlogPos);
     ADD_FIXTURE_TEST(test_Disconnect);
     ADD_FIXTURE_TEST(test_Stat);
@@ -1940,6 +3783,31 @@ test_suite* init_unit_test_suite(int argc, char* argv[])
     ADD_FIXTURE_TEST(test_GtidAdding);
     ADD_FIXTURE_TEST(test_Decimal);
     ADD_FIXTURE_TEST(test_DecimalIterators);
+    ADD_FIXTURE_TEST(test_BinlogFileSource);
+    ADD_FIXTURE_TEST(test_EventRing);
+    ADD_FIXTURE_TEST(test_PacketReader);
+    ADD_FIXTURE_TEST(test_PacketReaderCompressed);
+    ADD_FIXTURE_TEST(test_Crc32);
+    ADD_FIXTURE_TEST(test_SkipRowEvent);
+    ADD_FIXTURE_TEST(test_TableIdCache);
+    ADD_FIXTURE_TEST(test_TableMapEvent);
+    ADD_FIXTURE_TEST(test_QueryClassifier);
+    ADD_FIXTURE_TEST(test_TableMapSchema);
+    ADD_FIXTURE_TEST(test_ParallelApply);
+    ADD_FIXTURE_TEST(test_ParallelKeyUpdate);
+    ADD_FIXTURE_TEST(test_BatchCallback);
+    ADD_FIXTURE_TEST(test_RowView);
+    ADD_FIXTURE_TEST(test_ColumnarBatch);
+    ADD_FIXTURE_TEST(test_ColumnarFixedWidth);
+    ADD_FIXTURE_TEST(test_ParallelDecode);
+    ADD_FIXTURE_TEST(test_TypedBinding);
+    ADD_FIXTURE_TEST(test_TypedBindingTypes);
+    ADD_FIXTURE_TEST(test_FieldValueVisit);
+    ADD_FIXTURE_TEST(test_DecodePlan);
+    ADD_FIXTURE_TEST(test_ColumnFilterSkip);
+    ADD_FIXTURE_TEST(test_FlatRow);
+    ADD_FIXTURE_TEST(test_ArenaRow);
+    ADD_FIXTURE_TEST(test_OldRowAfterUpdate);
 
 #undef ADD_FIXTURE_TEST
 
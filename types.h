@@ -2,8 +2,10 @@
 #define __SLAVE_TYPES_H
 
 #include <inttypes.h>
+#include <cstring>
 #include <string>
 #include <time.h>
+#include <type_traits>
 
 #include "decimal.h"
 
@@ -12,10 +14,14 @@
 #undef test
 #endif /* test */
 
-#ifdef SLAVE_USE_VARIANT_FOR_FIELD_VALUE
+#ifdef SLAVE_USE_STD_VARIANT_FOR_FIELD_VALUE
+#include <cstddef>              // for std::nullptr_t
+#include <variant>
+#elif defined(SLAVE_USE_VARIANT_FOR_FIELD_VALUE)
 #include <cstddef>              // for std::nullptr_t
 #include <boost/variant.hpp>
 #else
+#include <stdexcept>
 #include <boost/any.hpp>
 #endif
 
@@ -92,12 +98,64 @@ namespace types
     }
 }// types
 
+// Alternative of MY_BIT in std::variant of values. Where uint64_t is unsigned long long, MY_BIT values
+// are of the MY_BIGINT alternative, and this type, which is never stored, keeps the alternatives distinct.
+struct BitPlaceholder {};
+template <typename Stream>
+Stream& operator<<(Stream& s, BitPlaceholder) { return s; }
+
+typedef std::conditional<std::is_same<types::MY_BIT, types::MY_BIGINT>::value,
+                         BitPlaceholder, types::MY_BIT>::type BitAlternative;
+
 enum class RowType {
     Map,
-    Vector
+    Vector,
+    Flat,       // FlatRow with shared schema, see RecordSet::m_row_flat
+    Arena       // ArenaRow allocated from memory of the transaction, see RecordSet::m_row_arena
 };
 
-#ifdef SLAVE_USE_VARIANT_FOR_FIELD_VALUE
+#ifdef SLAVE_USE_STD_VARIANT_FOR_FIELD_VALUE
+    // One alternative per stored type of types::MY_*, values are kept inside the variant,
+    // std::string keeps short values in its own buffer without allocation
+    using FieldValue = std::variant<std::nullptr_t
+                                  , char                // MY_TINYINT
+                                  , uint16_t            // MY_SMALLINT
+                                  , int32_t             // MY_TIME, MY_ENUM
+                                  , uint32_t            // MY_INT, MY_MEDIUMINT, MY_DATE, MY_TIMESTAMP
+                                  , unsigned long long  // MY_BIGINT, MY_DATETIME, MY_SET
+                                  , BitAlternative      // MY_BIT
+                                  , float
+                                  , double
+                                  , std::string
+                                  , decimal::Decimal
+                                  >;
+    inline std::nullptr_t nullFieldValue() { return nullptr; }
+    inline bool isNullFieldValue(const FieldValue& v) { return std::holds_alternative<std::nullptr_t>(v); }
+    template <typename T>
+    const T& get(const FieldValue& v) { return std::get<T>(v); }
+
+    // Calls visitor with the stored value: std::nullptr_t for NULL or a value of one of types::MY_* types.
+    // The result of visitor for all types must be the same.
+    template <typename Visitor>
+    decltype(auto) visit(Visitor&& visitor, const FieldValue& v) { return std::visit(std::forward<Visitor>(visitor), v); }
+
+    // Stores the value reusing the storage of the previous one of the same type (capacity of std::string)
+    template <typename T>
+    void setFieldValue(FieldValue& v, const T& x)
+    {
+        if (T* p = std::get_if<T>(&v))
+            *p = x;
+        else
+            v = x;
+    }
+    inline void setFieldValue(FieldValue& v, const char* data, size_t size)
+    {
+        if (std::string* p = std::get_if<std::string>(&v))
+            p->assign(data, size);
+        else
+            v = std::string(data, size);
+    }
+#elif defined(SLAVE_USE_VARIANT_FOR_FIELD_VALUE)
     using FieldValue = boost::variant<std::nullptr_t
                                     , int
                                     , char
@@ -105,6 +163,7 @@ enum class RowType {
                                     , int32_t
                                     , uint32_t
                                     , unsigned long long
+                                    , BitAlternative      // MY_BIT
                                     , float
                                     , double
                                     , std::string
@@ -114,12 +173,79 @@ enum class RowType {
     inline bool isNullFieldValue(const FieldValue& v) { return v.type() == typeid(std::nullptr_t); }
     template <typename T>
     const T& get(const FieldValue& v) { return boost::get<T>(v); }
+
+    template <typename Visitor>
+    decltype(auto) visit(Visitor&& visitor, const FieldValue& v) { return boost::apply_visitor(visitor, v); }
+
+    // Stores the value reusing the storage of the previous one of the same type (capacity of std::string)
+    template <typename T>
+    void setFieldValue(FieldValue& v, const T& x)
+    {
+        if (T* p = boost::get<T>(&v))
+            *p = x;
+        else
+            v = x;
+    }
+    inline void setFieldValue(FieldValue& v, const char* data, size_t size)
+    {
+        if (std::string* p = boost::get<std::string>(&v))
+            p->assign(data, size);
+        else
+            v = std::string(data, size);
+    }
 #else
     using FieldValue = boost::any;
     inline boost::any nullFieldValue() { return boost::any(); }
     inline bool isNullFieldValue(const FieldValue& v) { return v.empty(); }
     template <typename T>
     T get(const FieldValue& v) { return boost::any_cast<T>(v); }
+
+    template <typename Visitor>
+    decltype(auto) visit(Visitor&& visitor, const FieldValue& v)
+    {
+        const std::type_info& type = v.type();
+        if (v.empty())
+            return visitor(nullptr);
+        if (type == typeid(char))
+            return visitor(boost::any_cast<const char&>(v));
+        if (type == typeid(uint16_t))
+            return visitor(boost::any_cast<const uint16_t&>(v));
+        if (type == typeid(int32_t))
+            return visitor(boost::any_cast<const int32_t&>(v));
+        if (type == typeid(uint32_t))
+            return visitor(boost::any_cast<const uint32_t&>(v));
+        if (type == typeid(unsigned long long))
+            return visitor(boost::any_cast<const unsigned long long&>(v));
+        if (type == typeid(types::MY_BIT))
+            return visitor(boost::any_cast<const types::MY_BIT&>(v));
+        if (type == typeid(float))
+            return visitor(boost::any_cast<const float&>(v));
+        if (type == typeid(double))
+            return visitor(boost::any_cast<const double&>(v));
+        if (type == typeid(std::string))
+            return visitor(boost::any_cast<const std::string&>(v));
+        if (type == typeid(decimal::Decimal))
+            return visitor(boost::any_cast<const decimal::Decimal&>(v));
+        throw std::runtime_error(std::string("slave::visit(): unknown type of FieldValue: ") + type.name());
+    }
+
+    // Stores the value reusing the storage of the previous one of the same type
+    // (holder of boost::any and capacity of std::string), so decoding of the next row does not allocate
+    template <typename T>
+    void setFieldValue(FieldValue& v, const T& x)
+    {
+        if (T* p = boost::any_cast<T>(&v))
+            *p = x;
+        else
+            v = x;
+    }
+    inline void setFieldValue(FieldValue& v, const char* data, size_t size)
+    {
+        if (std::string* p = boost::any_cast<std::string>(&v))
+            p->assign(data, size);
+        else
+            v = std::string(data, size);
+    }
 #endif
 
 }// slave